@@ -11,6 +11,7 @@
 #include "mbed.h"
 #include <bitset>
 #include "si7210.h"
+#include "si7210_profile.h"
 #include "utility.h"
 #include "Printer.h"
 #include <vector>
@@ -21,6 +22,7 @@
 #undef UNIT_TEST
 #undef ACCURACY_TESTING
 #define PRECISION_TESTING
+#undef BOOT_TESTING
 
 void printRegisters(vector<si7210_register_t> _registers)
 {
@@ -229,8 +231,54 @@ int main(int argc, char *argv[])
 // testing sample time too
 #ifdef PRECISION_TESTING
 
+#include "si7210_sampler.h"
+#include "si7210_stats.h"
+
 // settings
 #define TEST_TIME 99999
+#define SAMPLE_RATE_HZ 1000
+#define REPORT_PERIOD_MS 10000
+
+// Allan deviation averaging times in samples (1ms to 10s at 1kHz)
+static const uint32_t taus[] = {1, 10, 100, 1000, 10000};
+
+// Fed from the sampler's thread, reported from main
+static si7210_stats stats;
+static si7210_monitor statsLock;
+
+static void onSample(void *context, const si7210_sample_t *sample)
+{
+  statsLock.lock();
+  stats.add(sample->fieldUt);
+  statsLock.unlock();
+}
+
+static void printStats(const si7210_stats &s, const si7210_sampler_stats_t &sampling)
+{
+  si7210_stats_summary_t summary;
+  s.getSummary(&summary);
+
+  Printer::pc.printf("Samples: %lu\tMissed: %lu\tJitter (us): %lu\n", (unsigned long)summary.count,
+                     (unsigned long)sampling.missed, (unsigned long)sampling.jitterUs);
+  Printer::pc.printf("Mean (uT): %.3f\tStddev (uT): %.3f\tMin: %ld\tMax: %ld\tP-P: %ld\n", summary.meanUt,
+                     summary.stddevUt, (long)summary.minUt, (long)summary.maxUt, (long)summary.peakToPeakUt);
+
+  for (size_t i = 0; i < s.getNumTaus(); i++)
+  {
+    double adev;
+    if (s.getAllanDeviation(i, &adev))
+    {
+      Printer::pc.printf("ADEV tau %lu: %.4f uT\n", (unsigned long)s.getTau(i), adev);
+    }
+  }
+
+  Printer::pc.printf("Histogram (uT: count): <%ld: %lu", (long)s.getBinLowUt(0), (unsigned long)s.getUnderflow());
+  for (size_t i = 0; i < SI7210_STATS_BINS; i++)
+  {
+    Printer::pc.printf(" %ld: %lu", (long)s.getBinLowUt(i), (unsigned long)s.getBin(i));
+  }
+  Printer::pc.printf(" >=%ld: %lu\n", (long)s.getBinLowUt(SI7210_STATS_BINS), (unsigned long)s.getOverflow());
+}
 
 int main(int argc, char *argv[])
 {
@@ -244,6 +292,11 @@ int main(int argc, char *argv[])
   I2C i2c(sda, scl);
   i2c.frequency(1000000);
 
+#ifdef SI7210_PROFILE
+  // Start profiling before the driver is constructed so init() is traced too
+  si7210_profile::reset();
+#endif
+
   // Filter
   Filter filter;
   filter.filterType = si7210_filters_t::FIR;
@@ -252,45 +305,105 @@ int main(int argc, char *argv[])
   // si7210 object
   si7210 hall(&i2c, devAddr7Bit, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, filter);
 
-  int tempFieldStrength;
-
   Timer time;
   time.start();
 
-  // Timer for timing sample time
-  Timer sampleTime;
-
   thread_sleep_for(2000);
 
+  // Centre the histogram on the resting field, 2uT per bin
+  int restingField = hall.getFieldStrength();
+  stats.setHistogram(restingField - SI7210_STATS_BINS, 2);
+  stats.setTaus(taus, sizeof(taus) / sizeof(taus[0]));
+
+  si7210_sampler sampler(&hall, onSample, NULL);
+  sampler.start(SAMPLE_RATE_HZ);
+
   time.reset();
 
-  while (1)
+  while (time.read() < TEST_TIME)
   {
-    sampleTime.start();
-    sampleTime.reset();
+    thread_sleep_for(REPORT_PERIOD_MS);
 
-    tempFieldStrength = hall.getFieldStrength();
+    // Print from a snapshot so sampling isn't held up by the serial port
+    statsLock.lock();
+    si7210_stats snapshot = stats;
+    statsLock.unlock();
+
+    si7210_sampler_stats_t sampling;
+    sampler.getStats(&sampling);
+
+    Printer::pc.printf("Time (ms): %i\n", time.read_ms());
+    printStats(snapshot, sampling);
+
+#ifdef SI7210_PROFILE
+    // Print the per call site cycle counts every report
+    si7210_profile::dump();
+    si7210_profile::reset();
+#endif
+  }
 
-    sampleTime.stop();
-    thread_sleep_for(3);
+  sampler.stop();
+}
+
+#endif //PRECISION_TESTING
+
+// testing boot-to-first-sample time with and without the saved config image
+#ifdef BOOT_TESTING
+
+#include "kvstore_global_api.h"
+
+#define CONFIG_KEY "/kv/si7210"
+
+int main(int argc, char *argv[])
+{
+  Timer bootTime;
+  bootTime.start();
+
+  // Device address
+  uint8_t devAddr7Bit = 0x31U;
+
+  // I2C bus
+  PinName sda = PA_10;
+  PinName scl = PA_9;
+  I2C i2c(sda, scl);
+  i2c.frequency(1000000);
+  si7210_mbed_bus bus(&i2c);
+
+  // Filter
+  Filter filter;
+  filter.filterType = si7210_filters_t::FIR;
+  filter.burstsize = 12;
 
-    Printer::pc.printf("Time (ms): %i\t", time.read_ms());
-    Printer::pc.printf("SampleTime (us): %i\t", sampleTime.read_us());
-    Printer::pc.printf("Field Strength (uT): %i\t", tempFieldStrength);
+  // Saved configuration from the last boot, if there is one
+  si7210_config_image_t image;
+  size_t imageSize = 0;
+  bool haveImage = kv_get(CONFIG_KEY, &image, sizeof(image), &imageSize) == MBED_SUCCESS &&
+                   imageSize == sizeof(image);
 
-    uint8_t tempReg;
-    hall.readRegister(REG_0XCD, &tempReg);
-    Printer::pc.printf("0XCD: %s\n", utility::hexToBinaryStr(tempReg).c_str());
+  bootTime.reset();
 
-    thread_sleep_for(3);
+  si7210 hall(&bus, devAddr7Bit, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, filter,
+              haveImage ? &image : NULL);
+  int fieldStrength = hall.getFieldStrength();
 
-    if (time.read() > TEST_TIME)
-      break;
+  int bootUs = bootTime.read_us();
 
-    // printRegisters(hall.i2cMemDump());
+  Printer::pc.printf("Boot to first sample (us): %i\t", bootUs);
+  Printer::pc.printf("Saved config: %s\t", haveImage ? "yes" : "no");
+  Printer::pc.printf("Field Strength (uT): %i\n", fieldStrength);
+
+  // Save the configuration for the next boot
+  if (!haveImage && hall.saveConfig(&image))
+  {
+    kv_set(CONFIG_KEY, &image, sizeof(image), 0);
+  }
+
+  while (1)
+  {
+    thread_sleep_for(1000);
   }
 }
 
-#endif //PRECISION_TESTING
+#endif //BOOT_TESTING
 
 #endif //MAIN_H
\ No newline at end of file
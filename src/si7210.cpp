@@ -7,49 +7,224 @@
 // sensor
 
 #include "si7210.h"
+#include "si7210_bytes.h"
+#include "si7210_command_queue.h"
+#include "si7210_profile.h"
+#include <stddef.h>
+#include <string.h>
 
+#ifdef __MBED__
 si7210::si7210(I2C *i2cBus, uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f)
+    : mbedBus(i2cBus)
+{
+    bus = &mbedBus;
+    setup(addr, r, mag, m, f);
+
+    init();
+}
+#endif
+
+si7210::si7210(si7210_bus *_bus, uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f)
+{
+    bus = _bus;
+    setup(addr, r, mag, m, f);
+
+    init();
+}
+
+si7210::si7210(si7210_bus *_bus, uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f,
+               const si7210_config_image_t *image)
+{
+    bus = _bus;
+    setup(addr, r, mag, m, f);
+
+    init(image);
+}
+
+void si7210::setup(uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f)
 {
-    i2c = i2cBus;
     devAddr7Bit = addr;
     devAddr8Bit = addr << 1;
     range = r;
     magnet = mag;
     mode = m;
     filter = f;
-
-    init();
+    powerState = si7210_power_t::ACTIVE;
+    wakeState = si7210_power_t::ACTIVE;
+    wakeLatencyUs = 0;
+    shadowValid = 0;
+    shadowWritten = 0;
+    calibration = NULL;
+    queue = NULL;
 }
 
 si7210::~si7210() {}
 
 void si7210::init()
 {
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::INIT);
+
+    // Record the whole sequence and write it in as few transactions as
+    // possible. Reading the configuration block first lets the queue skip
+    // writes of values the sensor already has and join the bursts up. The
+    // queue also keeps other bus users out until the sensor is fully
+    // configured.
+    si7210_command_queue queue(this);
+    queue.prefetch(CONFIG_IMAGE_FIRST, CONFIG_IMAGE_SIZE);
+
     setMode(mode);
     setRange(range, magnet);
     setFilter(filter);
 }
 
+// Bits of each register in the config image that matter when comparing it
+// against the sensor. 0xC4 only compares the control bits (meas is read
+// only) and 0xC5 is not compared.
+static const uint8_t configImageMask[CONFIG_IMAGE_SIZE] = {
+    0x0F, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+bool si7210::init(const si7210_config_image_t *image)
+{
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::INIT);
+
+    if (image == NULL || !checkConfig(image) ||
+        image->range != (uint8_t)range || image->magnet != (uint8_t)magnet ||
+        image->mode != (uint8_t)mode || image->filterType != (uint8_t)filter.filterType ||
+        image->burstsize != (uint8_t)filter.burstsize)
+    {
+        init();
+        return false;
+    }
+
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    // Read the whole block in one transaction
+    uint8_t regs[CONFIG_IMAGE_SIZE];
+    if (!readRegisters(CONFIG_IMAGE_FIRST, regs, CONFIG_IMAGE_SIZE))
+    {
+        return false;
+    }
+
+    // Write each run of consecutive registers that differ from the image
+    // (0xC6-0xD0) as one burst
+    size_t i = REG_0XC6 - CONFIG_IMAGE_FIRST;
+    while (i < CONFIG_IMAGE_SIZE)
+    {
+        if (((regs[i] ^ image->regs[i]) & configImageMask[i]) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < CONFIG_IMAGE_SIZE && ((regs[i] ^ image->regs[i]) & configImageMask[i]) != 0)
+        {
+            i++;
+        }
+
+        if (!writeRegisters(CONFIG_IMAGE_FIRST + start, &image->regs[start], i - start))
+        {
+            return false;
+        }
+    }
+
+    // Then 0xC4 last since it starts/stops measuring
+    if (((regs[0] ^ image->regs[0]) & configImageMask[0]) != 0 &&
+        !writeRegister(REG_0XC4, image->regs[0] & configImageMask[0]))
+    {
+        return false;
+    }
+
+    // Everything in the image is configuration wakeup() has to restore, even
+    // the registers that didn't need writing this time.
+    for (uint8_t reg = REG_0XC6; reg <= REG_A5; reg++)
+    {
+        shadowWritten |= 1UL << (reg - REG_0XC0);
+    }
+
+    uint8_t reg0xC4 = image->regs[0];
+    uint8_t reg0xC9 = image->regs[REG_0XC9 - CONFIG_IMAGE_FIRST];
+    if (reg0xC4 & SLEEP_MASK)
+    {
+        powerState = si7210_power_t::SLEEP;
+    }
+    else if (reg0xC4 & STOP_MASK)
+    {
+        powerState = si7210_power_t::IDLE;
+    }
+    else if (reg0xC9 & SLTIMENA_MASK)
+    {
+        powerState = si7210_power_t::SLEEP_TIMER;
+    }
+    else
+    {
+        powerState = si7210_power_t::ACTIVE;
+    }
+
+    return true;
+}
+
+bool si7210::saveConfig(si7210_config_image_t *image)
+{
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    if (!readRegisters(CONFIG_IMAGE_FIRST, image->regs, CONFIG_IMAGE_SIZE))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < CONFIG_IMAGE_SIZE; i++)
+    {
+        image->regs[i] &= configImageMask[i];
+    }
+
+    image->version = CONFIG_IMAGE_VERSION;
+    image->range = (uint8_t)range;
+    image->magnet = (uint8_t)magnet;
+    image->mode = (uint8_t)mode;
+    image->filterType = (uint8_t)filter.filterType;
+    image->burstsize = (uint8_t)filter.burstsize;
+    image->crc = si7210_crc8((const uint8_t *)image, offsetof(si7210_config_image_t, crc));
+
+    return true;
+}
+
+bool si7210::checkConfig(const si7210_config_image_t *image)
+{
+    return image->version == CONFIG_IMAGE_VERSION &&
+           image->crc == si7210_crc8((const uint8_t *)image, offsetof(si7210_config_image_t, crc));
+}
+
 // Host command for reading an I2C register (from si7210 Datasheet):
 // Note: the number of bits is in paren's (e.g. (8)=8bit)
 // START(1) | DeviceAddress(7) | W(1) | ACK(1) | RegisterAddress(8) | ACK(1)
 // | Sr=repeated start(1) | DeviceAddress(7) | R(1) | Data(8) | NACK(1) | STOP(1)
 bool si7210::readRegister(uint8_t _reg, uint8_t *_returnedData)
 {
+    if (queue != NULL)
+    {
+        return queue->read(_reg, _returnedData);
+    }
+
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::READ_REGISTER);
+
     // Sends start bit.
     // Writes device address+write bit onto bus.
     // Writes the specific register address (address length=1 byte) of the
     // device to read from onto bus.
-    // Repeated start is true (doesn't send stop bit)
-    i2c->write(devAddr8Bit, (const char *)&_reg, 1, true);
-
-    // Sends start bit.
+    // Sends repeated start bit.
     // Writes device address+read bit onto bus.
     // Reads 1 byte of data.
     // Sends stop bit.
-    // Return ack or nack to host:
-    // 0 on success (ack), nonzero on failure (nack).
-    return i2c->read(devAddr8Bit, (char *)_returnedData, 1, false) == 0;
+    // The bus layer does this as one transaction so that no other bus user
+    // can get in between the write and the read.
+    if (!bus->transfer(devAddr8Bit, &_reg, 1, _returnedData, 1))
+    {
+        return false;
+    }
+
+    cache(_reg, *_returnedData, false);
+    return true;
 }
 
 // Host command for writing an I2C register (from si7210 Datasheet):
@@ -58,6 +233,13 @@ bool si7210::readRegister(uint8_t _reg, uint8_t *_returnedData)
 // | Data(8) | ACK(1) | STOP(1)
 bool si7210::writeRegister(uint8_t _reg, uint8_t _data)
 {
+    if (queue != NULL)
+    {
+        return queue->write(_reg, _data);
+    }
+
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::WRITE_REGISTER);
+
     uint8_t buffer[2] = {_reg, _data};
 
     // Writes DeviceAddress onto bus, forces bottom bit/LSB to 0 to indicate
@@ -69,75 +251,322 @@ bool si7210::writeRegister(uint8_t _reg, uint8_t _data)
     // The 1 write command is the same as these 2 write commands:
     //      i2c->write(devAddr8Bit, (const char *)_reg, 1, false);
     //      i2c->write(devAddr8Bit, (const char *)_data, 1, false);
-    return i2c->write(devAddr8Bit, (const char *)buffer, 2, false) == 0;
+    if (!bus->transfer(devAddr8Bit, buffer, 2, NULL, 0))
+    {
+        return false;
+    }
+
+    cache(_reg, _data, true);
+    return true;
+}
+
+// Same as readRegister() with more Data(8) | ACK(1) before the NACK.
+bool si7210::readRegisters(uint8_t _reg, uint8_t *_data, size_t len)
+{
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::READ_REGISTERS);
+
+    if (!bus->transfer(devAddr8Bit, &_reg, 1, _data, len))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        cache(_reg + i, _data[i], false);
+    }
+
+    return true;
+}
+
+// Same as writeRegister() with more Data(8) | ACK(1) before the STOP.
+bool si7210::writeRegisters(uint8_t _reg, const uint8_t *_data, size_t len)
+{
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::WRITE_REGISTERS);
+
+    uint8_t buffer[17];
+    if (len > sizeof(buffer) - 1)
+    {
+        return false;
+    }
+
+    buffer[0] = _reg;
+    memcpy(&buffer[1], _data, len);
+
+    if (!bus->transfer(devAddr8Bit, buffer, len + 1, NULL, 0))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        cache(_reg + i, _data[i], true);
+    }
+
+    return true;
+}
+
+void si7210::cache(uint8_t reg, uint8_t data, bool written)
+{
+    if (reg < REG_0XC0 || reg > REG_A5)
+    {
+        return;
+    }
+
+    shadow[reg - REG_0XC0] = data;
+    shadowValid |= 1UL << (reg - REG_0XC0);
+    if (written)
+    {
+        shadowWritten |= 1UL << (reg - REG_0XC0);
+    }
+}
+
+bool si7210::readCached(uint8_t reg, uint8_t *data)
+{
+    // The queue has writes the cache hasn't seen yet
+    if (queue != NULL)
+    {
+        return queue->read(reg, data);
+    }
+
+    if (shadowValid & (1UL << (reg - REG_0XC0)))
+    {
+        *data = shadow[reg - REG_0XC0];
+        return true;
+    }
+
+    return readRegister(reg, data);
+}
+
+bool si7210::writeCached(uint8_t reg, uint8_t data)
+{
+    // The queue drops redundant writes itself, against its queued values
+    if (queue != NULL)
+    {
+        return queue->write(reg, data);
+    }
+
+    if ((shadowValid & (1UL << (reg - REG_0XC0))) && shadow[reg - REG_0XC0] == data)
+    {
+        return true;
+    }
+
+    return writeRegister(reg, data);
 }
 
 uint8_t si7210::getChipId()
 {
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::GET_CHIP_ID);
+
     uint8_t temp;
     readRegister(REG_0XC0, &temp);
-    return (temp >> 4); // Bit shift to get bits 4:7 which hold the chip ID
+    return (temp >> CHIPID_SHIFT); // Bits 4:7 hold the chip ID
 }
 
 uint8_t si7210::getRevId()
 {
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::GET_REV_ID);
+
     uint8_t temp;
     readRegister(REG_0XC0, &temp);
-
-    // (0x1 << 4) = 11110000
-    // ~(0x1 << 4) = 00001111
-    // temp & (~(0x1 << 4) = performs bitwise AND to clear bits 4:7,
-    // leaving only bits 0:3 which are the rev ID bits.
-    return (temp & (~(0x1 << 4)));
+    return (temp & REVID_MASK); // Bits 0:3 hold the rev ID
 }
 
 // Attempts to read register containing chip ID and rev ID.
 bool si7210::checkGood()
 {
-    uint8_t temp;
-    readRegister(REG_0XC0, &temp);
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::CHECK_GOOD);
 
-    if (temp == 0x14)
-    {
-        return true;
-    }
-    else
+    uint8_t temp;
+    if (!readRegister(REG_0XC0, &temp))
     {
         return false;
     }
+
+    return (temp >> CHIPID_SHIFT) == SI7210_CHIP_ID;
 }
 
 bool si7210::sleep()
 {
-    uint8_t temp;
-    readRegister(REG_0XC9, &temp);
-    temp &= 0xFEU; // Clear sltimena
-    writeRegister(REG_0XC9, temp);
-    readRegister(REG_0XC4, &temp);
-    temp = (temp & 0xF8U) | 0x01; // clear STOP and set SLEEP
-    return writeRegister(REG_0XC4, temp);
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::SLEEP);
+
+    return setPowerState(si7210_power_t::SLEEP);
 }
 
+// How long wakeup() waits for the first fresh sample in usecs: longer than
+// the sensor takes to come out of sleep and finish a conversion with the
+// longest filter. And the time between polls of dspsigm while it waits.
+static const uint32_t WAKE_TIMEOUT_US = 2000;
+static const uint32_t WAKE_POLL_US = 20;
+
 bool si7210::wakeup()
 {
-    // Wake
-    uint8_t _reg = 0xC0;
-    return i2c->write(devAddr8Bit, (const char *)_reg, 1, false) == 0;
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::WAKEUP);
 
-    // Reinitialize based on saved private settings
-    init();
+    uint32_t start = si7210_micros();
+    bool ok = wake();
+
+    // Wait for the first fresh sample. Each poll is its own transaction with
+    // a pause in between, so other clients get the bus while the sensor
+    // converts. Gives up after a poll started past the timeout, so waiting
+    // on other clients' traffic can't time it out unpolled.
+    if (ok && powerState == si7210_power_t::ACTIVE)
+    {
+        uint32_t polling = si7210_micros();
+        bool fresh = false;
+        while (true)
+        {
+            bool late = si7210_micros() - polling >= WAKE_TIMEOUT_US;
+            uint8_t dspsigm;
+            fresh = readRegister(REG_DSPSIGM, &dspsigm) && (dspsigm & FRESH_MASK);
+            if (fresh || late)
+            {
+                break;
+            }
+            si7210_sleep_us(WAKE_POLL_US);
+        }
+        ok = fresh;
+    }
+
+    wakeLatencyUs = si7210_micros() - start;
+    return ok;
+}
+
+bool si7210::wake()
+{
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    // Wake. Any transaction addressed to the sensor wakes it up, so just
+    // point it at 0xC0. It may not be ACKed while the sensor wakes up.
+    uint8_t _reg = REG_0XC0;
+    bus->transfer(devAddr8Bit, &_reg, 1, NULL, 0);
+
+    // Reinitialize based on saved private settings. The sensor comes back
+    // with its power on register values, so write back only the
+    // configuration registers the driver has set, as one burst. The cached
+    // values already hold the OTP coefficients, so no OTP reads are needed.
+    // The sensor no longer holds them, so they mustn't let the queue drop
+    // any of the writes.
+    si7210_command_queue queue(this);
+
+    for (uint8_t reg = REG_0XC6; reg <= REG_A5; reg++)
+    {
+        if (shadowWritten & (1UL << (reg - REG_0XC0)))
+        {
+            shadowValid &= ~(1UL << (reg - REG_0XC0));
+            writeRegister(reg, shadow[reg - REG_0XC0]);
+        }
+    }
+
+    // Then go back to the power state from before sleep
+    uint8_t slTime = 0;
+    powerState = si7210_power_t::IDLE;
+    bool ok = readCached(REG_0XC8, &slTime) && setPowerState(wakeState, slTime);
+    return queue.flush() && ok;
+}
+
+bool si7210::setPowerState(si7210_power_t s, uint8_t slTime)
+{
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    if (powerState == si7210_power_t::SLEEP && s != si7210_power_t::SLEEP)
+    {
+        wakeState = s;
+        return wakeup();
+    }
+
+    uint8_t reg0xC4;
+    uint8_t reg0xC9;
+    if (!readCached(REG_0XC4, &reg0xC4) || !readCached(REG_0XC9, &reg0xC9))
+    {
+        return false;
+    }
+
+    // Clear sleep, stop and the read only meas bit
+    reg0xC4 &= ~(SLEEP_MASK | STOP_MASK | 0x80U);
+
+    bool ok;
+    switch (s)
+    {
+    case si7210_power_t::ACTIVE:
+        // slfast = 1, sltimena = 0 and sl_time = 0 for zero idle time
+        ok = writeCached(REG_0XC9, (reg0xC9 | SLFAST_MASK) & ~SLTIMENA_MASK) &&
+             writeCached(REG_0XC8, 0x0) &&
+             writeCached(REG_0XC4, reg0xC4);
+        break;
+    case si7210_power_t::IDLE:
+        ok = writeCached(REG_0XC9, reg0xC9 & ~SLTIMENA_MASK) &&
+             writeCached(REG_0XC4, reg0xC4 | STOP_MASK);
+        break;
+    case si7210_power_t::SLEEP:
+        if (powerState != si7210_power_t::SLEEP)
+        {
+            wakeState = powerState;
+        }
+        ok = writeCached(REG_0XC9, reg0xC9 & ~SLTIMENA_MASK) &&
+             writeCached(REG_0XC4, reg0xC4 | SLEEP_MASK);
+        break;
+    case si7210_power_t::SLEEP_TIMER:
+        ok = writeCached(REG_0XC8, slTime) &&
+             writeCached(REG_0XC9, (reg0xC9 & ~SLFAST_MASK) | SLTIMENA_MASK) &&
+             writeCached(REG_0XC4, reg0xC4);
+        break;
+    default:
+        ok = false;
+        break;
+    }
+
+    if (ok)
+    {
+        powerState = s;
+    }
+
+    return ok;
 }
 
 // B = (256*dspsigm[6:0]+dspsigl[7:0]-16384)*(0.00125 or 0.0125)
 // 1 LSB = 0.00125mT (+-20.47mT scale) or 1 LSB = 0.0125mT (+-204.7mT)
 int si7210::getFieldStrength()
 {
-    uint8_t temp;
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::GET_FIELD_STRENGTH);
+
+    // Sampling gets priority over config/diagnostic traffic and both
+    // bytes are read back to back.
+    si7210_bus_lock lock(bus, si7210_priority_t::SAMPLE);
 
     uint8_t dspsigm;
     readRegister(REG_DSPSIGM, &dspsigm);
     uint8_t dspsigl;
     readRegister(REG_DSPSIGL, &dspsigl);
+
+    return convert(dspsigm, dspsigl);
+}
+
+bool si7210::readSample(int *fieldUt, bool *fresh)
+{
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::READ_SAMPLE);
+
+    si7210_bus_lock lock(bus, si7210_priority_t::SAMPLE);
+
+    // Register address then a 2 byte read; the address auto increments
+    // from dspsigm to dspsigl.
+    uint8_t reg = REG_DSPSIGM;
+    uint8_t data[2];
+    if (!bus->transfer(devAddr8Bit, &reg, 1, data, 2))
+    {
+        return false;
+    }
+
+    if (fresh != NULL)
+    {
+        *fresh = (data[0] & FRESH_MASK) != 0;
+    }
+    *fieldUt = convert(data[0], data[1]);
+
+    return true;
+}
+
+int si7210::convert(uint8_t dspsigm, uint8_t dspsigl)
+{
     int fieldStrength;
 
     // (dspsigm & 0x7FU) = clears the MSB bit (7th bit) which is the "fresh" bit
@@ -147,16 +576,25 @@ int si7210::getFieldStrength()
     switch (range)
     {
     case si7210_range_t::RANGE_20mT:
-        return (fieldStrength / 4) + fieldStrength; // fieldStrength * 1.25
+        fieldStrength = (fieldStrength / 4) + fieldStrength; // fieldStrength * 1.25
+        break;
     case si7210_range_t::RANGE_200mT:
-        return (fieldStrength * 12) + (fieldStrength / 2); // fieldStrength * 12.5
+        fieldStrength = (fieldStrength * 12) + (fieldStrength / 2); // fieldStrength * 12.5
+        break;
     default:
         return 0;
     }
+
+    return calibration != NULL ? si7210_cal_apply(calibration, fieldStrength) : fieldStrength;
 }
 
 bool si7210::setMode(si7210_mode_t m)
 {
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::SET_MODE);
+
+    si7210_command_queue queue(this);
+    mode = m;
+
     switch (mode)
     {
     case si7210_mode_t::CONST_CONVERSION:
@@ -182,7 +620,8 @@ bool si7210::setMode(si7210_mode_t m)
         temp = (temp & 0xFC); // Start measurement
         writeRegister(REG_0XC4, temp);
 
-        return true;
+        powerState = si7210_power_t::ACTIVE;
+        return queue.flush();
     case si7210_mode_t::ONEBURST:
         return false;
     default:
@@ -192,8 +631,16 @@ bool si7210::setMode(si7210_mode_t m)
 
 bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
 {
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::SET_RANGE);
+
     uint8_t temp;
 
+    // The OTP is read through otp_addr/otp_ctrl/otp_data so the whole
+    // sequence must not be interleaved with another user's OTP access (the
+    // queue holds the bus). The coefficient writes are queued up and
+    // written as one burst at the end.
+    si7210_command_queue queue(this);
+
     // 20mT scale and no magnetic temp. compesnation
     if (r == si7210_range_t::RANGE_20mT && mag == si7210_magnet_t::NONE)
     {
@@ -220,7 +667,8 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
         writeRegister(REG_OTP_ADDR, 0x26U);
         writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK);
         readRegister(REG_OTP_DATA, &temp);
-        return writeRegister(REG_A5, temp);
+        writeRegister(REG_A5, temp);
+        return queue.flush();
     }
 
     // 200mT scale and no magnet temp. compensation
@@ -249,7 +697,8 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
         writeRegister(REG_OTP_ADDR, 0x2CU);
         writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK);
         readRegister(REG_OTP_DATA, &temp);
-        return writeRegister(REG_A5, temp);
+        writeRegister(REG_A5, temp);
+        return queue.flush();
     }
 
     // 20mT scale and neodymium temp. comp.
@@ -278,7 +727,8 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
         writeRegister(REG_OTP_ADDR, 0x32U);
         writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK);
         readRegister(REG_OTP_DATA, &temp);
-        return writeRegister(REG_A5, temp);
+        writeRegister(REG_A5, temp);
+        return queue.flush();
     }
 
     // 200mT scale and neodymium temp. comp.
@@ -307,7 +757,8 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
         writeRegister(REG_OTP_ADDR, 0x38U);
         writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK);
         readRegister(REG_OTP_DATA, &temp);
-        return writeRegister(REG_A5, temp);
+        writeRegister(REG_A5, temp);
+        return queue.flush();
     }
 
     // 20mT scale and ceramic temp. comp.
@@ -336,7 +787,8 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
         writeRegister(REG_OTP_ADDR, 0x3EU);
         writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK);
         readRegister(REG_OTP_DATA, &temp);
-        return writeRegister(REG_A5, temp);
+        writeRegister(REG_A5, temp);
+        return queue.flush();
     }
 
     // 200mT scale and ceramic temp. comp.
@@ -365,7 +817,8 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
         writeRegister(REG_OTP_ADDR, 0x44U);
         writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK);
         readRegister(REG_OTP_DATA, &temp);
-        return writeRegister(REG_A5, temp);
+        writeRegister(REG_A5, temp);
+        return queue.flush();
     }
     else
     {
@@ -373,9 +826,11 @@ bool si7210::setRange(si7210_range_t r, si7210_magnet_t mag)
     }
 }
 
-vector<si7210_register_t> si7210::i2cMemDump()
+std::vector<si7210_register_t> si7210::i2cMemDump()
 {
-    vector<si7210_register_t> registers;
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::I2C_MEM_DUMP);
+
+    std::vector<si7210_register_t> registers;
 
     for (int i = 0; i < 21; i++)
     {
@@ -407,8 +862,11 @@ vector<si7210_register_t> si7210::i2cMemDump()
 
     registers.shrink_to_fit();
 
-    for (int i = 0; i <= registers.size(); i++)
+    // Bulk traffic, yields to sampling: each read is its own transaction,
+    // so a waiting sample gets the bus in between
+    for (size_t i = 0; i < registers.size(); i++)
     {
+        si7210_bus_lock lock(bus, si7210_priority_t::DIAGNOSTIC);
         readRegister(registers[i].addr, &registers[i].data);
     }
 
@@ -417,6 +875,8 @@ vector<si7210_register_t> si7210::i2cMemDump()
 
 bool si7210::setFilter(Filter f)
 {
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::SET_FILTER);
+
     uint8_t temp = 0x0;
 
     switch (f.filterType)
@@ -459,4 +919,132 @@ bool si7210::setFilter(Filter f)
     default:
         return 0;
     }
-}
\ No newline at end of file
+}
+
+bool si7210::setSwitch(si7210_switch_t sw, si7210_switch_t *effective)
+{
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::SET_SWITCH);
+
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    uint8_t reg0xC6 = encodeSwOp(sw.thresholdUt, range);
+    if (sw.lowForField)
+    {
+        reg0xC6 |= SW_LOW4FIELD_MASK;
+    }
+
+    uint8_t reg0xC7 = encodeSwHyst(sw.hysteresisUt, range);
+    reg0xC7 |= (uint8_t)sw.polarity << SW_FIELDPOLSEL_SHIFT;
+
+    if (!writeRegister(REG_0XC6, reg0xC6) || !writeRegister(REG_0XC7, reg0xC7))
+    {
+        return false;
+    }
+
+    if (effective != NULL)
+    {
+        return getSwitch(effective);
+    }
+
+    return true;
+}
+
+bool si7210::getSwitch(si7210_switch_t *sw)
+{
+    SI7210_PROFILE_SCOPE(si7210_profile_site_t::GET_SWITCH);
+
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    uint8_t reg0xC6;
+    uint8_t reg0xC7;
+    if (!readRegister(REG_0XC6, &reg0xC6) || !readRegister(REG_0XC7, &reg0xC7))
+    {
+        return false;
+    }
+
+    // sw_fieldpolsel = 3 is reserved
+    uint8_t polarity = reg0xC7 >> SW_FIELDPOLSEL_SHIFT;
+    if (polarity > (uint8_t)si7210_switch_polarity_t::NEGATIVE)
+    {
+        return false;
+    }
+
+    sw->thresholdUt = decodeSwOp(reg0xC6 & SW_OP_MASK, range);
+    sw->hysteresisUt = decodeSwHyst(reg0xC7 & SW_HYST_MASK, range);
+    sw->polarity = (si7210_switch_polarity_t)polarity;
+    sw->lowForField = (reg0xC6 & SW_LOW4FIELD_MASK) != 0;
+
+    return true;
+}
+
+// 1 unit of sw_op/sw_hyst is 5uT on the 20mT range and 50uT on the 200mT
+// range.
+static int switchUnitUt(si7210_range_t r)
+{
+    return r == si7210_range_t::RANGE_200mT ? 50 : 5;
+}
+
+// Both encodings are floating point like (mantissa * 2^exponent) so the
+// nearest code is found by trying them all. There are only 128/64 codes and
+// this only runs when the switch is configured.
+uint8_t si7210::encodeSwOp(int thresholdUt, si7210_range_t r)
+{
+    uint8_t best = SW_OP_ZERO;
+    int bestError = thresholdUt < 0 ? -thresholdUt : thresholdUt;
+
+    for (int code = 0; code < SW_OP_ZERO; code++)
+    {
+        int error = decodeSwOp(code, r) - thresholdUt;
+        error = error < 0 ? -error : error;
+        if (error < bestError)
+        {
+            best = code;
+            bestError = error;
+        }
+    }
+
+    return best;
+}
+
+int si7210::decodeSwOp(uint8_t swOp, si7210_range_t r)
+{
+    swOp &= SW_OP_MASK;
+
+    if (swOp == SW_OP_ZERO)
+    {
+        return 0;
+    }
+
+    return (16 + (swOp & 0x0F)) * (1 << (swOp >> 4)) * switchUnitUt(r);
+}
+
+uint8_t si7210::encodeSwHyst(int hysteresisUt, si7210_range_t r)
+{
+    uint8_t best = SW_HYST_ZERO;
+    int bestError = hysteresisUt < 0 ? -hysteresisUt : hysteresisUt;
+
+    for (int code = 0; code < SW_HYST_ZERO; code++)
+    {
+        int error = decodeSwHyst(code, r) - hysteresisUt;
+        error = error < 0 ? -error : error;
+        if (error < bestError)
+        {
+            best = code;
+            bestError = error;
+        }
+    }
+
+    return best;
+}
+
+int si7210::decodeSwHyst(uint8_t swHyst, si7210_range_t r)
+{
+    swHyst &= SW_HYST_MASK;
+
+    if (swHyst == SW_HYST_ZERO)
+    {
+        return 0;
+    }
+
+    return (8 + (swHyst & 0x07)) * (1 << (swHyst >> 3)) * switchUnitUt(r);
+}
@@ -9,8 +9,13 @@
 #ifndef SI7210_H
 #define SI7210_H
 
+#ifdef __MBED__
 #include "mbed.h"
+#endif
+#include <stdint.h>
 #include <vector>
+#include "si7210_bus.h"
+#include "si7210_calibration.h"
 // #include "Printer.h"
 // #include "utility.h"
 
@@ -21,12 +26,12 @@
 #define REG_DSPSIGM 0xC1U // Dspsigm[0:7]
 #define REG_DSPSIGL 0xC2U // Dspsigl[0:7]
 #define REG_0XC3 0xC3U    // dspsigsel[0:2]
-#define REG_0XC4 0xC4U
+#define REG_0XC4 0xC4U    // sleep[0] ; stop[1] ; oneburst[2] ; usestore[3] ; meas(RO)[7]
 #define REG_0XC5 0xC5U
-#define REG_0XC6 0xC6U
-#define REG_0XC7 0xC7U
-#define REG_0XC8 0xC8U
-#define REG_0XC9 0xC9U
+#define REG_0XC6 0xC6U    // sw_op[0:6] ; sw_low4field[7]
+#define REG_0XC7 0xC7U    // sw_hyst[0:5] ; sw_fieldpolsel[6:7]
+#define REG_0XC8 0xC8U    // sl_time[0:7]
+#define REG_0XC9 0xC9U    // sltimena[0] ; slfast[1]
 #define REG_A0 0xCAU
 #define REG_A1 0xCBU
 #define REG_A2 0xCCU
@@ -40,10 +45,33 @@
 #define REG_0XE4 0xE4U     // tm_fg[0:1]
 
 // Bit masks
+#define CHIPID_SHIFT 4
+#define REVID_MASK 0x0FU
 #define OTP_BUSY_MASK 1
 #define OTP_READ_EN_MASK 2
 #define DF_FIR_MASK 0
 #define DF_IIR_MASK 1
+#define SLEEP_MASK 0x01U
+#define STOP_MASK 0x02U
+#define SLTIMENA_MASK 0x01U
+#define SLFAST_MASK 0x02U
+#define FRESH_MASK 0x80U
+#define SW_LOW4FIELD_MASK 0x80U
+#define SW_OP_MASK 0x7FU
+#define SW_FIELDPOLSEL_SHIFT 6
+#define SW_HYST_MASK 0x3FU
+
+// chipid of every Si7210 part
+#define SI7210_CHIP_ID 0x1U
+
+// OTP addresses of the part's identity
+#define OTP_PART_BASE 0x0BU    // Base part number
+#define OTP_PART_VARIANT 0x0CU // Part variant
+#define OTP_SERIAL 0x18U       // 4 byte serial number, 0x18-0x1B, MSB first
+
+// sw_op and sw_hyst values that mean a threshold/hysteresis of 0
+#define SW_OP_ZERO 127
+#define SW_HYST_ZERO 63
 
 // Possible (bipolar) measurement range settings
 typedef enum class si7210_range_t
@@ -118,6 +146,70 @@ struct Filter
 //     si7210_iir_t IIR
 // } si7210_filters_t;
 
+// Power states
+typedef enum class si7210_power_t
+{
+    ACTIVE,     // Continuously converting
+    IDLE,       // Stopped. Keeps its configuration, resumes with 1 write
+    SLEEP,      // Lowest power. Loses its configuration, see wakeup()
+    SLEEP_TIMER // Sleeps and wakes up on the sleep timer to convert
+} si7210_power_t;
+
+// Which field the switch output compares against the threshold
+// (sw_fieldpolsel)
+typedef enum class si7210_switch_polarity_t
+{
+    ABSOLUTE, // |B|
+    POSITIVE, // B
+    NEGATIVE  // -B
+} si7210_switch_polarity_t;
+
+// Configuration of the sensor's digital switch output, which lets the
+// sensor detect a magnet on-chip instead of the host polling the field.
+typedef struct
+{
+    // Field at which the output switches, in uT. 0 to 19200uT on the 20mT
+    // range, 0 to 192000uT on the 200mT range.
+    int thresholdUt = 0;
+
+    // Hysteresis around the threshold, in uT. 0 to 8960uT on the 20mT range,
+    // 0 to 89600uT on the 200mT range.
+    int hysteresisUt = 0;
+
+    si7210_switch_polarity_t polarity = si7210_switch_polarity_t::ABSOLUTE;
+
+    // If true the output goes low when the field is above the threshold,
+    // else high.
+    bool lowForField = true;
+} si7210_switch_t;
+
+// The block of registers compared/restored by the fast boot path.
+#define CONFIG_IMAGE_FIRST REG_0XC4
+#define CONFIG_IMAGE_SIZE (REG_A5 - REG_0XC4 + 1)
+#define CONFIG_IMAGE_VERSION 1
+
+// A compact copy of a configured sensor's registers, saved with
+// saveConfig() and given back to the constructor on the next boot so the
+// sensor can be brought up without reconfiguring it from scratch. Plain
+// data: store it anywhere (flash, KVStore, EEPROM...).
+typedef struct
+{
+    uint8_t version;
+
+    // The settings the registers were configured for
+    uint8_t range;
+    uint8_t magnet;
+    uint8_t mode;
+    uint8_t filterType;
+    uint8_t burstsize;
+
+    // Registers 0xC4-0xD0
+    uint8_t regs[CONFIG_IMAGE_SIZE];
+
+    // CRC-8 of everything above
+    uint8_t crc;
+} si7210_config_image_t;
+
 // A 8-bit register
 typedef struct
 {
@@ -125,9 +217,12 @@ typedef struct
     uint8_t data;
 } si7210_register_t;
 
+class si7210_command_queue;
+
 class si7210
 {
 public:
+#ifdef __MBED__
     // Constructor
     //
     // @param *i2cBus   The I2C MBED object that the sensor is connected to.
@@ -136,10 +231,49 @@ public:
     // @param addr  The device address. Silicon Labs gives the device
     //                      address in 7-bits (since 8th bit is R/W bit)
     si7210(I2C *i2cBus, uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f);
+#endif
+
+    // Constructor
+    //
+    // @param *bus  The bus the sensor is connected to. Use a
+    //              si7210_bus_client when other devices or threads share
+    //              the bus.
+    // @param addr  The device address. Silicon Labs gives the device
+    //                      address in 7-bits (since 8th bit is R/W bit)
+    si7210(si7210_bus *bus, uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f);
+
+    // Constructor that boots from a saved configuration, see
+    // init(const si7210_config_image_t *).
+    //
+    // @param *image    Configuration saved with saveConfig() on a previous
+    //                  boot. May be NULL.
+    si7210(si7210_bus *bus, uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f,
+           const si7210_config_image_t *image);
     ~si7210();
 
     void init();
 
+    // Fast boot. Reads the sensor's configuration registers in one burst and
+    // compares them against a saved image. If the sensor is already
+    // configured (e.g. only the MCU was reset) nothing is written. If not,
+    // only the registers that differ are written, from the image, in as few
+    // burst writes as possible and without any OTP reads. Falls back to
+    // init() if the image is missing, corrupt or for other settings.
+    //
+    // @param *image    Configuration saved with saveConfig(). May be NULL.
+    // @return          True if the image was used, false if init() was.
+    bool init(const si7210_config_image_t *image);
+
+    // Saves the sensor's current configuration for init(image) on the next
+    // boot. Call after the sensor is configured.
+    //
+    // @param *image    Where to store the configuration.
+    // @return          True on success. False on failure.
+    bool saveConfig(si7210_config_image_t *image);
+
+    // @return  True if image is intact (version and CRC check out).
+    static bool checkConfig(const si7210_config_image_t *image);
+
     // Reads a register (1byte) from the device's read/write I2C registers.
     // This is different from the OTP (one time programmable) register
     // which can only be read from through the I2C registers.
@@ -158,26 +292,91 @@ public:
     // @return      True on success. False on failure.
     bool writeRegister(uint8_t reg, uint8_t data);
 
+    // Reads consecutive registers in one transaction (the register address
+    // auto increments).
+    //
+    // @param reg   8-bit address of the first register.
+    // @param *data Where to store the data read.
+    // @param len   Number of registers to read.
+    // @return      True on success. False on failure.
+    bool readRegisters(uint8_t reg, uint8_t *data, size_t len);
+
+    // Writes consecutive registers in one transaction (the register address
+    // auto increments).
+    //
+    // @param reg   8-bit address of the first register.
+    // @param *data The data to write.
+    // @param len   Number of registers to write. At most 16.
+    // @return      True on success. False on failure.
+    bool writeRegisters(uint8_t reg, const uint8_t *data, size_t len);
+
     // @return  The sensor's chipid. This is 0x1 for all Si7210 parts.
     uint8_t getChipId();
 
     // @return  The sensor's revid. This is 0x4 for revision B
     uint8_t getRevId();
 
-    // Checks if the sensor is connected and responding.
+    // Checks if the sensor is connected and responding, and is a Si7210
+    // (any revision).
     //
     // @return  True if connected and responding, else false.
     bool checkGood();
 
+    // Puts the sensor in sleep mode. Same as setPowerState(SLEEP).
+    //
+    // @return  True on success. False on failure.
     bool sleep();
 
+    // Wakes the sensor from sleep mode, restores the configuration it lost
+    // while asleep (from the driver's cached register values, no OTP reads)
+    // and returns it to the power state it was in before sleep(). Then waits
+    // up to 2 ms for the first fresh sample, without holding the bus between
+    // polls; see getWakeLatencyUs().
+    //
+    // @return  True if the sensor woke up and produced a fresh sample.
     bool wakeup();
 
+    // Moves the sensor to another power state, only writing the registers
+    // whose cached values have to change.
+    //
+    // @param s         The new power state.
+    // @param slTime    The raw sl_time value (sleep timer period) to use
+    //                  for SLEEP_TIMER. Ignored for other states.
+    // @return          True on success. False on failure.
+    bool setPowerState(si7210_power_t s, uint8_t slTime = 0);
+
+    // @return  The power state the sensor is in.
+    si7210_power_t getPowerState() { return powerState; }
+
+    // @return  Time from the start of the last wakeup() until the sensor had
+    //          a fresh sample, in usecs.
+    uint32_t getWakeLatencyUs() { return wakeLatencyUs; }
+
     // Returns the field strength in uT measured by the sensor
     //
-    // @return  The measured field strength in uTs
+    // @return  The measured field strength in uTs, calibrated if a
+    //          calibration is set.
     int getFieldStrength();
 
+    // Reads a measurement in one transaction (dspsigm and dspsigl back to
+    // back), for continuous readout. Converted and calibrated the same as
+    // getFieldStrength().
+    //
+    // @param *fieldUt  Where to store the field strength in uT.
+    // @param *fresh    If not NULL, set to whether this is a new
+    //                  measurement since the last read.
+    // @return          True on success. False on failure.
+    bool readSample(int *fieldUt, bool *fresh = NULL);
+
+    // Sets the calibration getFieldStrength() applies.
+    //
+    // @param *cal  The calibration. Not copied, so must outlive the sensor
+    //              or be replaced. NULL for raw readings.
+    void setCalibration(const si7210_cal_t *cal) { calibration = cal; }
+
+    // @return  The calibration getFieldStrength() applies. NULL if none.
+    const si7210_cal_t *getCalibration() { return calibration; }
+
     // Sets the sensor to continuous conversion mode where the AFE (analog
     // front end) runs continuously and a new sample is taken every 8.8usec.
     //
@@ -185,14 +384,55 @@ public:
     bool setMode(si7210_mode_t m);
 
     // Read out the I2C registers
-    vector<si7210_register_t> i2cMemDump();
+    std::vector<si7210_register_t> i2cMemDump();
+
+    // Programs the digital switch output. The thresholds are rounded to the
+    // nearest values the sensor can represent for the current range.
+    //
+    // @param sw            The requested switch configuration.
+    // @param *effective    If not NULL, the configuration actually
+    //                      programmed, read back from the sensor.
+    // @return              True on success. False on failure.
+    bool setSwitch(si7210_switch_t sw, si7210_switch_t *effective = NULL);
+
+    // Reads back the digital switch configuration.
+    //
+    // @param *sw   Where to store the configuration.
+    // @return      True on success. False on failure, or if the sensor holds
+    //              the reserved sw_fieldpolsel value.
+    bool getSwitch(si7210_switch_t *sw);
+
+    // sw_op encoding. The threshold is (16 + sw_op[3:0]) * 2^sw_op[6:4]
+    // units of 5uT (20mT range) or 50uT (200mT range). sw_op = 127 is 0.
+    //
+    // @return  The sw_op value whose threshold is nearest to thresholdUt.
+    static uint8_t encodeSwOp(int thresholdUt, si7210_range_t r);
+
+    // @return  The threshold in uT that sw_op represents.
+    static int decodeSwOp(uint8_t swOp, si7210_range_t r);
+
+    // sw_hyst encoding. The hysteresis is (8 + sw_hyst[2:0]) *
+    // 2^sw_hyst[5:3] units of 5uT (20mT range) or 50uT (200mT range).
+    // sw_hyst = 63 is 0.
+    //
+    // @return  The sw_hyst value whose hysteresis is nearest to
+    //          hysteresisUt.
+    static uint8_t encodeSwHyst(int hysteresisUt, si7210_range_t r);
+
+    // @return  The hysteresis in uT that sw_hyst represents.
+    static int decodeSwHyst(uint8_t swHyst, si7210_range_t r);
 
 private:
-    // The I2C bus that this sensor is attached to.
+    // The bus that this sensor is attached to.
     // Pointer so that other I2C devices can use the same bus.
     // Not a reference (&) b/c references cannot be reassigned after
     // initialization, but pointers can be reassigned.
-    I2C *i2c;
+    si7210_bus *bus;
+
+#ifdef __MBED__
+    // Wraps the MBED I2C object when constructed with one. bus points here.
+    si7210_mbed_bus mbedBus;
+#endif
 
     // The sensor's 7 bit device address.
     uint8_t devAddr7Bit;
@@ -213,6 +453,52 @@ private:
     // Filter
     Filter filter;
 
+    // The power state the sensor is in, and the one to go back to on
+    // wakeup().
+    si7210_power_t powerState;
+    si7210_power_t wakeState;
+    uint32_t wakeLatencyUs;
+
+    // Last value written to/read from each of the registers 0xC0-0xD0, so
+    // configuration can be restored and read-modify-writes don't need the
+    // read. Bit n of shadowValid is set once shadow[n] is known, bit n of
+    // shadowWritten once the driver has written register 0xC0+n.
+    uint8_t shadow[REG_A5 - REG_0XC0 + 1];
+    uint32_t shadowValid;
+    uint32_t shadowWritten;
+
+    // Applied to each reading. NULL if none.
+    const si7210_cal_t *calibration;
+
+    // While set, readRegister()/writeRegister() go through this queue.
+    si7210_command_queue *queue;
+    friend class si7210_command_queue;
+
+    // Waits for the fresh sample after wake() itself, without blocking.
+    friend class si7210_async;
+
+    // Common constructor code
+    void setup(uint8_t addr, si7210_range_t r, si7210_magnet_t mag, si7210_mode_t m, Filter f);
+
+    // The first part of wakeup(): wakes the sensor, restores its
+    // configuration and returns it to wakeState, without waiting for a
+    // fresh sample.
+    //
+    // @return  True on success. False on failure.
+    bool wake();
+
+    // Converts dspsigm/dspsigl to a calibrated field strength in uT.
+    int convert(uint8_t dspsigm, uint8_t dspsigl);
+
+    // Updates the cached value of a register.
+    void cache(uint8_t reg, uint8_t data, bool written);
+
+    // Reads a register from the cache, or from the sensor if not cached.
+    bool readCached(uint8_t reg, uint8_t *data);
+
+    // Writes a register only if its cached value is different.
+    bool writeCached(uint8_t reg, uint8_t data);
+
     // Sets the range of the sensor
     // RANGE_20mT = +-20mT
     // RANGE_200mT = +-200mT
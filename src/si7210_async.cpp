@@ -0,0 +1,256 @@
+// File: si7210_async.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: C++20 coroutine API for the host build. Awaitable versions of
+// the sensor's sample and configuration operations, run by a single
+// threaded event loop, so one thread can drive many sensors.
+
+#include "si7210_async.h"
+
+#if defined(__cpp_impl_coroutine) && !defined(__MBED__)
+
+#include <chrono>
+#include <thread>
+#include <utility>
+
+// The coroutine spawn() wraps each task in. Suspends at the start so run()
+// starts it, and at the end so the loop can tell it finished and destroy
+// it.
+struct si7210_spawned_t
+{
+    struct promise_type
+    {
+        si7210_spawned_t get_return_object()
+        {
+            si7210_spawned_t s;
+            s.handle = std::coroutine_handle<promise_type>::from_promise(*this);
+            return s;
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+static uint64_t steadyNow(void *)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void steadySleepUntil(void *context, uint64_t us)
+{
+    uint64_t now = steadyNow(context);
+    if (us > now)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us - now));
+    }
+}
+
+const si7210_loop_clock_t si7210_loop_clock = {steadyNow, steadySleepUntil, NULL};
+
+bool si7210_sleep_awaiter::await_ready()
+{
+    return !yield && deadlineUs <= loop->nowUs();
+}
+
+void si7210_sleep_awaiter::await_suspend(std::coroutine_handle<> h)
+{
+    if (yield)
+    {
+        loop->schedule(h);
+    }
+    else
+    {
+        loop->scheduleAt(deadlineUs, h);
+    }
+}
+
+si7210_event_loop::si7210_event_loop(const si7210_loop_clock_t *c)
+{
+    clock = c != NULL ? c : &si7210_loop_clock;
+    sequence = 0;
+    live = 0;
+    stopping = false;
+}
+
+si7210_event_loop::~si7210_event_loop()
+{
+    // Destroying a spawned coroutine destroys the task (and whatever it is
+    // awaiting) with it
+    for (size_t i = 0; i < spawned.size(); i++)
+    {
+        spawned[i].destroy();
+    }
+}
+
+si7210_spawned_t si7210_event_loop::runSpawned(si7210_event_loop *loop, si7210_task<void> task)
+{
+    co_await task;
+    loop->live--;
+}
+
+void si7210_event_loop::spawn(si7210_task<void> task)
+{
+    // Clear out finished tasks once they're half of the list
+    if (spawned.size() >= 2 * live + 16)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < spawned.size(); i++)
+        {
+            if (spawned[i].done())
+            {
+                spawned[i].destroy();
+            }
+            else
+            {
+                spawned[kept++] = spawned[i];
+            }
+        }
+        spawned.resize(kept);
+    }
+
+    si7210_spawned_t s = runSpawned(this, std::move(task));
+    spawned.push_back(s.handle);
+    live++;
+    schedule(s.handle);
+}
+
+void si7210_event_loop::scheduleAt(uint64_t us, std::coroutine_handle<> h)
+{
+    pending_timer_t t;
+    t.deadlineUs = us;
+    t.sequence = sequence++;
+    t.handle = h;
+    timers.push(t);
+}
+
+void si7210_event_loop::run()
+{
+    stopping = false;
+
+    while (live > 0 && !stopping)
+    {
+        // Due timers join the back of the ready queue, so coroutines that
+        // keep yielding can't hold them up
+        if (!timers.empty())
+        {
+            uint64_t now = nowUs();
+            if (ready.empty() && timers.top().deadlineUs > now)
+            {
+                clock->sleepUntil(clock->context, timers.top().deadlineUs);
+                now = nowUs();
+            }
+            while (!timers.empty() && timers.top().deadlineUs <= now)
+            {
+                ready.push(timers.top().handle);
+                timers.pop();
+            }
+        }
+
+        if (ready.empty())
+        {
+            if (timers.empty())
+            {
+                // Everything left is waiting on something outside the loop
+                break;
+            }
+            continue;
+        }
+
+        std::coroutine_handle<> h = ready.front();
+        ready.pop();
+        h.resume();
+    }
+}
+
+si7210_task<si7210_async_reading_t> si7210_async::readField()
+{
+    si7210_async_reading_t reading;
+    reading.ok = false;
+    reading.timestampUs = 0;
+    reading.fieldUt = 0;
+
+    for (int i = 0; i < SI7210_ASYNC_POLL_LIMIT; i++)
+    {
+        bool fresh;
+        if (!hall->readSample(&reading.fieldUt, &fresh))
+        {
+            co_return reading;
+        }
+
+        if (fresh)
+        {
+            reading.ok = true;
+            reading.timestampUs = si7210_micros();
+            co_return reading;
+        }
+
+        co_await events->sleepFor(SI7210_ASYNC_POLL_US);
+    }
+
+    co_return reading;
+}
+
+si7210_task<bool> si7210_async::setMode(si7210_mode_t m)
+{
+    co_return hall->setMode(m);
+}
+
+si7210_task<bool> si7210_async::setPowerState(si7210_power_t s, uint8_t slTime)
+{
+    // Leaving sleep is a wakeup(), which mustn't block the loop
+    if (hall->getPowerState() == si7210_power_t::SLEEP && s != si7210_power_t::SLEEP)
+    {
+        hall->wakeState = s;
+        co_return co_await wakeup();
+    }
+
+    co_return hall->setPowerState(s, slTime);
+}
+
+si7210_task<bool> si7210_async::setSwitch(si7210_switch_t sw)
+{
+    co_return hall->setSwitch(sw);
+}
+
+si7210_task<bool> si7210_async::sleep()
+{
+    co_return hall->sleep();
+}
+
+si7210_task<bool> si7210_async::wakeup()
+{
+    uint32_t start = si7210_micros();
+    bool ok = hall->wake();
+
+    // Other coroutines run while the sensor takes its first measurement.
+    // It may not answer at first, so failed reads are polled again too.
+    if (ok && hall->getPowerState() == si7210_power_t::ACTIVE)
+    {
+        bool fresh = false;
+        for (int i = 0; i < SI7210_ASYNC_POLL_LIMIT; i++)
+        {
+            int fieldUt;
+            if (hall->readSample(&fieldUt, &fresh) && fresh)
+            {
+                break;
+            }
+            fresh = false;
+            co_await events->sleepFor(SI7210_ASYNC_POLL_US);
+        }
+        ok = fresh;
+    }
+
+    hall->wakeLatencyUs = si7210_micros() - start;
+    co_return ok;
+}
+
+#endif
@@ -0,0 +1,317 @@
+// File: si7210_async.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: C++20 coroutine API for the host build. Awaitable versions of
+// the sensor's sample and configuration operations, run by a single
+// threaded event loop, so one thread can drive many sensors.
+
+#ifndef SI7210_ASYNC_H
+#define SI7210_ASYNC_H
+
+// Needs a C++20 compiler (-std=gnu++20). Not built for MBED.
+#if defined(__cpp_impl_coroutine) && !defined(__MBED__)
+
+#include <coroutine>
+#include <exception>
+#include <queue>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "si7210.h"
+
+// Time between polls of dspsigm while waiting for a fresh measurement in
+// usecs, and the number of polls before giving up.
+#define SI7210_ASYNC_POLL_US 20
+#define SI7210_ASYNC_POLL_LIMIT 100
+
+// Promise code shared by every si7210_task<T>.
+class si7210_task_promise_base
+{
+public:
+    // The coroutine co_awaiting this one, resumed when it finishes. Empty
+    // for a task the loop started.
+    std::coroutine_handle<> continuation;
+
+    // Tasks start when first awaited
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct final_awaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            std::coroutine_handle<> c = h.promise().continuation;
+            return c ? c : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    // Builds without exceptions, like the rest of the driver
+    void unhandled_exception() { std::terminate(); }
+};
+
+// A coroutine returning T. Runs when co_awaited and resumes the awaiting
+// coroutine directly when it finishes, without going through the loop.
+template <typename T>
+class si7210_task
+{
+public:
+    struct promise_type : si7210_task_promise_base
+    {
+        T value;
+
+        si7210_task get_return_object() { return si7210_task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_value(T v) { value = v; }
+    };
+
+    si7210_task(si7210_task &&other) noexcept : coro(other.coro) { other.coro = nullptr; }
+    ~si7210_task()
+    {
+        if (coro)
+        {
+            coro.destroy();
+        }
+    }
+
+    bool await_ready() { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+    {
+        coro.promise().continuation = awaiting;
+        return coro;
+    }
+
+    T await_resume() { return coro.promise().value; }
+
+private:
+    std::coroutine_handle<promise_type> coro;
+
+    explicit si7210_task(std::coroutine_handle<promise_type> h) : coro(h) {}
+
+    si7210_task(const si7210_task &);
+    si7210_task &operator=(const si7210_task &);
+};
+
+template <>
+class si7210_task<void>
+{
+public:
+    struct promise_type : si7210_task_promise_base
+    {
+        si7210_task get_return_object() { return si7210_task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_void() {}
+    };
+
+    si7210_task(si7210_task &&other) noexcept : coro(other.coro) { other.coro = nullptr; }
+    ~si7210_task()
+    {
+        if (coro)
+        {
+            coro.destroy();
+        }
+    }
+
+    bool await_ready() { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)
+    {
+        coro.promise().continuation = awaiting;
+        return coro;
+    }
+
+    void await_resume() {}
+
+private:
+    std::coroutine_handle<promise_type> coro;
+
+    explicit si7210_task(std::coroutine_handle<promise_type> h) : coro(h) {}
+
+    si7210_task(const si7210_task &);
+    si7210_task &operator=(const si7210_task &);
+};
+
+class si7210_event_loop;
+struct si7210_spawned_t;
+
+// The clock an event loop runs on. Replaceable so the loop can run on
+// simulated time. context is passed back to every call.
+typedef struct
+{
+    // @return  A steady microsecond count.
+    uint64_t (*now)(void *context);
+
+    // Returns once now() has reached us.
+    void (*sleepUntil)(void *context, uint64_t us);
+    void *context;
+} si7210_loop_clock_t;
+
+// std::chrono::steady_clock, sleeping the calling thread.
+extern const si7210_loop_clock_t si7210_loop_clock;
+
+// co_await loop.sleepUntil()/sleepFor()/yield()
+class si7210_sleep_awaiter
+{
+public:
+    si7210_sleep_awaiter(si7210_event_loop *l, uint64_t us, bool y) : loop(l), deadlineUs(us), yield(y) {}
+
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume() {}
+
+private:
+    si7210_event_loop *loop;
+    uint64_t deadlineUs;
+    bool yield;
+};
+
+// Runs coroutines on the calling thread. A coroutine waiting for a timer
+// costs nothing until it's due; when none are ready the thread sleeps until
+// the next timer (on the loop's clock).
+//
+// Bus transfers are still synchronous: the loop runs other coroutines
+// between a sensor's transactions and while it waits (for the next sample
+// period, a fresh measurement, ...), not while one is on the bus.
+//
+// Not thread safe. Create, spawn and run from one thread.
+//
+// Example:
+//      si7210_task<void> sample(si7210_event_loop *loop, si7210_async *sensor)
+//      {
+//          for (;;)
+//          {
+//              si7210_async_reading_t r = co_await sensor->readField();
+//              ...
+//              co_await loop->sleepFor(1000);
+//          }
+//      }
+//
+//      si7210_event_loop loop;
+//      si7210_async sensor(&hall, &loop);
+//      loop.spawn(sample(&loop, &sensor));
+//      loop.run();
+class si7210_event_loop
+{
+public:
+    // @param *clock  The clock to run on. NULL for the steady clock.
+    si7210_event_loop(const si7210_loop_clock_t *clock = NULL);
+
+    // Destroys any tasks that haven't finished.
+    ~si7210_event_loop();
+
+    // Starts a task. It first runs from run().
+    void spawn(si7210_task<void> task);
+
+    // Runs until every spawned task has finished or stop() is called.
+    void run();
+
+    // Makes run() return once the running coroutine suspends.
+    void stop() { stopping = true; }
+
+    // @return  The loop's clock, a steady microsecond count.
+    uint64_t nowUs() { return clock->now(clock->context); }
+
+    // Awaitables that resume the coroutine at (or after) a time, after a
+    // delay, or after the other ready coroutines have run.
+    si7210_sleep_awaiter sleepUntil(uint64_t us) { return si7210_sleep_awaiter(this, us, false); }
+    si7210_sleep_awaiter sleepFor(uint32_t us) { return si7210_sleep_awaiter(this, nowUs() + us, false); }
+    si7210_sleep_awaiter yield() { return si7210_sleep_awaiter(this, 0, true); }
+
+    // Queues a suspended coroutine to be resumed.
+    void schedule(std::coroutine_handle<> h) { ready.push(h); }
+
+    // Resumes a suspended coroutine once the loop's clock reaches us.
+    void scheduleAt(uint64_t us, std::coroutine_handle<> h);
+
+    // @return  Number of spawned tasks that haven't finished.
+    size_t tasks() { return live; }
+
+private:
+    typedef struct
+    {
+        uint64_t deadlineUs;
+
+        // Keeps timers with the same deadline in order
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+    } pending_timer_t;
+
+    struct later
+    {
+        bool operator()(const pending_timer_t &a, const pending_timer_t &b) const
+        {
+            return a.deadlineUs != b.deadlineUs ? a.deadlineUs > b.deadlineUs : a.sequence > b.sequence;
+        }
+    };
+
+    const si7210_loop_clock_t *clock;
+    std::queue<std::coroutine_handle<>> ready;
+    std::priority_queue<pending_timer_t, std::vector<pending_timer_t>, later> timers;
+    uint64_t sequence;
+
+    // The coroutines spawn() started, destroyed once finished (in batches)
+    // or with the loop
+    std::vector<std::coroutine_handle<>> spawned;
+    size_t live;
+    bool stopping;
+
+    // Runs a spawned task and counts it finished
+    static si7210_spawned_t runSpawned(si7210_event_loop *loop, si7210_task<void> task);
+
+    // Copying would resume the coroutines twice.
+    si7210_event_loop(const si7210_event_loop &);
+    si7210_event_loop &operator=(const si7210_event_loop &);
+};
+
+// A reading from si7210_async::readField().
+typedef struct
+{
+    // False if the sensor didn't answer or never had a fresh measurement.
+    bool ok;
+
+    // si7210_micros() when the reading's bus transaction completed.
+    uint32_t timestampUs;
+
+    // The field strength in uT, calibrated if the sensor has a calibration.
+    int fieldUt;
+} si7210_async_reading_t;
+
+// Awaitable operations on a si7210, run by an event loop.
+class si7210_async
+{
+public:
+    // @param *sensor   The sensor. Not owned.
+    // @param *loop     The loop that runs the operations. Not owned.
+    si7210_async(si7210 *sensor, si7210_event_loop *loop) : hall(sensor), events(loop) {}
+
+    // Reads a fresh measurement. While the sensor only has the last one
+    // (e.g. just after waking up) other coroutines run between polls.
+    si7210_task<si7210_async_reading_t> readField();
+
+    // Same as the si7210 methods.
+    si7210_task<bool> setMode(si7210_mode_t m);
+    si7210_task<bool> setPowerState(si7210_power_t s, uint8_t slTime = 0);
+    si7210_task<bool> setSwitch(si7210_switch_t sw);
+    si7210_task<bool> sleep();
+
+    // Same as si7210::wakeup(), but other coroutines run while it waits for
+    // the first fresh sample. Leaving sleep through setPowerState() waits
+    // the same way.
+    si7210_task<bool> wakeup();
+
+    si7210 *sensor() { return hall; }
+
+private:
+    si7210 *hall;
+    si7210_event_loop *events;
+};
+
+#endif
+
+#endif //SI7210_ASYNC_H
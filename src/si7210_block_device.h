@@ -0,0 +1,77 @@
+// File: si7210_block_device.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: The storage layer used by the sample log: a minimal flash
+// block device interface and its MBED BlockDevice backend.
+
+#ifndef SI7210_BLOCK_DEVICE_H
+#define SI7210_BLOCK_DEVICE_H
+
+#include <stdint.h>
+
+#ifdef __MBED__
+#include "mbed.h"
+#include "BlockDevice.h"
+#endif
+
+// A flash-like storage device. Erasing sets a whole erase block to
+// erasedValue(); programming can only be done on erased memory, in
+// multiples of programSize().
+class si7210_block_device
+{
+public:
+    virtual ~si7210_block_device() {}
+
+    // @return  True on success. False on failure.
+    virtual bool read(void *buf, uint32_t addr, uint32_t len) = 0;
+
+    // @param addr  Multiple of programSize().
+    // @param len   Multiple of programSize().
+    // @return      True on success. False on failure.
+    virtual bool program(const void *buf, uint32_t addr, uint32_t len) = 0;
+
+    // @param addr  Multiple of eraseSize().
+    // @param len   Multiple of eraseSize().
+    // @return      True on success. False on failure.
+    virtual bool erase(uint32_t addr, uint32_t len) = 0;
+
+    virtual uint32_t programSize() = 0;
+    virtual uint32_t eraseSize() = 0;
+    virtual uint32_t size() = 0;
+
+    // @return  The value of erased bytes.
+    virtual uint8_t erasedValue() { return 0xFF; }
+};
+
+#ifdef __MBED__
+// MBED BlockDevice backend (e.g. FlashIAPBlockDevice, SPIFBlockDevice).
+class si7210_mbed_block_device : public si7210_block_device
+{
+public:
+    // @param *device   The block device. Not owned. Must be init()ed.
+    si7210_mbed_block_device(mbed::BlockDevice *device) : bd(device) {}
+
+    bool read(void *buf, uint32_t addr, uint32_t len) { return bd->read(buf, addr, len) == 0; }
+    bool program(const void *buf, uint32_t addr, uint32_t len) { return bd->program(buf, addr, len) == 0; }
+    bool erase(uint32_t addr, uint32_t len) { return bd->erase(addr, len) == 0; }
+    uint32_t programSize() { return (uint32_t)bd->get_program_size(); }
+    uint32_t eraseSize() { return (uint32_t)bd->get_erase_size(); }
+    uint32_t size() { return (uint32_t)bd->size(); }
+
+    // Devices without a consistent erase value (get_erase_value() < 0)
+    // still work, but torn records can't be told from empty ones so
+    // recovery skips to the next erase block.
+    uint8_t erasedValue()
+    {
+        int value = bd->get_erase_value();
+        return value < 0 ? 0xFF : (uint8_t)value;
+    }
+
+private:
+    mbed::BlockDevice *bd;
+};
+#endif
+
+#endif //SI7210_BLOCK_DEVICE_H
@@ -0,0 +1,216 @@
+// File: si7210_bus.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: The I2C bus layer used by the si7210 driver, and a bus manager
+// that lets several drivers (and threads) share one I2C bus.
+
+#include "si7210_bus.h"
+#include <string.h>
+
+#ifdef __MBED__
+#define TRANSFER_DONE_FLAG 0x1U
+
+bool si7210_mbed_bus::transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+#if DEVICE_I2C_ASYNCH
+    if (asyncTransfers)
+    {
+        // Write, repeated start and read all happen in the background.
+        // I2C::transfer() is refused while another async transfer is
+        // running.
+        rtos::ThisThread::flags_clear(TRANSFER_DONE_FLAG);
+        waiter = rtos::ThisThread::get_id();
+        transferEvent = 0;
+        if (i2c->transfer(addr8, (const char *)tx, (int)txLen, (char *)rx, (int)rxLen,
+                          event_callback_t(this, &si7210_mbed_bus::onTransfer), I2C_EVENT_ALL) != 0)
+        {
+            return false;
+        }
+
+        rtos::ThisThread::flags_wait_any(TRANSFER_DONE_FLAG);
+        return (transferEvent & I2C_EVENT_TRANSFER_COMPLETE) &&
+               !(transferEvent & (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK));
+    }
+#endif
+
+    // Hold the bus so nothing else gets in between the write and the
+    // repeated start read.
+    i2c->lock();
+
+    // Repeated start is true (doesn't send stop bit) when a read follows.
+    bool ok = i2c->write(addr8, (const char *)tx, txLen, rxLen > 0) == 0;
+
+    if (ok && rxLen > 0)
+    {
+        ok = i2c->read(addr8, (char *)rx, rxLen, false) == 0;
+    }
+
+    i2c->unlock();
+    return ok;
+}
+
+#if DEVICE_I2C_ASYNCH
+// Transfer complete/error interrupt
+void si7210_mbed_bus::onTransfer(int event)
+{
+    transferEvent = event;
+    osThreadFlagsSet(waiter, TRANSFER_DONE_FLAG);
+}
+#endif
+#endif
+
+si7210_bus_manager::si7210_bus_manager(si7210_bus *backend)
+{
+    bus = backend;
+#ifdef __MBED__
+    ownedI2c = NULL;
+    ownedBus = NULL;
+#endif
+    busy = false;
+    memset(waiting, 0, sizeof(waiting));
+    acquiredAt = 0;
+    resetStats();
+}
+
+#ifdef __MBED__
+si7210_bus_manager::si7210_bus_manager(PinName sda, PinName scl, int hz)
+{
+    ownedI2c = new I2C(sda, scl);
+    ownedI2c->frequency(hz);
+    ownedBus = new si7210_mbed_bus(ownedI2c);
+    bus = ownedBus;
+    busy = false;
+    memset(waiting, 0, sizeof(waiting));
+    acquiredAt = 0;
+    resetStats();
+}
+#endif
+
+si7210_bus_manager::~si7210_bus_manager()
+{
+#ifdef __MBED__
+    delete ownedBus;
+    delete ownedI2c;
+#endif
+}
+
+void si7210_bus_manager::acquire(si7210_priority_t p)
+{
+    int prio = (int)p;
+    uint32_t start = si7210_micros();
+
+    monitor.lock();
+    waiting[prio]++;
+
+    while (true)
+    {
+        // Wait behind anyone with a higher priority, so the sample path
+        // gets the bus next even if config traffic queued first.
+        bool higherWaiting = false;
+        for (int i = 0; i < prio; i++)
+        {
+            if (waiting[i] > 0)
+            {
+                higherWaiting = true;
+            }
+        }
+
+        if (!busy && !higherWaiting)
+        {
+            break;
+        }
+
+        monitor.wait();
+    }
+
+    waiting[prio]--;
+    busy = true;
+    acquiredAt = si7210_micros();
+
+    uint32_t waited = acquiredAt - start;
+    stats.acquisitions[prio]++;
+    if (waited > stats.maxWaitUs[prio])
+    {
+        stats.maxWaitUs[prio] = waited;
+    }
+
+    monitor.unlock();
+}
+
+void si7210_bus_manager::release()
+{
+    monitor.lock();
+    stats.busyUs += si7210_micros() - acquiredAt;
+    busy = false;
+    monitor.notifyAll();
+    monitor.unlock();
+}
+
+void si7210_bus_manager::getStats(si7210_bus_stats_t *_stats)
+{
+    monitor.lock();
+    *_stats = stats;
+    _stats->elapsedUs = si7210_micros() - statsResetAt;
+    monitor.unlock();
+}
+
+uint32_t si7210_bus_manager::utilisationPermille()
+{
+    si7210_bus_stats_t s;
+    getStats(&s);
+
+    if (s.elapsedUs == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t)((s.busyUs * 1000) / s.elapsedUs);
+}
+
+void si7210_bus_manager::resetStats()
+{
+    monitor.lock();
+    memset(&stats, 0, sizeof(stats));
+    statsResetAt = si7210_micros();
+    monitor.unlock();
+}
+
+si7210_bus_client::si7210_bus_client(si7210_bus_manager *m, si7210_priority_t p)
+{
+    manager = m;
+    priority = p;
+    depth = 0;
+}
+
+bool si7210_bus_client::transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    // Already holding the bus from lock()
+    if (depth > 0)
+    {
+        return manager->backend()->transfer(addr8, tx, txLen, rx, rxLen);
+    }
+
+    manager->acquire(priority);
+    bool ok = manager->backend()->transfer(addr8, tx, txLen, rx, rxLen);
+    manager->release();
+
+    return ok;
+}
+
+void si7210_bus_client::lock(si7210_priority_t p)
+{
+    if (depth++ == 0)
+    {
+        manager->acquire(p);
+    }
+}
+
+void si7210_bus_client::unlock()
+{
+    if (--depth == 0)
+    {
+        manager->release();
+    }
+}
@@ -0,0 +1,202 @@
+// File: si7210_bus.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: The I2C bus layer used by the si7210 driver, and a bus manager
+// that lets several drivers (and threads) share one I2C bus.
+
+#ifndef SI7210_BUS_H
+#define SI7210_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "si7210_platform.h"
+
+// Bus access priorities. Lower values win when several users are waiting
+// for the bus.
+typedef enum class si7210_priority_t
+{
+    SAMPLE,    // Reading measurements
+    CONFIG,    // Configuring the sensor
+    DIAGNOSTIC // Register dumps and other bulk, non time critical traffic
+} si7210_priority_t;
+
+#define SI7210_NUM_PRIORITIES 3
+
+// An I2C bus the driver can talk over.
+class si7210_bus
+{
+public:
+    virtual ~si7210_bus() {}
+
+    // Performs one complete I2C transaction:
+    // START | DeviceAddress | W | tx[0..txLen-1]
+    // and then, if rxLen is not 0,
+    // | Sr=repeated start | DeviceAddress | R | rx[0..rxLen-1] | NACK
+    // followed by STOP.
+    //
+    // @param addr8     The 8 bit device address (7 bit address << 1).
+    // @param *tx       The bytes to write.
+    // @param txLen     The number of bytes to write.
+    // @param *rx       Where to store the bytes read. May be NULL if rxLen
+    //                  is 0.
+    // @param rxLen     The number of bytes to read.
+    // @return          True on success (every byte ACKed). False on failure.
+    virtual bool transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) = 0;
+
+    // Holds the bus so that several transfer()s happen back to back with no
+    // other user's transactions in between. Calls may be nested; the bus is
+    // released by the outermost unlock().
+    //
+    // @param p     The priority to wait for the bus with.
+    virtual void lock(si7210_priority_t = si7210_priority_t::CONFIG) {}
+
+    virtual void unlock() {}
+};
+
+// Holds a bus for the lifetime of the object.
+class si7210_bus_lock
+{
+public:
+    si7210_bus_lock(si7210_bus *b, si7210_priority_t p = si7210_priority_t::CONFIG) : bus(b) { bus->lock(p); }
+    ~si7210_bus_lock() { bus->unlock(); }
+
+private:
+    si7210_bus *bus;
+};
+
+#ifdef __MBED__
+// MBED I2C backend.
+class si7210_mbed_bus : public si7210_bus
+{
+public:
+    // @param *i2cBus   The MBED I2C object to talk over. Not owned.
+    // @param async     On targets with asynchronous I2C (DEVICE_I2C_ASYNCH),
+    //                  run each transfer() in the background and block the
+    //                  calling thread until it completes, instead of
+    //                  polling every byte. Other threads get the CPU while
+    //                  the bytes are on the bus.
+    si7210_mbed_bus(I2C *i2cBus = NULL, bool async = false) : i2c(i2cBus), asyncTransfers(async) {}
+
+    bool transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+    void lock(si7210_priority_t = si7210_priority_t::CONFIG) { i2c->lock(); }
+    void unlock() { i2c->unlock(); }
+
+private:
+    I2C *i2c;
+    bool asyncTransfers;
+
+#if DEVICE_I2C_ASYNCH
+    // The thread waiting for the async transfer, signalled with a thread
+    // flag from the transfer complete interrupt. Thread flags rather than an
+    // EventFlags member keep the bus (and si7210) copyable.
+    osThreadId_t waiter;
+    volatile int transferEvent;
+
+    void onTransfer(int event);
+#endif
+};
+#endif
+
+// Bus usage statistics kept by si7210_bus_manager.
+typedef struct
+{
+    // Number of times the bus was acquired at each priority.
+    uint32_t acquisitions[SI7210_NUM_PRIORITIES];
+
+    // Longest time spent waiting for the bus at each priority in usecs.
+    uint32_t maxWaitUs[SI7210_NUM_PRIORITIES];
+
+    // Time the bus was held in usecs.
+    uint64_t busyUs;
+
+    // Time since the statistics were reset in usecs.
+    uint64_t elapsedUs;
+} si7210_bus_stats_t;
+
+// Owns one bus and serialises whole transactions (or locked sequences of
+// transactions) from any number of si7210_bus_client's, in priority order.
+//
+// Example:
+//      si7210_bus_manager manager(PA_10, PA_9, 1000000);
+//      si7210_bus_client sampleBus(&manager, si7210_priority_t::SAMPLE);
+//      si7210 hall(&sampleBus, 0x31, ...);
+class si7210_bus_manager
+{
+public:
+    // @param *backend  The bus to arbitrate access to. Not owned.
+    si7210_bus_manager(si7210_bus *backend);
+
+#ifdef __MBED__
+    // Creates and owns an MBED I2C bus.
+    //
+    // @param sda   I2C data pin.
+    // @param scl   I2C clock pin.
+    // @param hz    I2C bus frequency.
+    si7210_bus_manager(PinName sda, PinName scl, int hz);
+#endif
+
+    ~si7210_bus_manager();
+
+    // Waits until the bus is free and no higher priority user is waiting,
+    // then takes it.
+    void acquire(si7210_priority_t p);
+
+    // Gives the bus back.
+    void release();
+
+    // @return  The bus the manager arbitrates.
+    si7210_bus *backend() { return bus; }
+
+    // Copies out the usage statistics.
+    void getStats(si7210_bus_stats_t *stats);
+
+    // @return  Percentage*10 of time the bus was held since the last reset.
+    uint32_t utilisationPermille();
+
+    void resetStats();
+
+private:
+    si7210_bus *bus;
+
+#ifdef __MBED__
+    // Set when the manager created the I2C bus itself.
+    I2C *ownedI2c;
+    si7210_mbed_bus *ownedBus;
+#endif
+
+    si7210_monitor monitor;
+    bool busy;
+    uint32_t waiting[SI7210_NUM_PRIORITIES];
+    uint32_t acquiredAt;
+    uint32_t statsResetAt;
+    si7210_bus_stats_t stats;
+
+    // Copying would leave two managers arbitrating one bus.
+    si7210_bus_manager(const si7210_bus_manager &);
+    si7210_bus_manager &operator=(const si7210_bus_manager &);
+};
+
+// One user's handle on a bus owned by a si7210_bus_manager. Give each
+// driver (or thread) its own client.
+class si7210_bus_client : public si7210_bus
+{
+public:
+    // @param *m    The manager that owns the bus.
+    // @param p     The priority used for transfer()s made without lock().
+    si7210_bus_client(si7210_bus_manager *m, si7210_priority_t p = si7210_priority_t::CONFIG);
+
+    bool transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+    void lock(si7210_priority_t p = si7210_priority_t::CONFIG);
+    void unlock();
+
+private:
+    si7210_bus_manager *manager;
+    si7210_priority_t priority;
+
+    // lock() nesting depth
+    int depth;
+};
+
+#endif //SI7210_BUS_H
@@ -0,0 +1,62 @@
+// File: si7210_bytes.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Checksum and little endian helpers shared by the driver's
+// stored images and records. Header only, and builds both for MBED and on
+// the host.
+
+#ifndef SI7210_BYTES_H
+#define SI7210_BYTES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-8, polynomial x^8 + x^2 + x + 1
+// @param *data The bytes to check.
+// @param len   Number of bytes.
+// @return      The CRC.
+static inline uint8_t si7210_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+// Store v little endian at p.
+static inline void si7210_put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void si7210_put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// @return  The little endian value at p.
+static inline uint16_t si7210_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t si7210_get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif //SI7210_BYTES_H
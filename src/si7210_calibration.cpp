@@ -0,0 +1,267 @@
+// File: si7210_calibration.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Per-sensor offset/gain (and optional piecewise linear)
+// calibration, applied in si7210::getFieldStrength().
+
+#include "si7210_calibration.h"
+#include "si7210.h"
+#include "si7210_bytes.h"
+
+void si7210_cal_identity(si7210_cal_t *cal)
+{
+    cal->offsetUt = 0;
+    cal->gainQ16 = 65536;
+    cal->numPoints = 0;
+    for (int i = 0; i < SI7210_CAL_MAX_POINTS; i++)
+    {
+        cal->pointIn[i] = 0;
+        cal->pointOut[i] = 0;
+    }
+}
+
+int32_t si7210_cal_correct(const si7210_cal_t *cal, int32_t ut)
+{
+    size_t n = cal->numPoints;
+
+    if (n < 2)
+    {
+        return ut;
+    }
+
+    // Outside the points, shift by the nearest end point's correction
+    if (ut <= cal->pointIn[0])
+    {
+        return ut + (cal->pointOut[0] - cal->pointIn[0]);
+    }
+    if (ut >= cal->pointIn[n - 1])
+    {
+        return ut + (cal->pointOut[n - 1] - cal->pointIn[n - 1]);
+    }
+
+    // At most 8 points, so a linear search is as quick as a binary one
+    size_t hi = 1;
+    while (ut > cal->pointIn[hi])
+    {
+        hi++;
+    }
+    size_t lo = hi - 1;
+
+    int32_t in0 = cal->pointIn[lo];
+    int32_t out0 = cal->pointOut[lo];
+
+    return out0 + (int32_t)(((int64_t)(ut - in0) * (cal->pointOut[hi] - out0)) / (cal->pointIn[hi] - in0));
+}
+
+void si7210_cal_apply_block(const si7210_cal_t *cal, const int32_t *in, int32_t *out, size_t n)
+{
+    // Locals so the compiler knows the stores to out can't change them
+    int32_t offset = cal->offsetUt;
+    int64_t gain = cal->gainQ16;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = (int32_t)(((int64_t)(in[i] - offset) * gain) >> 16);
+    }
+
+    if (cal->numPoints >= 2)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = si7210_cal_correct(cal, out[i]);
+        }
+    }
+}
+
+// Serialised format, little endian:
+//   version (1), numPoints (1), offsetUt (4), gainQ16 (4),
+//   numPoints * (pointIn (4), pointOut (4)), CRC-8 of the above (1)
+size_t si7210_cal_serialise(const si7210_cal_t *cal, uint8_t *buf, size_t len)
+{
+    size_t n = cal->numPoints <= SI7210_CAL_MAX_POINTS ? cal->numPoints : SI7210_CAL_MAX_POINTS;
+    size_t size = 1 + 1 + 4 + 4 + n * 8 + 1;
+
+    if (len < size)
+    {
+        return 0;
+    }
+
+    uint8_t *p = buf;
+    *p++ = SI7210_CAL_VERSION;
+    *p++ = (uint8_t)n;
+    si7210_put32(p, (uint32_t)cal->offsetUt);
+    p += 4;
+    si7210_put32(p, (uint32_t)cal->gainQ16);
+    p += 4;
+    for (size_t i = 0; i < n; i++)
+    {
+        si7210_put32(p, (uint32_t)cal->pointIn[i]);
+        p += 4;
+        si7210_put32(p, (uint32_t)cal->pointOut[i]);
+        p += 4;
+    }
+    *p = si7210_crc8(buf, size - 1);
+
+    return size;
+}
+
+bool si7210_cal_deserialise(si7210_cal_t *cal, const uint8_t *buf, size_t len)
+{
+    if (len < 2 || buf[0] != SI7210_CAL_VERSION || buf[1] > SI7210_CAL_MAX_POINTS)
+    {
+        return false;
+    }
+
+    size_t n = buf[1];
+    size_t size = 1 + 1 + 4 + 4 + n * 8 + 1;
+    if (len < size || si7210_crc8(buf, size - 1) != buf[size - 1])
+    {
+        return false;
+    }
+
+    si7210_cal_t read;
+    si7210_cal_identity(&read);
+
+    const uint8_t *p = buf + 2;
+    read.numPoints = (uint8_t)n;
+    read.offsetUt = (int32_t)si7210_get32(p);
+    p += 4;
+    read.gainQ16 = (int32_t)si7210_get32(p);
+    p += 4;
+    for (size_t i = 0; i < n; i++)
+    {
+        read.pointIn[i] = (int32_t)si7210_get32(p);
+        p += 4;
+        read.pointOut[i] = (int32_t)si7210_get32(p);
+        p += 4;
+
+        // Same rule as si7210_calibrator::compute(): si7210_cal_correct()
+        // divides by the gap between neighbouring points.
+        if (i > 0 && read.pointIn[i] <= read.pointIn[i - 1])
+        {
+            return false;
+        }
+    }
+
+    *cal = read;
+    return true;
+}
+
+si7210_calibrator::si7210_calibrator(si7210 *sensor)
+{
+    hall = sensor;
+    haveZero = false;
+    haveReference = false;
+    zeroUt = 0;
+    referenceMeasuredUt = 0;
+    referenceTrueUt = 0;
+    numPoints = 0;
+}
+
+int32_t si7210_calibrator::average(int samples)
+{
+    // Measure without whatever calibration the sensor already has
+    const si7210_cal_t *previous = hall->getCalibration();
+    hall->setCalibration(NULL);
+
+    int64_t sum = 0;
+    for (int i = 0; i < samples; i++)
+    {
+        sum += hall->getFieldStrength();
+    }
+
+    hall->setCalibration(previous);
+
+    // Round to nearest
+    int64_t half = sum < 0 ? -samples / 2 : samples / 2;
+    return (int32_t)((sum + half) / samples);
+}
+
+bool si7210_calibrator::captureZero(int samples)
+{
+    if (samples <= 0)
+    {
+        return false;
+    }
+
+    zeroUt = average(samples);
+    haveZero = true;
+
+    return true;
+}
+
+bool si7210_calibrator::captureReference(int32_t referenceUt, int samples)
+{
+    if (samples <= 0)
+    {
+        return false;
+    }
+
+    referenceMeasuredUt = average(samples);
+    referenceTrueUt = referenceUt;
+    haveReference = true;
+
+    return true;
+}
+
+bool si7210_calibrator::capturePoint(int32_t trueUt, int samples)
+{
+    if (samples <= 0 || numPoints >= SI7210_CAL_MAX_POINTS)
+    {
+        return false;
+    }
+
+    pointMeasured[numPoints] = average(samples);
+    pointTrue[numPoints] = trueUt;
+    numPoints++;
+
+    return true;
+}
+
+bool si7210_calibrator::compute(si7210_cal_t *cal)
+{
+    if (!haveZero || !haveReference || referenceMeasuredUt == zeroUt)
+    {
+        return false;
+    }
+
+    si7210_cal_identity(cal);
+    cal->offsetUt = zeroUt;
+    cal->gainQ16 = (int32_t)(((int64_t)referenceTrueUt * 65536) / (referenceMeasuredUt - zeroUt));
+
+    // Correction points are the offset/gain corrected readings against the
+    // true fields, sorted by reading. Points with the same reading as an
+    // earlier one are dropped.
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < numPoints; i++)
+    {
+        cal->numPoints = 0;
+        int32_t in = si7210_cal_apply(cal, pointMeasured[i]);
+
+        uint8_t j = n;
+        bool duplicate = false;
+        while (j > 0 && cal->pointIn[j - 1] >= in)
+        {
+            duplicate = duplicate || cal->pointIn[j - 1] == in;
+            j--;
+        }
+        if (duplicate)
+        {
+            continue;
+        }
+
+        for (uint8_t k = n; k > j; k--)
+        {
+            cal->pointIn[k] = cal->pointIn[k - 1];
+            cal->pointOut[k] = cal->pointOut[k - 1];
+        }
+        cal->pointIn[j] = in;
+        cal->pointOut[j] = pointTrue[i];
+        n++;
+    }
+    cal->numPoints = n;
+
+    return true;
+}
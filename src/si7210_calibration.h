@@ -0,0 +1,131 @@
+// File: si7210_calibration.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Per-sensor offset/gain (and optional piecewise linear)
+// calibration, applied in si7210::getFieldStrength().
+
+#ifndef SI7210_CALIBRATION_H
+#define SI7210_CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class si7210;
+
+// Maximum number of piecewise linear correction points.
+#define SI7210_CAL_MAX_POINTS 8
+#define SI7210_CAL_VERSION 1
+
+// Size of a serialised si7210_cal_t with the maximum number of points.
+#define SI7210_CAL_MAX_SERIALISED (1 + 1 + 4 + 4 + SI7210_CAL_MAX_POINTS * 8 + 1)
+
+// One sensor's calibration.
+//
+// corrected = ((raw - offsetUt) * gainQ16) / 65536
+// then, if numPoints >= 2, mapped through the piecewise linear correction:
+// pointIn[i] -> pointOut[i], interpolated between points and shifted by the
+// end point's correction outside them.
+typedef struct
+{
+    int32_t offsetUt;
+
+    // 65536 = 1.0
+    int32_t gainQ16;
+
+    uint8_t numPoints;
+    int32_t pointIn[SI7210_CAL_MAX_POINTS];
+    int32_t pointOut[SI7210_CAL_MAX_POINTS];
+} si7210_cal_t;
+
+// Sets a calibration that changes nothing.
+void si7210_cal_identity(si7210_cal_t *cal);
+
+// Applies the piecewise linear correction only.
+int32_t si7210_cal_correct(const si7210_cal_t *cal, int32_t ut);
+
+// Applies a calibration to one reading.
+static inline int32_t si7210_cal_apply(const si7210_cal_t *cal, int32_t rawUt)
+{
+    int32_t ut = (int32_t)(((int64_t)(rawUt - cal->offsetUt) * cal->gainQ16) >> 16);
+
+    return cal->numPoints >= 2 ? si7210_cal_correct(cal, ut) : ut;
+}
+
+// Applies a calibration to a block of readings (e.g. replaying a capture).
+// The offset/gain pass is branch free so the compiler can vectorise it.
+// in and out may be the same buffer.
+void si7210_cal_apply_block(const si7210_cal_t *cal, const int32_t *in, int32_t *out, size_t n);
+
+// Serialises a calibration into a compact, CRC protected, little endian
+// byte format for storing in flash/EEPROM.
+//
+// @param *cal  The calibration.
+// @param *buf  Where to store the bytes.
+// @param len   Size of buf. SI7210_CAL_MAX_SERIALISED is always enough.
+// @return      Number of bytes written. 0 if buf is too small.
+size_t si7210_cal_serialise(const si7210_cal_t *cal, uint8_t *buf, size_t len);
+
+// Reads back a serialised calibration.
+//
+// @return  True on success. False if the bytes are truncated or corrupt, or
+//          the points aren't in strictly increasing order. cal is unchanged
+//          on failure.
+bool si7210_cal_deserialise(si7210_cal_t *cal, const uint8_t *buf, size_t len);
+
+// Works out a sensor's calibration from samples taken in known fields.
+//
+// Example:
+//      si7210_calibrator calibrator(&hall);
+//      calibrator.captureZero(64);                 // no magnet
+//      calibrator.captureReference(10000, 64);     // 10mT reference magnet
+//      calibrator.compute(&cal);
+//      hall.setCalibration(&cal);
+class si7210_calibrator
+{
+public:
+    si7210_calibrator(si7210 *sensor);
+
+    // Averages samples with no field applied.
+    //
+    // @param samples   Number of samples to average.
+    // @return          True on success. False if samples is 0.
+    bool captureZero(int samples);
+
+    // Averages samples in a known reference field.
+    //
+    // @param referenceUt   The applied field.
+    // @param samples       Number of samples to average.
+    // @return              True on success. False if samples is 0.
+    bool captureReference(int32_t referenceUt, int samples);
+
+    // Averages samples in a known field and adds them as a piecewise linear
+    // correction point. Call after captureZero() and captureReference().
+    //
+    // @param trueUt    The applied field.
+    // @param samples   Number of samples to average.
+    // @return          True on success. False if full or samples is 0.
+    bool capturePoint(int32_t trueUt, int samples);
+
+    // @param *cal  Where to store the calibration.
+    // @return      True on success. False if the zero and reference
+    //              captures are missing or identical.
+    bool compute(si7210_cal_t *cal);
+
+private:
+    si7210 *hall;
+    bool haveZero;
+    bool haveReference;
+    int32_t zeroUt;
+    int32_t referenceMeasuredUt;
+    int32_t referenceTrueUt;
+    uint8_t numPoints;
+    int32_t pointMeasured[SI7210_CAL_MAX_POINTS];
+    int32_t pointTrue[SI7210_CAL_MAX_POINTS];
+
+    // Average of samples uncalibrated readings
+    int32_t average(int samples);
+};
+
+#endif //SI7210_CALIBRATION_H
@@ -0,0 +1,337 @@
+// File: si7210_codec.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Lossless compression of sample streams: delta encoding with
+// zig-zag varints or bit packing, in self contained blocks.
+
+#include "si7210_codec.h"
+#include <string.h>
+
+// Space left for the count and length fields in front of the payload while
+// encoding. The payload is moved down once their size is known.
+#define HEADER_RESERVE 10
+
+// Width field values that aren't bit widths
+#define WIDTH_VARINT 0
+#define WIDTH_CONSTANT 33
+
+static inline uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// @return  The byte after the varint. NULL if it doesn't fit before end.
+static inline uint8_t *putVarint(uint8_t *p, const uint8_t *end, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        if (p >= end)
+        {
+            return NULL;
+        }
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+
+    if (p >= end)
+    {
+        return NULL;
+    }
+    *p++ = (uint8_t)v;
+
+    return p;
+}
+
+// @return  The byte after the varint. NULL if it runs past end or is longer
+//          than 5 bytes.
+static inline const uint8_t *getVarint(const uint8_t *p, const uint8_t *end, uint32_t *v)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (p >= end)
+        {
+            return NULL;
+        }
+
+        uint8_t byte = *p++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *v = result;
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+// @return  The number of bytes v takes as a varint.
+static inline size_t varintSize(uint32_t v)
+{
+    return v < (1U << 7) ? 1 : v < (1U << 14) ? 2 : v < (1U << 21) ? 3 : v < (1U << 28) ? 4 : 5;
+}
+
+// @return  The number of bits needed to hold v.
+static inline int bitWidth(uint32_t v)
+{
+    int width = 0;
+    while (v != 0)
+    {
+        width++;
+        v >>= 1;
+    }
+    return width;
+}
+
+static inline uint32_t delta(const int32_t *values, size_t i)
+{
+    // Differences wrap around, so any pair of int32s round trips
+    return zigzag((int32_t)((uint32_t)values[i] - (uint32_t)values[i - 1]));
+}
+
+size_t si7210_encode_block(const int32_t *values, size_t n, uint8_t *out, size_t outLen)
+{
+    if (n == 0 || outLen <= HEADER_RESERVE)
+    {
+        return 0;
+    }
+
+    // Size the deltas both ways and use the smaller
+    size_t varintBytes = 0;
+    uint32_t all = 0;
+    for (size_t i = 1; i < n; i++)
+    {
+        uint32_t d = delta(values, i);
+        varintBytes += varintSize(d);
+        all |= d;
+    }
+    int width = bitWidth(all);
+    size_t packedBytes = ((n - 1) * (size_t)width + 7) / 8;
+    bool packed = width > 0 && packedBytes < varintBytes;
+
+    // Every delta 0 (e.g. a magnet that isn't moving): no deltas stored
+    bool constant = n > 1 && width == 0;
+    uint32_t widthCode = constant ? WIDTH_CONSTANT : packed ? (uint32_t)width : WIDTH_VARINT;
+    size_t deltaBytes = constant ? 0 : packed ? packedBytes : varintBytes;
+
+    const uint8_t *end = out + outLen;
+    uint8_t *payload = out + HEADER_RESERVE;
+    uint8_t *p = putVarint(payload, end, zigzag(values[0]));
+    p = p != NULL ? putVarint(p, end, widthCode) : NULL;
+    if (p == NULL || (size_t)(end - p) < deltaBytes)
+    {
+        return 0;
+    }
+
+    if (packed)
+    {
+        // Little endian bit stream, width bits per delta
+        uint64_t bits = 0;
+        int held = 0;
+        for (size_t i = 1; i < n; i++)
+        {
+            bits |= (uint64_t)delta(values, i) << held;
+            held += width;
+            while (held >= 8)
+            {
+                *p++ = (uint8_t)bits;
+                bits >>= 8;
+                held -= 8;
+            }
+        }
+        if (held > 0)
+        {
+            *p++ = (uint8_t)bits;
+        }
+    }
+    else if (!constant)
+    {
+        for (size_t i = 1; i < n; i++)
+        {
+            p = putVarint(p, end, delta(values, i));
+        }
+    }
+
+    size_t length = (size_t)(p - payload);
+    uint8_t header[HEADER_RESERVE];
+    uint8_t *h = putVarint(header, header + sizeof(header), (uint32_t)n);
+    h = putVarint(h, header + sizeof(header), (uint32_t)length);
+    size_t headerLen = (size_t)(h - header);
+
+    memcpy(out, header, headerLen);
+    memmove(out + headerLen, payload, length);
+
+    return headerLen + length;
+}
+
+// Reads the count and length fields.
+//
+// @return  The start of the payload. NULL if truncated or corrupt.
+static const uint8_t *getHeader(const uint8_t *in, size_t inLen, uint32_t *count, uint32_t *length)
+{
+    const uint8_t *end = in + inLen;
+    const uint8_t *p = getVarint(in, end, count);
+    if (p == NULL)
+    {
+        return NULL;
+    }
+
+    p = getVarint(p, end, length);
+    if (p == NULL || *count == 0 || *length > (size_t)(end - p))
+    {
+        return NULL;
+    }
+
+    return p;
+}
+
+size_t si7210_decode_block(const uint8_t *in, size_t inLen, int32_t *values, size_t maxValues, size_t *consumed)
+{
+    uint32_t count;
+    uint32_t length;
+    const uint8_t *p = getHeader(in, inLen, &count, &length);
+    if (p == NULL || count > maxValues)
+    {
+        return 0;
+    }
+
+    const uint8_t *end = p + length;
+    uint32_t v;
+    uint32_t width;
+    p = getVarint(p, end, &v);
+    if (p == NULL || (p = getVarint(p, end, &width)) == NULL || width > WIDTH_CONSTANT)
+    {
+        return 0;
+    }
+    int32_t value = unzigzag(v);
+    values[0] = value;
+
+    if (width == WIDTH_CONSTANT)
+    {
+        for (uint32_t i = 1; i < count; i++)
+        {
+            values[i] = value;
+        }
+    }
+    else if (width != WIDTH_VARINT)
+    {
+        if ((size_t)(end - p) != ((count - 1) * (size_t)width + 7) / 8)
+        {
+            return 0;
+        }
+
+        uint64_t bits = 0;
+        uint32_t held = 0;
+        uint32_t mask = width == 32 ? 0xFFFFFFFFU : (1U << width) - 1;
+        for (uint32_t i = 1; i < count; i++)
+        {
+            while (held < width)
+            {
+                bits |= (uint64_t)*p++ << held;
+                held += 8;
+            }
+            value = (int32_t)((uint32_t)value + (uint32_t)unzigzag((uint32_t)bits & mask));
+            values[i] = value;
+            bits >>= width;
+            held -= width;
+        }
+
+        // Only padding may be left over
+        p = end;
+    }
+    else
+    {
+        for (uint32_t i = 1; i < count; i++)
+        {
+            // Most deltas are a single byte
+            if (p < end && *p < 0x80)
+            {
+                v = *p++;
+            }
+            else if ((p = getVarint(p, end, &v)) == NULL)
+            {
+                return 0;
+            }
+
+            value = (int32_t)((uint32_t)value + (uint32_t)unzigzag(v));
+            values[i] = value;
+        }
+    }
+
+    // The length must match the values exactly
+    if (p != end)
+    {
+        return 0;
+    }
+
+    if (consumed != NULL)
+    {
+        *consumed = (size_t)(end - in);
+    }
+
+    return count;
+}
+
+size_t si7210_skip_block(const uint8_t *in, size_t inLen, uint32_t *count)
+{
+    uint32_t n;
+    uint32_t length;
+    const uint8_t *p = getHeader(in, inLen, &n, &length);
+    if (p == NULL)
+    {
+        return 0;
+    }
+
+    if (count != NULL)
+    {
+        *count = n;
+    }
+
+    return (size_t)(p - in) + length;
+}
+
+si7210_encoder::si7210_encoder(callback_t cb, void *context, size_t keyframeInterval)
+{
+    onBlock = cb;
+    callbackContext = context;
+    if (keyframeInterval < 1)
+    {
+        keyframeInterval = 1;
+    }
+    interval = keyframeInterval < MAX_INTERVAL ? keyframeInterval : MAX_INTERVAL;
+    count = 0;
+}
+
+void si7210_encoder::add(int32_t value)
+{
+    values[count++] = value;
+    if (count >= interval)
+    {
+        flush();
+    }
+}
+
+void si7210_encoder::flush()
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    size_t len = si7210_encode_block(values, count, out, sizeof(out));
+    count = 0;
+
+    if (onBlock != NULL)
+    {
+        onBlock(callbackContext, out, len);
+    }
+}
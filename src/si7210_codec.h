@@ -0,0 +1,116 @@
+// File: si7210_codec.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Lossless compression of sample streams (raw codes or uT) for
+// logging and transmission: delta encoding with zig-zag varints or bit
+// packing, in self contained blocks that double as keyframes for seeking.
+// No heap; builds for the MCU and the host.
+
+#ifndef SI7210_CODEC_H
+#define SI7210_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Worst case encoded size of a block of n values: a 4 part header of up to
+// 5 bytes each and up to 5 bytes per value.
+#define SI7210_CODEC_MAX_BYTES(n) (20 + 5 * (size_t)(n))
+
+// Encoded block format:
+//
+//   count      varint      Number of values.
+//   length     varint      Number of bytes after this field.
+//   keyframe   zz varint   The first value.
+//   width      varint      0 for varint deltas, 33 if every value equals
+//                          the keyframe (no deltas follow), else the bits
+//                          per delta.
+//   deltas                 value[i] - value[i - 1] for each following
+//                          value, zig-zag encoded, either as varints or
+//                          packed width bits each (little endian bit
+//                          order, last byte zero padded).
+//
+// varints are little endian base 128 (7 bits per byte, top bit set on all
+// but the last byte). Zig-zag maps small negative and positive numbers to
+// small unsigned ones (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...). The encoder
+// picks whichever delta encoding is smaller for each block: noise only
+// blocks pack to a few bits a sample, moving ones fall back to varints.
+// Each block starts from an absolute value, so blocks can be decoded (or
+// skipped) on their own.
+
+// Encodes a block of values.
+//
+// @param *values   The values.
+// @param n         The number of values. At least 1.
+// @param *out      Where to store the block.
+// @param outLen    Size of out. SI7210_CODEC_MAX_BYTES(n) is always
+//                  enough.
+// @return          The encoded size in bytes. 0 if n is 0 or out is too
+//                  small.
+size_t si7210_encode_block(const int32_t *values, size_t n, uint8_t *out, size_t outLen);
+
+// Decodes one block.
+//
+// @param *in           The start of the block.
+// @param inLen         The number of bytes available.
+// @param *values       Where to store the values.
+// @param maxValues     Size of values.
+// @param *consumed     If not NULL, set to the block's size in bytes.
+// @return              The number of values decoded. 0 if the block is
+//                      truncated, corrupt or has more than maxValues.
+size_t si7210_decode_block(const uint8_t *in, size_t inLen, int32_t *values, size_t maxValues, size_t *consumed);
+
+// Reads a block's header without decoding it, for seeking through a
+// stream of blocks.
+//
+// @param *in       The start of the block.
+// @param inLen     The number of bytes available.
+// @param *count    If not NULL, set to the number of values in the block.
+// @return          The block's size in bytes. 0 if the block is truncated
+//                  or corrupt.
+size_t si7210_skip_block(const uint8_t *in, size_t inLen, uint32_t *count);
+
+// Encodes a stream of values one at a time, into a block every
+// keyframeInterval values.
+//
+// Example:
+//      void onBlock(void *context, const uint8_t *block, size_t len) { ... }
+//
+//      si7210_encoder encoder(onBlock, NULL);
+//      encoder.add(fieldUt);   // for each sample
+//      encoder.flush();        // when done
+class si7210_encoder
+{
+public:
+    // Maximum values per block.
+    static const size_t MAX_INTERVAL = 256;
+
+    // Called with each encoded block.
+    typedef void (*callback_t)(void *context, const uint8_t *block, size_t len);
+
+    // @param cb                Called with each block.
+    // @param *context          Passed to cb.
+    // @param keyframeInterval  Values per block, 1 to MAX_INTERVAL. Longer
+    //                          compresses slightly better, shorter seeks
+    //                          more finely.
+    si7210_encoder(callback_t cb, void *context, size_t keyframeInterval = 64);
+
+    // Adds one value, emitting a block when keyframeInterval have been
+    // added.
+    void add(int32_t value);
+
+    // Emits the values added since the last block, if any.
+    void flush();
+
+private:
+    callback_t onBlock;
+    void *callbackContext;
+    size_t interval;
+
+    int32_t values[MAX_INTERVAL];
+    size_t count;
+    uint8_t out[SI7210_CODEC_MAX_BYTES(MAX_INTERVAL)];
+};
+
+#endif //SI7210_CODEC_H
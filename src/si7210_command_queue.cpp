@@ -0,0 +1,228 @@
+// File: si7210_command_queue.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Transaction coalescing for configuration sequences.
+
+#include "si7210_command_queue.h"
+#include <string.h>
+
+si7210_command_queue::si7210_command_queue(si7210 *sensor) : hall(sensor), lock(sensor->bus)
+{
+    configPending = 0;
+    numOrdered = 0;
+    failed = false;
+    memset(&counts, 0, sizeof(counts));
+
+    attached = hall->queue == NULL;
+    if (attached)
+    {
+        hall->queue = this;
+    }
+}
+
+si7210_command_queue::~si7210_command_queue()
+{
+    if (attached)
+    {
+        flush();
+        hall->queue = NULL;
+    }
+}
+
+bool si7210_command_queue::read(uint8_t reg, uint8_t *data)
+{
+    if (!attached)
+    {
+        return hall->readRegister(reg, data);
+    }
+
+    counts.reads++;
+
+    if (isConfig(reg))
+    {
+        uint32_t bit = 1UL << (reg - REG_0XC0);
+        if (configPending & bit)
+        {
+            *data = config[reg - REG_0XC0];
+            counts.cachedReads++;
+            return true;
+        }
+        if (isCached(reg))
+        {
+            *data = hall->shadow[reg - REG_0XC0];
+            counts.cachedReads++;
+            return true;
+        }
+    }
+    else if (reg >= REG_OTP_ADDR && reg <= REG_OTP_CTRL)
+    {
+        // otp_data only depends on the OTP writes
+        flushOrdered();
+    }
+    else
+    {
+        flush();
+    }
+
+    counts.transactions++;
+    return hall->readRegisters(reg, data, 1);
+}
+
+bool si7210_command_queue::write(uint8_t reg, uint8_t data)
+{
+    if (!attached)
+    {
+        return hall->writeRegister(reg, data);
+    }
+
+    counts.writes++;
+
+    if (isConfig(reg))
+    {
+        uint32_t bit = 1UL << (reg - REG_0XC0);
+        if (configPending & bit)
+        {
+            // Replaces the queued write
+            counts.dropped++;
+        }
+
+        if (isCached(reg) && hall->shadow[reg - REG_0XC0] == data)
+        {
+            // Already holds the value
+            counts.dropped++;
+            configPending &= ~bit;
+        }
+        else
+        {
+            config[reg - REG_0XC0] = data;
+            configPending |= bit;
+        }
+        return true;
+    }
+
+    if (numOrdered == SI7210_QUEUE_MAX_ORDERED)
+    {
+        flushOrdered();
+    }
+    orderedRegs[numOrdered] = reg;
+    orderedData[numOrdered] = data;
+    numOrdered++;
+
+    return true;
+}
+
+bool si7210_command_queue::prefetch(uint8_t reg, size_t len)
+{
+    if (!attached)
+    {
+        return hall->queue->prefetch(reg, len);
+    }
+
+    // The queued values stay authoritative over what's read
+    uint8_t data[CONFIG_IMAGE_SIZE + 4];
+    if (len > sizeof(data))
+    {
+        return false;
+    }
+
+    counts.transactions++;
+    return hall->readRegisters(reg, data, len);
+}
+
+bool si7210_command_queue::flush()
+{
+    if (!attached)
+    {
+        return true;
+    }
+
+    flushOrdered();
+    flushConfig();
+
+    bool ok = !failed;
+    failed = false;
+    return ok;
+}
+
+void si7210_command_queue::flushOrdered()
+{
+    size_t i = 0;
+    while (i < numOrdered)
+    {
+        // Each run of consecutive registers is one burst
+        uint8_t data[SI7210_QUEUE_MAX_ORDERED];
+        size_t start = i;
+        do
+        {
+            data[i - start] = orderedData[i];
+            i++;
+        } while (i < numOrdered && orderedRegs[i] == orderedRegs[i - 1] + 1);
+
+        counts.transactions++;
+        if (!hall->writeRegisters(orderedRegs[start], data, i - start))
+        {
+            failed = true;
+        }
+    }
+
+    numOrdered = 0;
+}
+
+void si7210_command_queue::flushConfig()
+{
+    uint8_t reg = REG_0XC6;
+    while (reg <= REG_A5)
+    {
+        if (!(configPending & (1UL << (reg - REG_0XC0))))
+        {
+            reg++;
+            continue;
+        }
+
+        // Extend the burst over queued registers, and over cached ones if
+        // another queued register follows (rewriting a cached value costs a
+        // byte, a new burst a whole transaction)
+        uint8_t data[REG_A5 - REG_0XC6 + 1];
+        uint8_t start = reg;
+        uint8_t end = reg;
+        for (uint8_t next = reg; next <= REG_A5; next++)
+        {
+            uint32_t bit = 1UL << (next - REG_0XC0);
+            if (configPending & bit)
+            {
+                data[next - start] = config[next - REG_0XC0];
+                end = next;
+            }
+            else if (isCached(next))
+            {
+                data[next - start] = hall->shadow[next - REG_0XC0];
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        counts.transactions++;
+        if (!hall->writeRegisters(start, data, end - start + 1))
+        {
+            failed = true;
+        }
+        reg = end + 1;
+    }
+
+    // 0xC4 last
+    if (configPending & (1UL << (REG_0XC4 - REG_0XC0)))
+    {
+        uint8_t data = config[REG_0XC4 - REG_0XC0];
+        counts.transactions++;
+        if (!hall->writeRegisters(REG_0XC4, &data, 1))
+        {
+            failed = true;
+        }
+    }
+
+    configPending = 0;
+}
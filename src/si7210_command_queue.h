@@ -0,0 +1,134 @@
+// File: si7210_command_queue.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Transaction coalescing for configuration sequences. Register
+// reads and writes are recorded instead of each going straight to the bus,
+// redundant writes are dropped and adjacent writes are merged into burst
+// writes when the queue is flushed.
+
+#ifndef SI7210_COMMAND_QUEUE_H
+#define SI7210_COMMAND_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "si7210.h"
+
+// Writes to registers outside the configuration block queued before they
+// are flushed.
+#define SI7210_QUEUE_MAX_ORDERED 16
+
+typedef struct
+{
+    // Register accesses recorded.
+    uint32_t reads;
+    uint32_t writes;
+
+    // Reads answered from the queue or the driver's cache, without the bus.
+    uint32_t cachedReads;
+
+    // Writes that never reached the bus: the register already held the
+    // value, or a later write replaced it before the flush.
+    uint32_t dropped;
+
+    // Bus transactions issued.
+    uint32_t transactions;
+} si7210_command_queue_stats_t;
+
+// While a queue exists, the sensor's readRegister() and writeRegister()
+// calls go through it (so existing configuration code is batched
+// unchanged), and it holds the sensor's bus at CONFIG priority.
+//
+// Configuration block writes (0xC4, 0xC6-0xD0) are held until flush(). A
+// register written twice is written once, a write of the value the register
+// already holds (per the driver's cache) is dropped, and the rest are
+// written in ascending order as bursts of consecutive registers, with gaps
+// of registers whose value is cached filled in, then 0xC4 last since it
+// starts/stops measuring. Reads of these registers come from the queue or
+// the cache when possible.
+//
+// Writes to other registers (e.g. the OTP interface) may have side effects,
+// so they are written in order, consecutive ones merged, before the next
+// read that could depend on them: an OTP read waits only for the OTP
+// writes, any other read (e.g. dspsigm) for everything.
+//
+// Queues nest: one created while the sensor already has one passes
+// everything to the outer one, which flushes.
+//
+// Example:
+//      {
+//          si7210_command_queue queue(&hall);
+//          hall.setRange(si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM);
+//          hall.setFilter(filter);
+//      } // Written here
+class si7210_command_queue
+{
+public:
+    // Starts recording sensor's register accesses.
+    si7210_command_queue(si7210 *sensor);
+
+    // Flushes and stops recording.
+    ~si7210_command_queue();
+
+    // Reads a register, from the queue or the cache if possible.
+    //
+    // @return  True on success. False on failure.
+    bool read(uint8_t reg, uint8_t *data);
+
+    // Queues a register write.
+    //
+    // @return  True if queued. Bus errors are reported by flush().
+    bool write(uint8_t reg, uint8_t data);
+
+    // Reads consecutive registers into the cache in one transaction, so
+    // later reads and redundant write checks don't need the bus.
+    //
+    // @return  True on success. False on failure.
+    bool prefetch(uint8_t reg, size_t len);
+
+    // Writes everything queued.
+    //
+    // @return  True on success. False if a write failed.
+    bool flush();
+
+    void getStats(si7210_command_queue_stats_t *stats) { *stats = counts; }
+
+private:
+    si7210 *hall;
+    si7210_bus_lock lock;
+
+    // False when nested in another queue
+    bool attached;
+
+    // Queued configuration block values, indexed like the driver's shadow.
+    // Bit n of configPending is set if register 0xC0+n is queued.
+    uint8_t config[REG_A5 - REG_0XC0 + 1];
+    uint32_t configPending;
+
+    // Queued writes to other registers, in order
+    uint8_t orderedRegs[SI7210_QUEUE_MAX_ORDERED];
+    uint8_t orderedData[SI7210_QUEUE_MAX_ORDERED];
+    size_t numOrdered;
+
+    // A flushed write failed
+    bool failed;
+
+    si7210_command_queue_stats_t counts;
+
+    // @return  True if reg is a configuration block register.
+    static bool isConfig(uint8_t reg) { return reg == REG_0XC4 || (reg >= REG_0XC6 && reg <= REG_A5); }
+
+    // @return  True if the driver's cache holds reg's value.
+    bool isCached(uint8_t reg) { return (hall->shadowValid & (1UL << (reg - REG_0XC0))) != 0; }
+
+    // Writes the queued configuration block/other writes.
+    void flushConfig();
+    void flushOrdered();
+
+    // Copying would flush twice.
+    si7210_command_queue(const si7210_command_queue &);
+    si7210_command_queue &operator=(const si7210_command_queue &);
+};
+
+#endif //SI7210_COMMAND_QUEUE_H
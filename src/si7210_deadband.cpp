@@ -0,0 +1,109 @@
+// File: si7210_deadband.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Change detection (deadband) reporting: only passes samples on
+// when the field moves, plus a heartbeat and optional min/max summaries of
+// what was held back.
+
+#include "si7210_deadband.h"
+#include <string.h>
+
+si7210_deadband::si7210_deadband(int32_t deadbandUt, uint32_t heartbeatUs, bool summaries, callback_t cb, void *context)
+{
+    deadband = deadbandUt;
+    heartbeat = heartbeatUs;
+    summarise = summaries;
+    onReport = cb;
+    callbackContext = context;
+    reset();
+}
+
+void si7210_deadband::reset()
+{
+    haveReported = false;
+    reportedUt = 0;
+    reportedUs = 0;
+    memset(&pending, 0, sizeof(pending));
+    pending.kind = si7210_report_kind_t::SUMMARY;
+    memset(&counts, 0, sizeof(counts));
+}
+
+bool si7210_deadband::add(uint32_t timestampUs, int32_t fieldUt)
+{
+    counts.samples++;
+
+    if (!haveReported)
+    {
+        report(si7210_report_kind_t::SAMPLE, timestampUs, fieldUt);
+        return true;
+    }
+
+    int32_t change = fieldUt - reportedUt;
+    if (change > deadband || change < -deadband)
+    {
+        report(si7210_report_kind_t::SAMPLE, timestampUs, fieldUt);
+        return true;
+    }
+
+    if (heartbeat != 0 && timestampUs - reportedUs >= heartbeat)
+    {
+        counts.heartbeats++;
+        report(si7210_report_kind_t::HEARTBEAT, timestampUs, fieldUt);
+        return true;
+    }
+
+    if (pending.suppressed == 0)
+    {
+        pending.startUs = timestampUs;
+        pending.minUt = fieldUt;
+        pending.maxUt = fieldUt;
+    }
+    else if (fieldUt < pending.minUt)
+    {
+        pending.minUt = fieldUt;
+    }
+    else if (fieldUt > pending.maxUt)
+    {
+        pending.maxUt = fieldUt;
+    }
+    pending.timestampUs = timestampUs;
+    pending.suppressed++;
+
+    return false;
+}
+
+void si7210_deadband::onSample(void *context, const si7210_sample_t *sample)
+{
+    ((si7210_deadband *)context)->add(sample->timestampUs, sample->fieldUt);
+}
+
+void si7210_deadband::report(si7210_report_kind_t kind, uint32_t timestampUs, int32_t fieldUt)
+{
+    if (summarise && pending.suppressed > 0)
+    {
+        counts.summaries++;
+        if (onReport != NULL)
+        {
+            onReport(callbackContext, &pending);
+        }
+    }
+    pending.suppressed = 0;
+
+    si7210_report_t r;
+    memset(&r, 0, sizeof(r));
+    r.kind = kind;
+    r.timestampUs = timestampUs;
+    r.fieldUt = fieldUt;
+
+    counts.reported++;
+    if (onReport != NULL)
+    {
+        onReport(callbackContext, &r);
+    }
+
+    haveReported = true;
+    reportedUt = fieldUt;
+    reportedUs = timestampUs;
+}
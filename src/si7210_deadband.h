@@ -0,0 +1,115 @@
+// File: si7210_deadband.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Change detection (deadband) reporting: only passes samples on
+// when the field moves, plus a heartbeat and optional min/max summaries of
+// what was held back.
+
+#ifndef SI7210_DEADBAND_H
+#define SI7210_DEADBAND_H
+
+#include <stdint.h>
+#include "si7210_sampler.h"
+
+typedef enum class si7210_report_kind_t
+{
+    SAMPLE,    // The field moved outside the deadband
+    HEARTBEAT, // Nothing reported for a heartbeat interval
+    SUMMARY    // Min/max of the samples suppressed since the last report
+} si7210_report_kind_t;
+
+typedef struct
+{
+    si7210_report_kind_t kind;
+
+    // SAMPLE/HEARTBEAT: the sample's timestamp. SUMMARY: the last
+    // suppressed sample's timestamp.
+    uint32_t timestampUs;
+
+    // SAMPLE/HEARTBEAT: the sample. SUMMARY: unused.
+    int32_t fieldUt;
+
+    // SUMMARY only: the first suppressed sample's timestamp, the number of
+    // samples suppressed and their range.
+    uint32_t startUs;
+    uint32_t suppressed;
+    int32_t minUt;
+    int32_t maxUt;
+} si7210_report_t;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t reported;
+    uint32_t heartbeats;
+    uint32_t summaries;
+} si7210_deadband_stats_t;
+
+// Reports a sample only when it differs from the last reported one by more
+// than the deadband, or when nothing has been reported for the heartbeat
+// interval. With summaries on, the samples held back in between are
+// reported as one SUMMARY (time span, count, min and max) just before the
+// next SAMPLE or HEARTBEAT, so excursions inside the deadband aren't lost
+// completely.
+//
+// Constant time per sample and no heap. Not thread safe; feed it from one
+// thread.
+//
+// Example:
+//      void onReport(void *context, const si7210_report_t *report) { ... }
+//
+//      si7210_deadband deadband(20, 1000000, true, onReport, NULL);
+//      si7210_sampler sampler(&hall, si7210_deadband::onSample, &deadband);
+class si7210_deadband
+{
+public:
+    // Called with each report.
+    typedef void (*callback_t)(void *context, const si7210_report_t *report);
+
+    // @param deadbandUt    Samples within this of the last reported one are
+    //                      suppressed.
+    // @param heartbeatUs   Report a sample at least this often. 0 for
+    //                      never.
+    // @param summaries     Report min/max summaries of suppressed samples.
+    // @param cb            Called with each report.
+    // @param *context      Passed to cb.
+    si7210_deadband(int32_t deadbandUt, uint32_t heartbeatUs, bool summaries, callback_t cb, void *context);
+
+    // Forgets the last reported sample (so the next one is reported) and
+    // clears the statistics.
+    void reset();
+
+    // Feeds one sample.
+    //
+    // @return  True if the sample was reported (SAMPLE or HEARTBEAT).
+    bool add(uint32_t timestampUs, int32_t fieldUt);
+
+    // si7210_sampler callback. context is the si7210_deadband.
+    static void onSample(void *context, const si7210_sample_t *sample);
+
+    void getStats(si7210_deadband_stats_t *stats) { *stats = counts; }
+
+private:
+    int32_t deadband;
+    uint32_t heartbeat;
+    bool summarise;
+    callback_t onReport;
+    void *callbackContext;
+
+    // The last reported sample
+    bool haveReported;
+    int32_t reportedUt;
+    uint32_t reportedUs;
+
+    // The samples suppressed since
+    si7210_report_t pending;
+
+    si7210_deadband_stats_t counts;
+
+    // Reports sample as kind, after the summary of anything suppressed.
+    void report(si7210_report_kind_t kind, uint32_t timestampUs, int32_t fieldUt);
+};
+
+#endif //SI7210_DEADBAND_H
@@ -0,0 +1,145 @@
+// File: si7210_discovery.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Finding the Si7210 sensors on one or more I2C buses at boot, and
+// reading their identity.
+
+#include "si7210_discovery.h"
+#include "si7210.h"
+#include <string.h>
+
+#ifndef __MBED__
+#include <thread>
+#endif
+
+// One bus' share of si7210_discover()
+typedef struct
+{
+    si7210_bus *bus;
+    uint8_t index;
+    bool readIdentity;
+    si7210_device_info_t found[SI7210_DISCOVERY_NUM_ADDRS];
+    size_t numFound;
+} bus_scan_t;
+
+// Reads a byte of OTP memory. otp_addr, otp_data and otp_ctrl are
+// consecutive registers, so setting the address and starting the read is
+// one burst (otp_data is read only, the byte written to it is ignored).
+static bool readOtp(si7210_bus *bus, uint8_t addr8, uint8_t otpAddr, uint8_t *data)
+{
+    uint8_t tx[4] = {REG_OTP_ADDR, otpAddr, 0, OTP_READ_EN_MASK};
+    uint8_t reg = REG_OTP_DATA;
+    return bus->transfer(addr8, tx, sizeof(tx), NULL, 0) && bus->transfer(addr8, &reg, 1, data, 1);
+}
+
+static bool readIdentity(si7210_bus *bus, si7210_device_info_t *info)
+{
+    uint8_t addr8 = info->addr7 << 1;
+    uint8_t serial[4];
+
+    bool ok = readOtp(bus, addr8, OTP_PART_BASE, &info->partBase) &&
+              readOtp(bus, addr8, OTP_PART_VARIANT, &info->variant);
+    for (uint8_t i = 0; ok && i < sizeof(serial); i++)
+    {
+        ok = readOtp(bus, addr8, OTP_SERIAL + i, &serial[i]);
+    }
+
+    info->serial = ok ? ((uint32_t)serial[0] << 24) | ((uint32_t)serial[1] << 16) | ((uint32_t)serial[2] << 8) | serial[3] : 0;
+    return ok;
+}
+
+size_t si7210_discover_bus(si7210_bus *bus, uint8_t busIndex, si7210_device_info_t *found, size_t maxFound,
+                           bool identity)
+{
+    si7210_bus_lock lock(bus, si7210_priority_t::CONFIG);
+
+    size_t n = 0;
+    for (uint8_t i = 0; i < SI7210_DISCOVERY_NUM_ADDRS && n < maxFound; i++)
+    {
+        uint8_t addr7 = SI7210_DISCOVERY_FIRST_ADDR + i;
+        uint8_t reg = REG_0XC0;
+        uint8_t id;
+        if (!bus->transfer(addr7 << 1, &reg, 1, &id, 1) || (id >> CHIPID_SHIFT) != SI7210_CHIP_ID)
+        {
+            continue;
+        }
+
+        si7210_device_info_t *info = &found[n++];
+        memset(info, 0, sizeof(*info));
+        info->bus = busIndex;
+        info->addr7 = addr7;
+        info->chipId = id >> CHIPID_SHIFT;
+        info->revId = id & REVID_MASK;
+        info->haveIdentity = identity && readIdentity(bus, info);
+    }
+
+    return n;
+}
+
+static void scanBus(bus_scan_t *scan)
+{
+    scan->numFound = si7210_discover_bus(scan->bus, scan->index, scan->found, SI7210_DISCOVERY_NUM_ADDRS,
+                                         scan->readIdentity);
+}
+
+size_t si7210_discover(si7210_bus **buses, size_t numBuses, si7210_device_info_t *found, size_t maxFound,
+                       bool readIdentity)
+{
+    if (numBuses > SI7210_DISCOVERY_MAX_BUSES)
+    {
+        numBuses = SI7210_DISCOVERY_MAX_BUSES;
+    }
+
+    bus_scan_t scans[SI7210_DISCOVERY_MAX_BUSES];
+    for (size_t i = 0; i < numBuses; i++)
+    {
+        scans[i].bus = buses[i];
+        scans[i].index = (uint8_t)i;
+        scans[i].readIdentity = readIdentity;
+        scans[i].numFound = 0;
+    }
+
+    // The other buses from their own threads, the first from this one
+#ifdef __MBED__
+    rtos::Thread *threads[SI7210_DISCOVERY_MAX_BUSES];
+    for (size_t i = 1; i < numBuses; i++)
+    {
+        threads[i] = new rtos::Thread(osPriorityAboveNormal);
+        threads[i]->start(mbed::callback(scanBus, &scans[i]));
+    }
+#else
+    std::thread threads[SI7210_DISCOVERY_MAX_BUSES];
+    for (size_t i = 1; i < numBuses; i++)
+    {
+        threads[i] = std::thread(scanBus, &scans[i]);
+    }
+#endif
+
+    if (numBuses > 0)
+    {
+        scanBus(&scans[0]);
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < numBuses; i++)
+    {
+        if (i > 0)
+        {
+#ifdef __MBED__
+            threads[i]->join();
+            delete threads[i];
+#else
+            threads[i].join();
+#endif
+        }
+
+        for (size_t j = 0; j < scans[i].numFound && n < maxFound; j++)
+        {
+            found[n++] = scans[i].found[j];
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,81 @@
+// File: si7210_discovery.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Finding the Si7210 sensors on one or more I2C buses at boot, and
+// reading their identity.
+
+#ifndef SI7210_DISCOVERY_H
+#define SI7210_DISCOVERY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "si7210_bus.h"
+
+// The Si7210 comes in variants at 7 bit addresses 0x30-0x33.
+#define SI7210_DISCOVERY_FIRST_ADDR 0x30U
+#define SI7210_DISCOVERY_NUM_ADDRS 4
+
+// Maximum number of buses si7210_discover() scans.
+#define SI7210_DISCOVERY_MAX_BUSES 8
+
+// A sensor found by si7210_discover().
+typedef struct
+{
+    // Index of the sensor's bus in the buses passed to si7210_discover().
+    uint8_t bus;
+
+    // 7 bit address, as si7210's constructor takes it.
+    uint8_t addr7;
+
+    uint8_t chipId;
+    uint8_t revId;
+
+    // Read from the sensor's OTP memory, if asked for and the reads
+    // succeeded.
+    bool haveIdentity;
+    uint8_t partBase;
+    uint8_t variant;
+    uint32_t serial;
+} si7210_device_info_t;
+
+// Finds the Si7210 sensors on one bus. Each address is probed with a single
+// read of chipid/revid, so a missing sensor costs only an address NACK.
+// Devices at these addresses that aren't a Si7210 are skipped. The identity
+// takes two transactions per OTP byte (6 bytes).
+//
+// @param *bus          The bus to scan. Held at CONFIG priority while
+//                      scanning.
+// @param busIndex      Stored in each si7210_device_info_t's bus.
+// @param *found        Where to store the sensors found, by address.
+// @param maxFound      Size of found.
+// @param readIdentity  Also read each sensor's part number and serial.
+// @return              Number of sensors stored in found.
+size_t si7210_discover_bus(si7210_bus *bus, uint8_t busIndex, si7210_device_info_t *found, size_t maxFound,
+                           bool readIdentity = true);
+
+// Finds the Si7210 sensors on several buses at once. Buses after the first
+// are scanned from their own threads, so the scan takes about as long as
+// the busiest bus rather than the sum of all of them.
+//
+// Example:
+//      si7210_bus *buses[] = {&bus0, &bus1};
+//      si7210_device_info_t found[2 * SI7210_DISCOVERY_NUM_ADDRS];
+//      size_t n = si7210_discover(buses, 2, found, 8);
+//      for (size_t i = 0; i < n; i++)
+//      {
+//          sensors[i] = new si7210(buses[found[i].bus], found[i].addr7, ...);
+//      }
+//
+// @param **buses       The buses to scan. At most SI7210_DISCOVERY_MAX_BUSES.
+// @param numBuses      Number of buses.
+// @param *found        Where to store the sensors found, by bus and then
+//                      address.
+// @param maxFound      Size of found.
+// @param readIdentity  Also read each sensor's part number and serial.
+// @return              Number of sensors stored in found.
+size_t si7210_discover(si7210_bus **buses, size_t numBuses, si7210_device_info_t *found, size_t maxFound,
+                       bool readIdentity = true);
+
+#endif //SI7210_DISCOVERY_H
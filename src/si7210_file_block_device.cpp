@@ -0,0 +1,167 @@
+// File: si7210_file_block_device.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: A file backed stand-in for a flash block device.
+
+#include "si7210_file_block_device.h"
+#include <string.h>
+
+// Bytes moved per file read/write
+#define CHUNK 256
+
+si7210_file_block_device::si7210_file_block_device(const char *path, uint32_t totalSize, uint32_t programBlock, uint32_t eraseBlock)
+{
+    totalBytes = totalSize;
+    progSize = programBlock;
+    eraseBlockSize = eraseBlock;
+    powerBudget = UINT32_MAX;
+    erases = 0;
+    programmed = 0;
+    readBytes = 0;
+    eraseCounts = new uint32_t[totalSize / eraseBlock]();
+
+    file = fopen(path, "r+b");
+    long length = -1;
+    if (file != NULL && fseek(file, 0, SEEK_END) == 0)
+    {
+        length = ftell(file);
+    }
+
+    if (length != (long)totalSize)
+    {
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+
+        // New (erased) device
+        file = fopen(path, "w+b");
+        if (file != NULL)
+        {
+            uint8_t erased[CHUNK];
+            memset(erased, 0xFF, sizeof(erased));
+            for (uint32_t addr = 0; addr < totalSize; addr += CHUNK)
+            {
+                fwrite(erased, 1, CHUNK, file);
+            }
+            fflush(file);
+        }
+    }
+}
+
+si7210_file_block_device::~si7210_file_block_device()
+{
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+    delete[] eraseCounts;
+}
+
+bool si7210_file_block_device::read(void *buf, uint32_t addr, uint32_t len)
+{
+    if (file == NULL || addr + len > totalBytes || addr + len < addr)
+    {
+        return false;
+    }
+
+    readBytes += len;
+    return fseek(file, addr, SEEK_SET) == 0 && fread(buf, 1, len, file) == len;
+}
+
+bool si7210_file_block_device::program(const void *buf, uint32_t addr, uint32_t len)
+{
+    if (file == NULL || addr % progSize != 0 || len % progSize != 0 || addr + len > totalBytes || addr + len < addr)
+    {
+        return false;
+    }
+
+    uint32_t allowed = spend(len);
+    const uint8_t *src = (const uint8_t *)buf;
+    uint8_t cells[CHUNK];
+
+    // Like NOR flash, programming can only clear bits
+    for (uint32_t done = 0; done < allowed; done += CHUNK)
+    {
+        uint32_t n = allowed - done < CHUNK ? allowed - done : CHUNK;
+        if (fseek(file, addr + done, SEEK_SET) != 0 || fread(cells, 1, n, file) != n)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            cells[i] &= src[done + i];
+        }
+        if (fseek(file, addr + done, SEEK_SET) != 0 || fwrite(cells, 1, n, file) != n)
+        {
+            return false;
+        }
+    }
+    fflush(file);
+
+    programmed += allowed;
+    return allowed == len;
+}
+
+bool si7210_file_block_device::erase(uint32_t addr, uint32_t len)
+{
+    if (file == NULL || addr % eraseBlockSize != 0 || len % eraseBlockSize != 0 || addr + len > totalBytes || addr + len < addr)
+    {
+        return false;
+    }
+
+    uint32_t allowed = spend(len);
+    uint8_t erased[CHUNK];
+    memset(erased, 0xFF, sizeof(erased));
+
+    if (fseek(file, addr, SEEK_SET) != 0)
+    {
+        return false;
+    }
+    for (uint32_t done = 0; done < allowed; done += CHUNK)
+    {
+        uint32_t n = allowed - done < CHUNK ? allowed - done : CHUNK;
+        if (fwrite(erased, 1, n, file) != n)
+        {
+            return false;
+        }
+    }
+    fflush(file);
+
+    for (uint32_t block = addr / eraseBlockSize; block < (addr + allowed) / eraseBlockSize; block++)
+    {
+        eraseCounts[block]++;
+        erases++;
+    }
+
+    return allowed == len;
+}
+
+void si7210_file_block_device::cutPowerAfter(uint32_t bytes)
+{
+    powerBudget = bytes;
+}
+
+void si7210_file_block_device::restorePower()
+{
+    powerBudget = UINT32_MAX;
+}
+
+uint32_t si7210_file_block_device::eraseCount(uint32_t i)
+{
+    return i < totalBytes / eraseBlockSize ? eraseCounts[i] : 0;
+}
+
+uint32_t si7210_file_block_device::spend(uint32_t len)
+{
+    if (powerBudget == UINT32_MAX)
+    {
+        return len;
+    }
+
+    uint32_t allowed = len < powerBudget ? len : powerBudget;
+    powerBudget -= allowed;
+    return allowed;
+}
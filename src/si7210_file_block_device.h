@@ -0,0 +1,77 @@
+// File: si7210_file_block_device.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: A file backed stand-in for a flash block device, for running
+// the sample log on a host. Behaves like NOR flash (programming can only
+// clear bits), counts erases per block and can simulate a power cut part
+// way through a program or erase.
+
+#ifndef SI7210_FILE_BLOCK_DEVICE_H
+#define SI7210_FILE_BLOCK_DEVICE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "si7210_block_device.h"
+
+class si7210_file_block_device : public si7210_block_device
+{
+public:
+    // Opens the file, creating it (fully erased) if it doesn't exist or is
+    // the wrong size.
+    //
+    // @param *path         The backing file.
+    // @param totalSize     Device size in bytes. Multiple of eraseBlock.
+    // @param programBlock  Program size in bytes.
+    // @param eraseBlock    Erase size in bytes. Multiple of programBlock.
+    si7210_file_block_device(const char *path, uint32_t totalSize, uint32_t programBlock = 8, uint32_t eraseBlock = 4096);
+    ~si7210_file_block_device();
+
+    // @return  True if the file opened.
+    bool isOpen() { return file != NULL; }
+
+    bool read(void *buf, uint32_t addr, uint32_t len);
+    bool program(const void *buf, uint32_t addr, uint32_t len);
+    bool erase(uint32_t addr, uint32_t len);
+    uint32_t programSize() { return progSize; }
+    uint32_t eraseSize() { return eraseBlockSize; }
+    uint32_t size() { return totalBytes; }
+
+    // Lets the next bytes programmed or erased through, then "cuts the
+    // power": the program/erase in progress stops part way and fails, as do
+    // all later ones until restorePower().
+    void cutPowerAfter(uint32_t bytes);
+    void restorePower();
+
+    // @return  How many times erase block i has been erased.
+    uint32_t eraseCount(uint32_t i);
+
+    uint32_t totalErases() { return erases; }
+    uint64_t bytesProgrammed() { return programmed; }
+    uint64_t bytesRead() { return readBytes; }
+
+private:
+    FILE *file;
+    uint32_t totalBytes;
+    uint32_t progSize;
+    uint32_t eraseBlockSize;
+
+    // Remaining bytes before the power cut. UINT32_MAX while powered.
+    uint32_t powerBudget;
+
+    // Erase counts, one per erase block
+    uint32_t *eraseCounts;
+    uint32_t erases;
+    uint64_t programmed;
+    uint64_t readBytes;
+
+    // @return  How many of len bytes can be written before the power cut.
+    uint32_t spend(uint32_t len);
+
+    // Copying would share the file.
+    si7210_file_block_device(const si7210_file_block_device &);
+    si7210_file_block_device &operator=(const si7210_file_block_device &);
+};
+
+#endif //SI7210_FILE_BLOCK_DEVICE_H
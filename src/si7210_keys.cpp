@@ -0,0 +1,169 @@
+// File: si7210_keys.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Key press/release events from hall-effect key readings.
+
+#include "si7210_keys.h"
+#include <string.h>
+
+si7210_keys::si7210_keys(callback_t cb, void *context)
+{
+    numKeys = 0;
+    onEvent = cb;
+    callbackContext = context;
+    memset(&counts, 0, sizeof(counts));
+}
+
+bool si7210_keys::isValid(const si7210_key_config_t *config)
+{
+    return config->restUt != config->pressedUt && config->release < config->actuation &&
+           config->actuation <= SI7210_KEY_TRAVEL_FULL && config->rapidTrigger <= SI7210_KEY_TRAVEL_FULL;
+}
+
+void si7210_keys::setConfig(key_state_t *k, const si7210_key_config_t *config)
+{
+    k->config = *config;
+    int64_t span = (int64_t)config->pressedUt - config->restUt;
+    int64_t full = (int64_t)SI7210_KEY_TRAVEL_FULL << 16;
+    k->scaleQ16 = (int32_t)((span > 0 ? full + span / 2 : full - span / 2) / span);
+}
+
+int si7210_keys::addKey(const si7210_key_config_t *config)
+{
+    if (numKeys == SI7210_KEYS_MAX || !isValid(config))
+    {
+        return -1;
+    }
+
+    key_state_t *k = &keys[numKeys];
+    memset(k, 0, sizeof(*k));
+    setConfig(k, config);
+
+    return numKeys++;
+}
+
+bool si7210_keys::configure(uint16_t key, const si7210_key_config_t *config)
+{
+    if (key >= numKeys || !isValid(config))
+    {
+        return false;
+    }
+
+    setConfig(&keys[key], config);
+    return true;
+}
+
+bool si7210_keys::add(uint16_t key, uint32_t timestampUs, int32_t fieldUt)
+{
+    if (key >= numKeys)
+    {
+        return false;
+    }
+
+    key_state_t *k = &keys[key];
+    counts.samples++;
+
+    // Field to travel, rounded. The scale's sign takes care of which way the
+    // field goes.
+    int32_t travel = (int32_t)(((int64_t)(fieldUt - k->config.restUt) * k->scaleQ16 + 0x8000) >> 16);
+    travel = travel < 0 ? 0 : (travel > SI7210_KEY_TRAVEL_FULL ? SI7210_KEY_TRAVEL_FULL : travel);
+    uint16_t t = (uint16_t)travel;
+    k->travel = t;
+
+    k->historyUs[k->historyNext] = timestampUs;
+    k->historyTravel[k->historyNext] = t;
+    k->historyNext = (k->historyNext + 1) & (SI7210_KEY_VELOCITY_SAMPLES - 1);
+    if (k->historyCount < SI7210_KEY_VELOCITY_SAMPLES)
+    {
+        k->historyCount++;
+    }
+
+    uint16_t rapid = k->config.rapidTrigger;
+    if (k->pressed)
+    {
+        k->extreme = t > k->extreme ? t : k->extreme;
+
+        if (t <= k->config.release)
+        {
+            if (change(key, false, timestampUs))
+            {
+                k->rapidArmed = false;
+            }
+        }
+        else if (rapid > 0 && t + rapid <= k->extreme)
+        {
+            change(key, false, timestampUs);
+        }
+    }
+    else
+    {
+        k->extreme = t < k->extreme ? t : k->extreme;
+        if (t <= k->config.release)
+        {
+            k->rapidArmed = false;
+        }
+
+        // Released by rapid trigger, only moving back down counts; the
+        // actuation point applies again once the key has come all the way up
+        bool press = rapid > 0 && k->rapidArmed ? t >= k->extreme + rapid : t >= k->config.actuation;
+        if (press)
+        {
+            if (change(key, true, timestampUs))
+            {
+                k->rapidArmed = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool si7210_keys::change(uint16_t key, bool press, uint32_t timestampUs)
+{
+    key_state_t *k = &keys[key];
+
+    if (k->haveChanged && timestampUs - k->changedUs < k->config.debounceUs)
+    {
+        counts.debounced++;
+        return false;
+    }
+
+    k->pressed = press;
+    k->extreme = k->travel;
+    k->haveChanged = true;
+    k->changedUs = timestampUs;
+    if (press)
+    {
+        counts.presses++;
+    }
+    else
+    {
+        counts.releases++;
+    }
+
+    if (onEvent != NULL)
+    {
+        // Velocity over the last few samples. The oldest is the next to be
+        // overwritten once the history is full.
+        uint8_t oldest = k->historyCount < SI7210_KEY_VELOCITY_SAMPLES ? 0 : k->historyNext;
+        uint32_t dtUs = timestampUs - k->historyUs[oldest];
+
+        si7210_key_event_t event;
+        event.key = key;
+        event.kind = press ? si7210_key_event_kind_t::PRESS : si7210_key_event_kind_t::RELEASE;
+        event.timestampUs = timestampUs;
+        event.travel = k->travel;
+        event.velocity = dtUs == 0 ? 0 : (int32_t)((int64_t)((int32_t)k->travel - k->historyTravel[oldest]) * 1000000 / dtUs);
+        onEvent(callbackContext, &event);
+    }
+
+    return true;
+}
+
+void si7210_keys::onSample(void *context, const si7210_sample_t *sample)
+{
+    si7210_key_binding_t *binding = (si7210_key_binding_t *)context;
+    binding->keys->add(binding->key, sample->timestampUs, sample->fieldUt);
+}
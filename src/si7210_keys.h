@@ -0,0 +1,189 @@
+// File: si7210_keys.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Key press/release events from hall-effect key readings:
+// actuation and release points with hysteresis, rapid trigger, debounce and
+// press velocity, for many keys across any number of sensors.
+
+#ifndef SI7210_KEYS_H
+#define SI7210_KEYS_H
+
+#include <stdint.h>
+#include "si7210_sampler.h"
+
+// Maximum number of keys one si7210_keys tracks.
+#ifndef SI7210_KEYS_MAX
+#define SI7210_KEYS_MAX 64
+#endif
+
+// Key travel is in thousandths of the full travel: 0 at rest, 1000
+// bottomed out.
+#define SI7210_KEY_TRAVEL_FULL 1000
+
+// Samples over which velocity is measured (a power of 2).
+#define SI7210_KEY_VELOCITY_SAMPLES 4
+
+typedef struct
+{
+    // Field with the key at rest and fully pressed. Either may be the
+    // larger; travel is linear in between and clamped outside.
+    int32_t restUt;
+    int32_t pressedUt;
+
+    // Travel at which the key presses, and at which it releases again.
+    // release < actuation; the gap is the hysteresis.
+    uint16_t actuation;
+    uint16_t release;
+
+    // Rapid trigger: once pressed, the key releases as soon as it rises by
+    // this much from its deepest point, and presses again as soon as it
+    // falls by this much from its highest point, until it comes all the way
+    // up past the release point. 0 for off.
+    uint16_t rapidTrigger;
+
+    // Minimum time between a key's state changes.
+    uint32_t debounceUs;
+} si7210_key_config_t;
+
+typedef enum class si7210_key_event_kind_t
+{
+    PRESS,
+    RELEASE
+} si7210_key_event_kind_t;
+
+typedef struct
+{
+    uint16_t key;
+    si7210_key_event_kind_t kind;
+
+    // The timestamp of the sample that caused the event.
+    uint32_t timestampUs;
+
+    // The key's travel then.
+    uint16_t travel;
+
+    // The key's speed then, in travel per second (1000 = a full stroke per
+    // second). Positive going down.
+    int32_t velocity;
+} si7210_key_event_t;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t presses;
+    uint32_t releases;
+
+    // Samples whose state change was held back by debounce.
+    uint32_t debounced;
+} si7210_keys_stats_t;
+
+class si7210_keys;
+
+// Ties one sensor's si7210_sampler to one key. context for
+// si7210_keys::onSample().
+typedef struct
+{
+    si7210_keys *keys;
+    uint16_t key;
+} si7210_key_binding_t;
+
+// Tracks the state of up to SI7210_KEYS_MAX keys from their field readings
+// and reports presses and releases.
+//
+// Integer only, constant time per sample and no heap. Not thread safe; feed
+// it from one thread (or a lock around add() when several samplers share
+// it).
+//
+// Example:
+//      void onKey(void *context, const si7210_key_event_t *event) { ... }
+//
+//      si7210_key_config_t config = {0, 2500, 500, 400, 50, 0};
+//      si7210_keys keys(onKey, NULL);
+//      si7210_key_binding_t binding = {&keys, (uint16_t)keys.addKey(&config)};
+//      si7210_sampler sampler(&hall, si7210_keys::onSample, &binding);
+class si7210_keys
+{
+public:
+    // Called with each event.
+    typedef void (*callback_t)(void *context, const si7210_key_event_t *event);
+
+    // @param cb        Called with each event.
+    // @param *context  Passed to cb.
+    si7210_keys(callback_t cb, void *context);
+
+    // Adds a key, released.
+    //
+    // @return  The key's number, or -1 if the config is invalid or there are
+    //          already SI7210_KEYS_MAX keys.
+    int addKey(const si7210_key_config_t *config);
+
+    // Changes a key's config, e.g. after calibration. Its state is kept.
+    //
+    // @return  True on success. False if the key doesn't exist or the config
+    //          is invalid.
+    bool configure(uint16_t key, const si7210_key_config_t *config);
+
+    // Feeds one of a key's samples. Timestamps must increase (but may wrap).
+    //
+    // @return  True on success. False if the key doesn't exist.
+    bool add(uint16_t key, uint32_t timestampUs, int32_t fieldUt);
+
+    // si7210_sampler callback. context is a si7210_key_binding_t.
+    static void onSample(void *context, const si7210_sample_t *sample);
+
+    bool isPressed(uint16_t key) { return key < numKeys && keys[key].pressed; }
+
+    // @return  The key's travel at its last sample.
+    uint16_t getTravel(uint16_t key) { return key < numKeys ? keys[key].travel : 0; }
+
+    void getStats(si7210_keys_stats_t *stats) { *stats = counts; }
+
+private:
+    typedef struct
+    {
+        si7210_key_config_t config;
+
+        // Travel per uT in Q16
+        int32_t scaleQ16;
+
+        bool pressed;
+
+        // Pressed since the key was last all the way up (rapid trigger can
+        // re-press it)
+        bool rapidArmed;
+
+        // Deepest travel while pressed, highest while released
+        uint16_t extreme;
+        uint16_t travel;
+
+        bool haveChanged;
+        uint32_t changedUs;
+
+        // The last samples, for velocity
+        uint32_t historyUs[SI7210_KEY_VELOCITY_SAMPLES];
+        uint16_t historyTravel[SI7210_KEY_VELOCITY_SAMPLES];
+        uint8_t historyNext;
+        uint8_t historyCount;
+    } key_state_t;
+
+    key_state_t keys[SI7210_KEYS_MAX];
+    uint16_t numKeys;
+    callback_t onEvent;
+    void *callbackContext;
+    si7210_keys_stats_t counts;
+
+    // @return  True if config is usable.
+    static bool isValid(const si7210_key_config_t *config);
+
+    // Sets k's config and the values derived from it.
+    static void setConfig(key_state_t *k, const si7210_key_config_t *config);
+
+    // Changes key's state and reports it, unless debounced.
+    //
+    // @return  True if the state changed.
+    bool change(uint16_t key, bool press, uint32_t timestampUs);
+};
+
+#endif //SI7210_KEYS_H
@@ -0,0 +1,142 @@
+// File: si7210_linux_bus.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Linux i2c-dev backend for the driver's bus layer, so the same
+// driver runs on Linux boards (e.g. test stations) over /dev/i2c-N.
+
+#include "si7210_linux_bus.h"
+
+#if defined(__linux__) && !defined(__MBED__)
+
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+static int sysOpen(void *, const char *path, int flags)
+{
+    return ::open(path, flags);
+}
+
+static int sysClose(void *, int fd)
+{
+    return ::close(fd);
+}
+
+static int sysIoctl(void *, int fd, unsigned long request, void *arg)
+{
+    return ::ioctl(fd, request, arg);
+}
+
+static ssize_t sysRead(void *, int fd, void *buf, size_t len)
+{
+    return ::read(fd, buf, len);
+}
+
+static ssize_t sysWrite(void *, int fd, const void *buf, size_t len)
+{
+    return ::write(fd, buf, len);
+}
+
+const si7210_linux_syscalls_t si7210_linux_syscalls = {sysOpen, sysClose, sysIoctl, sysRead, sysWrite, NULL};
+
+si7210_linux_bus::si7210_linux_bus(int adapter, bool combined, const si7210_linux_syscalls_t *s)
+{
+    sys = s != NULL ? s : &si7210_linux_syscalls;
+    useRdwr = combined;
+    slave = -1;
+
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/i2c-%d", adapter);
+    fd = sys->open(sys->context, path, O_RDWR);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    unsigned long funcs = 0;
+    if (sys->ioctl(sys->context, fd, I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C))
+    {
+        sys->close(sys->context, fd);
+        fd = -1;
+    }
+}
+
+si7210_linux_bus::~si7210_linux_bus()
+{
+    if (fd >= 0)
+    {
+        sys->close(sys->context, fd);
+    }
+}
+
+bool si7210_linux_bus::transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    if (fd < 0 || (txLen == 0 && rxLen == 0))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> held(mutex);
+    if (useRdwr)
+    {
+        return transferRdwr(addr8 >> 1, tx, txLen, rx, rxLen);
+    }
+    return transferReadWrite(addr8 >> 1, tx, txLen, rx, rxLen);
+}
+
+bool si7210_linux_bus::transferRdwr(uint8_t addr7, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    struct i2c_msg msgs[2];
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = msgs;
+    data.nmsgs = 0;
+
+    if (txLen > 0)
+    {
+        msgs[data.nmsgs].addr = addr7;
+        msgs[data.nmsgs].flags = 0;
+        msgs[data.nmsgs].len = (uint16_t)txLen;
+        msgs[data.nmsgs].buf = (uint8_t *)tx;
+        data.nmsgs++;
+    }
+
+    // The kernel puts a repeated start between messages
+    if (rxLen > 0)
+    {
+        msgs[data.nmsgs].addr = addr7;
+        msgs[data.nmsgs].flags = I2C_M_RD;
+        msgs[data.nmsgs].len = (uint16_t)rxLen;
+        msgs[data.nmsgs].buf = rx;
+        data.nmsgs++;
+    }
+
+    // Returns the number of messages transferred
+    return sys->ioctl(sys->context, fd, I2C_RDWR, &data) == (int)data.nmsgs;
+}
+
+bool si7210_linux_bus::transferReadWrite(uint8_t addr7, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    if (slave != addr7)
+    {
+        if (sys->ioctl(sys->context, fd, I2C_SLAVE, (void *)(unsigned long)addr7) < 0)
+        {
+            slave = -1;
+            return false;
+        }
+        slave = addr7;
+    }
+
+    if (txLen > 0 && sys->write(sys->context, fd, tx, txLen) != (ssize_t)txLen)
+    {
+        return false;
+    }
+
+    return rxLen == 0 || sys->read(sys->context, fd, rx, rxLen) == (ssize_t)rxLen;
+}
+
+#endif
@@ -0,0 +1,93 @@
+// File: si7210_linux_bus.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Linux i2c-dev backend for the driver's bus layer, so the same
+// driver runs on Linux boards (e.g. test stations) over /dev/i2c-N.
+
+#ifndef SI7210_LINUX_BUS_H
+#define SI7210_LINUX_BUS_H
+
+#if defined(__linux__) && !defined(__MBED__)
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "si7210_bus.h"
+
+// The system calls si7210_linux_bus makes. Replaceable so the backend can be
+// tested against an in-process fake of i2c-dev. context is passed back to
+// every call.
+typedef struct
+{
+    int (*open)(void *context, const char *path, int flags);
+    int (*close)(void *context, int fd);
+    int (*ioctl)(void *context, int fd, unsigned long request, void *arg);
+    ssize_t (*read)(void *context, int fd, void *buf, size_t len);
+    ssize_t (*write)(void *context, int fd, const void *buf, size_t len);
+    void *context;
+} si7210_linux_syscalls_t;
+
+// The real system calls.
+extern const si7210_linux_syscalls_t si7210_linux_syscalls;
+
+// I2C over a Linux i2c-dev adapter.
+//
+// Each transfer() is one I2C_RDWR ioctl: the register address write and the
+// data read go to the kernel as two messages of one combined transaction,
+// with a repeated start between them, as readRegister() expects. That is
+// one system call per transaction. The adapter must support plain I2C
+// (I2C_FUNC_I2C); SMBus only adapters, including the kernel's i2c-stub,
+// aren't usable.
+//
+// With combined set to false it instead selects the device with I2C_SLAVE
+// and then write()s and read()s separately, which puts a STOP and START
+// between the two halves and takes up to three system calls. That's only
+// there for comparison.
+//
+// Example:
+//      si7210_linux_bus bus(1); // /dev/i2c-1
+//      si7210 hall(&bus, 0x30, ...);
+class si7210_linux_bus : public si7210_bus
+{
+public:
+    // Opens /dev/i2c-<adapter>.
+    //
+    // @param adapter   The adapter number.
+    // @param combined  Use I2C_RDWR (true) or read()/write() (false).
+    // @param *sys      The system calls to make. NULL for the real ones.
+    si7210_linux_bus(int adapter, bool combined = true, const si7210_linux_syscalls_t *sys = NULL);
+
+    ~si7210_linux_bus();
+
+    // @return  True if the adapter was opened and supports plain I2C.
+    bool isOpen() { return fd >= 0; }
+
+    bool transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+    void lock(si7210_priority_t = si7210_priority_t::CONFIG) { mutex.lock(); }
+    void unlock() { mutex.unlock(); }
+
+private:
+    const si7210_linux_syscalls_t *sys;
+    int fd;
+    bool useRdwr;
+
+    // The address last selected with I2C_SLAVE, -1 if none
+    int slave;
+
+    // Also held by transfer(), since read()/write() are several calls
+    std::recursive_mutex mutex;
+
+    bool transferRdwr(uint8_t addr7, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+    bool transferReadWrite(uint8_t addr7, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+
+    // Copying would close the adapter twice.
+    si7210_linux_bus(const si7210_linux_bus &);
+    si7210_linux_bus &operator=(const si7210_linux_bus &);
+};
+
+#endif
+
+#endif //SI7210_LINUX_BUS_H
@@ -0,0 +1,455 @@
+// File: si7210_log.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: A persistent circular sample log on a flash block device.
+
+#include "si7210_log.h"
+#include <string.h>
+#include "si7210_bytes.h"
+#include "si7210_codec.h"
+
+// Record layout, little endian:
+//   0  magic (2)
+//   2  number of samples (2)
+//   4  sequence number (4)
+//   8  first timestamp (4)
+//  12  last timestamp (4)
+//  16  encoded timestamps length (2)
+//  18  encoded fields length (2)
+//  20  boot (4)
+//  24  encoded timestamps, encoded fields, then erased padding
+//  -4  CRC32 of everything before it
+#define RECORD_MAGIC 0x7210U
+#define HEADER_SIZE 24
+#define CRC_SIZE 4
+
+static const uint32_t crcNibbles[16] = {
+    0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+    0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+    0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+    0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU};
+
+// CRC-32 (IEEE 802.3), a nibble at a time to keep the table small
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crcNibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ crcNibbles[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+si7210_log::si7210_log(si7210_block_device *device, uint32_t recordSize)
+{
+    bd = device;
+    recordBytes = recordSize;
+    mounted = false;
+    slotsPerBlock = 0;
+    numSlots = 0;
+    tail = 0;
+    head = 0;
+    nextSeq = 0;
+    numPending = 0;
+    boot = 0;
+    newest = 0;
+    haveNewest = false;
+    recordsWritten = 0;
+    erases = 0;
+    skipped = 0;
+}
+
+bool si7210_log::mount()
+{
+    mounted = false;
+
+    uint32_t eraseBytes = bd->eraseSize();
+    if (recordBytes < SI7210_LOG_MIN_RECORD_SIZE || recordBytes > SI7210_LOG_MAX_RECORD_SIZE ||
+        bd->programSize() == 0 || recordBytes % bd->programSize() != 0 ||
+        eraseBytes == 0 || eraseBytes % recordBytes != 0 || bd->size() / eraseBytes < 2)
+    {
+        return false;
+    }
+
+    slotsPerBlock = eraseBytes / recordBytes;
+    uint32_t numBlocks = bd->size() / eraseBytes;
+    numSlots = numBlocks * slotsPerBlock;
+    numPending = 0;
+    boot = 0;
+    haveNewest = false;
+    recordsWritten = 0;
+    erases = 0;
+    skipped = 0;
+
+    // The first valid record of each erase block gives the block's place
+    // in the ring. Blocks are filled in order, so the newest block holds
+    // the newest record and the oldest block the oldest.
+    bool found = false;
+    uint32_t newestBlock = 0;
+    uint32_t newestSeq = 0;
+    uint32_t oldestSlot = 0;
+    uint32_t oldestSeq = 0;
+
+    for (uint32_t block = 0; block < numBlocks; block++)
+    {
+        for (uint32_t slot = block * slotsPerBlock; slot < (block + 1) * slotsPerBlock; slot++)
+        {
+            if (!readRecord(slot))
+            {
+                continue;
+            }
+
+            uint32_t seq = si7210_get32(page + 4);
+            if (!found || seq > newestSeq)
+            {
+                newestBlock = block;
+                newestSeq = seq;
+            }
+            if (!found || seq < oldestSeq)
+            {
+                oldestSlot = slot;
+                oldestSeq = seq;
+            }
+            found = true;
+            break;
+        }
+    }
+
+    if (!found)
+    {
+        // Nothing logged yet. Blocks are erased as they're first written.
+        tail = 0;
+        head = 0;
+        nextSeq = 0;
+        mounted = true;
+        return true;
+    }
+
+    // Find the end of the newest block: the first erased slot after its
+    // last valid record. Unreadable slots before that were torn by a power
+    // cut and are skipped.
+    uint32_t end = (newestBlock + 1) * slotsPerBlock;
+    uint32_t slot = newestBlock * slotsPerBlock;
+    head = end % numSlots;
+    for (; slot < end; slot++)
+    {
+        if (readRecord(slot))
+        {
+            newestSeq = si7210_get32(page + 4);
+            newest = si7210_log_position(si7210_get32(page + 20), si7210_get32(page + 12));
+            haveNewest = true;
+            head = after(slot);
+        }
+        else if (slotErased(slot))
+        {
+            head = slot;
+            break;
+        }
+    }
+
+    tail = oldestSlot;
+    if (head % slotsPerBlock == 0 && tail / slotsPerBlock == head / slotsPerBlock)
+    {
+        tail = ((head / slotsPerBlock + 1) % numBlocks) * slotsPerBlock;
+    }
+    nextSeq = newestSeq + 1;
+
+    // The clock may have restarted, so this boot's samples go after all of
+    // the last one's
+    boot = (uint32_t)(newest >> 32) + 1;
+    mounted = true;
+
+    return true;
+}
+
+bool si7210_log::format()
+{
+    if (!bd->erase(0, (bd->size() / bd->eraseSize()) * bd->eraseSize()))
+    {
+        return false;
+    }
+
+    return mount();
+}
+
+bool si7210_log::append(uint32_t timestamp, int32_t fieldUt)
+{
+    uint64_t position = si7210_log_position(boot, timestamp);
+    if (!mounted || (haveNewest && position < newest))
+    {
+        return false;
+    }
+
+    // Still full after a failed write
+    if (numPending == SI7210_LOG_MAX_RECORD_SAMPLES && writeRecord(numPending) == 0)
+    {
+        return false;
+    }
+
+    pendingTimes[numPending] = timestamp;
+    pendingFields[numPending] = fieldUt;
+    numPending++;
+    newest = position;
+    haveNewest = true;
+
+    // A full batch is written as one record. If it doesn't compress into
+    // one, the rest stay buffered for the next.
+    if (numPending == SI7210_LOG_MAX_RECORD_SAMPLES)
+    {
+        return writeRecord(numPending) > 0;
+    }
+
+    return true;
+}
+
+bool si7210_log::sync()
+{
+    while (numPending > 0)
+    {
+        if (writeRecord(numPending) == 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t si7210_log::writeRecord(uint32_t n)
+{
+    uint8_t *payload = page + HEADER_SIZE;
+    size_t space = recordBytes - HEADER_SIZE - CRC_SIZE;
+    size_t timesLen;
+    size_t fieldsLen;
+
+    // Fit as many samples as will compress into the record
+    while (true)
+    {
+        timesLen = si7210_encode_block((const int32_t *)pendingTimes, n, payload, space);
+        fieldsLen = timesLen > 0 ? si7210_encode_block(pendingFields, n, payload + timesLen, space - timesLen) : 0;
+        if (fieldsLen > 0)
+        {
+            break;
+        }
+        if (n == 1)
+        {
+            return 0;
+        }
+        n = n * 3 / 4;
+    }
+
+    si7210_put16(page, RECORD_MAGIC);
+    si7210_put16(page + 2, (uint16_t)n);
+    si7210_put32(page + 4, nextSeq);
+    si7210_put32(page + 8, pendingTimes[0]);
+    si7210_put32(page + 12, pendingTimes[n - 1]);
+    si7210_put16(page + 16, (uint16_t)timesLen);
+    si7210_put16(page + 18, (uint16_t)fieldsLen);
+    si7210_put32(page + 20, boot);
+    size_t used = HEADER_SIZE + timesLen + fieldsLen;
+    memset(page + used, bd->erasedValue(), recordBytes - CRC_SIZE - used);
+    si7210_put32(page + recordBytes - CRC_SIZE, crc32(page, recordBytes - CRC_SIZE));
+
+    // Entering a new erase block: erase it
+    if (head % slotsPerBlock == 0)
+    {
+        uint32_t block = head / slotsPerBlock;
+        if (!bd->erase(block * bd->eraseSize(), bd->eraseSize()))
+        {
+            return 0;
+        }
+        erases++;
+    }
+
+    // The slot is used even if programming fails part way, since it can't
+    // be programmed again without an erase.
+    uint32_t slot = head;
+    advanceHead();
+    if (!bd->program(page, slot * recordBytes, recordBytes))
+    {
+        skipped++;
+        return 0;
+    }
+    nextSeq++;
+    recordsWritten++;
+
+    numPending -= n;
+    memmove(pendingTimes, pendingTimes + n, numPending * sizeof(pendingTimes[0]));
+    memmove(pendingFields, pendingFields + n, numPending * sizeof(pendingFields[0]));
+
+    return n;
+}
+
+void si7210_log::advanceHead()
+{
+    head = after(head);
+
+    // Wrapped around to the oldest erase block: its records go when it's
+    // erased for the next write, so they're dropped now, keeping tail ==
+    // head only while the log is empty.
+    if (head % slotsPerBlock == 0 && tail / slotsPerBlock == head / slotsPerBlock)
+    {
+        tail = ((head / slotsPerBlock + 1) * slotsPerBlock) % numSlots;
+    }
+}
+
+bool si7210_log::readRecord(uint32_t slot)
+{
+    if (!bd->read(page, slot * recordBytes, recordBytes))
+    {
+        return false;
+    }
+
+    uint16_t count = si7210_get16(page + 2);
+    uint32_t payload = (uint32_t)si7210_get16(page + 16) + si7210_get16(page + 18);
+
+    return si7210_get16(page) == RECORD_MAGIC && count > 0 && count <= SI7210_LOG_MAX_RECORD_SAMPLES &&
+           HEADER_SIZE + payload <= recordBytes - CRC_SIZE &&
+           si7210_get32(page + recordBytes - CRC_SIZE) == crc32(page, recordBytes - CRC_SIZE);
+}
+
+bool si7210_log::slotErased(uint32_t slot)
+{
+    if (!bd->read(page, slot * recordBytes, recordBytes))
+    {
+        return false;
+    }
+
+    uint8_t erased = bd->erasedValue();
+    for (uint32_t i = 0; i < recordBytes; i++)
+    {
+        if (page[i] != erased)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t si7210_log::nextValid(uint32_t slot)
+{
+    while (slot != head && !readRecord(slot))
+    {
+        slot = after(slot);
+    }
+
+    return slot;
+}
+
+uint32_t si7210_log::read(uint64_t from, uint64_t to, callback_t cb, void *context)
+{
+    if (!mounted || from > to)
+    {
+        return 0;
+    }
+
+    uint32_t samples = 0;
+
+    if (tail != head)
+    {
+        // Binary search the erase blocks, in ring order from the one holding
+        // tail, for the last one that starts at or before from.
+        uint32_t numBlocks = numSlots / slotsPerBlock;
+        uint32_t tailBlock = tail / slotsPerBlock;
+        uint32_t headBlock = head / slotsPerBlock;
+        uint32_t lo = 0;
+        uint32_t hi = (headBlock + numBlocks - tailBlock) % numBlocks;
+
+        while (lo < hi)
+        {
+            uint32_t mid = (lo + hi + 1) / 2;
+            uint32_t start = ((tailBlock + mid) % numBlocks) * slotsPerBlock;
+            uint32_t slot = nextValid(start);
+            if (slot != head && si7210_log_position(si7210_get32(page + 20), si7210_get32(page + 8)) <= from)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid - 1;
+            }
+        }
+
+        // Then read forwards from there
+        uint32_t slot = lo == 0 ? tail : ((tailBlock + lo) % numBlocks) * slotsPerBlock;
+        while ((slot = nextValid(slot)) != head)
+        {
+            uint16_t count = si7210_get16(page + 2);
+            uint32_t recordBoot = si7210_get32(page + 20);
+            uint64_t first = si7210_log_position(recordBoot, si7210_get32(page + 8));
+            uint64_t last = si7210_log_position(recordBoot, si7210_get32(page + 12));
+            if (first > to)
+            {
+                break;
+            }
+
+            if (last >= from)
+            {
+                uint16_t timesLen = si7210_get16(page + 16);
+                uint16_t fieldsLen = si7210_get16(page + 18);
+                const uint8_t *payload = page + HEADER_SIZE;
+                if (si7210_decode_block(payload, timesLen, decodedTimes, SI7210_LOG_MAX_RECORD_SAMPLES, NULL) != count ||
+                    si7210_decode_block(payload + timesLen, fieldsLen, decodedFields, SI7210_LOG_MAX_RECORD_SAMPLES, NULL) != count)
+                {
+                    // Intact on flash but not a record this code can read
+                    skipped++;
+                }
+                else
+                {
+                    for (uint16_t i = 0; i < count; i++)
+                    {
+                        uint32_t t = (uint32_t)decodedTimes[i];
+                        uint64_t position = si7210_log_position(recordBoot, t);
+                        if (position >= from && position <= to)
+                        {
+                            cb(context, recordBoot, t, decodedFields[i]);
+                            samples++;
+                        }
+                    }
+                }
+            }
+
+            slot = after(slot);
+        }
+    }
+
+    for (uint32_t i = 0; i < numPending; i++)
+    {
+        uint64_t position = si7210_log_position(boot, pendingTimes[i]);
+        if (position >= from && position <= to)
+        {
+            cb(context, boot, pendingTimes[i], pendingFields[i]);
+            samples++;
+        }
+    }
+
+    return samples;
+}
+
+void si7210_log::getStats(si7210_log_stats_t *s)
+{
+    s->records = (head + numSlots - tail) % numSlots;
+    s->pending = numPending;
+    s->recordsWritten = recordsWritten;
+    s->erases = erases;
+    s->skipped = skipped;
+    s->boot = boot;
+    s->oldest = 0;
+    s->newest = haveNewest ? newest : 0;
+
+    if (mounted && tail != head && nextValid(tail) != head)
+    {
+        s->oldest = si7210_log_position(si7210_get32(page + 20), si7210_get32(page + 8));
+    }
+    else if (numPending > 0)
+    {
+        s->oldest = si7210_log_position(boot, pendingTimes[0]);
+    }
+}
@@ -0,0 +1,192 @@
+// File: si7210_log.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: A persistent circular sample log on a flash block device. Samples
+// are batched in RAM, compressed (si7210_codec.h) into fixed size CRC
+// protected records and written sequentially around the device, so each
+// erase block is erased once per lap. Survives power loss and finds
+// samples by timestamp.
+
+#ifndef SI7210_LOG_H
+#define SI7210_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "si7210_block_device.h"
+
+// Record size limits in bytes. Records must also be a multiple of the
+// device's program size and divide its erase size.
+#define SI7210_LOG_MIN_RECORD_SIZE 64
+#define SI7210_LOG_MAX_RECORD_SIZE 512
+
+// Maximum samples batched into one record.
+#define SI7210_LOG_MAX_RECORD_SAMPLES 128
+
+// A sample's place in the log: the boot it was logged in, then its
+// timestamp. Orders samples across resets that restart the clock.
+// @param boot      The boot number, see si7210_log::mount().
+// @param timestamp The sample's timestamp.
+// @return          The position, for si7210_log::read().
+static inline uint64_t si7210_log_position(uint32_t boot, uint32_t timestamp)
+{
+    return ((uint64_t)boot << 32) | timestamp;
+}
+
+typedef struct
+{
+    // Record slots in use, from the oldest record to the newest (including
+    // any skipped ones in between).
+    uint32_t records;
+
+    // Samples buffered in RAM, not yet written.
+    uint32_t pending;
+
+    // Positions (si7210_log_position()) of the oldest and newest samples,
+    // including the buffered ones. Both 0 if the log is empty.
+    uint64_t oldest;
+    uint64_t newest;
+
+    // The boot new samples are logged in.
+    uint32_t boot;
+
+    // Records written/erased by this object since mount().
+    uint32_t recordsWritten;
+    uint32_t erases;
+
+    // Unusable record slots skipped, e.g. after a power cut mid write, and
+    // records with a good CRC that read() couldn't decode (counted each
+    // time it meets one).
+    uint32_t skipped;
+} si7210_log_stats_t;
+
+// Circular log of (timestamp, field) samples.
+//
+// Layout: the device is split into erase blocks, each holding a whole
+// number of records. Records are written in order into slots around the
+// device; an erase block is erased just before its first slot is written,
+// which throws away the oldest records. Every record carries a sequence
+// number and a CRC32, so mount() can find the newest record after a reset
+// and ignore one that was torn by a power cut.
+//
+// Each mount() starts a new boot, recorded with every record, and samples
+// are ordered by (boot, timestamp). Timestamps can be in any unit but must
+// not go backwards or wrap within a boot (e.g. ms since boot, not
+// si7210_micros()); a clock that restarts from 0 on reset is fine.
+//
+// Example:
+//      si7210_file_block_device flash("log.bin", 1 << 20);
+//      si7210_log log(&flash);
+//      log.mount();
+//      log.append(timeMs, hall.getFieldStrength());
+//      ...
+//      log.read(si7210_log_position(boot, fromMs), si7210_log_position(boot, toMs), onSample, NULL);
+class si7210_log
+{
+public:
+    // Called for each sample read.
+    typedef void (*callback_t)(void *context, uint32_t boot, uint32_t timestamp, int32_t fieldUt);
+
+    // @param *device       The device to log to. Not owned.
+    // @param recordSize    Bytes per record (flash write). See
+    //                      SI7210_LOG_MIN/MAX_RECORD_SIZE.
+    si7210_log(si7210_block_device *device, uint32_t recordSize = 256);
+
+    // Finds the newest record on the device and continues after it,
+    // skipping any record torn by a power cut, in the boot after the newest
+    // record's. A device holding no log is started from the beginning
+    // (blocks are erased as they're reached) in boot 0.
+    //
+    // @return  True on success. False if the device can't hold records of
+    //          the requested size or can't be read.
+    bool mount();
+
+    // Erases the whole log.
+    //
+    // @return  True on success. False on failure.
+    bool format();
+
+    // Adds a sample. It is buffered and written once a record is full.
+    //
+    // @return  True on success. False if not mounted, the timestamp went
+    //          backwards since the last sample of this boot or a write
+    //          failed.
+    bool append(uint32_t timestamp, int32_t fieldUt);
+
+    // Writes the buffered samples now (in a partly filled record).
+    //
+    // @return  True on success. False on failure.
+    bool sync();
+
+    // Reads the samples at positions from from to to (inclusive), oldest
+    // first. Samples still buffered in RAM are included.
+    //
+    // @param from      si7210_log_position() of the first sample wanted.
+    // @param to        si7210_log_position() of the last sample wanted.
+    // @param cb        Called with each sample.
+    // @param *context  Passed to cb.
+    // @return          The number of samples read.
+    uint32_t read(uint64_t from, uint64_t to, callback_t cb, void *context);
+
+    void getStats(si7210_log_stats_t *stats);
+
+private:
+    si7210_block_device *bd;
+    uint32_t recordBytes;
+    bool mounted;
+
+    // Device geometry in record slots
+    uint32_t slotsPerBlock;
+    uint32_t numSlots;
+
+    // Oldest valid slot, next slot to write, and the sequence number for it
+    uint32_t tail;
+    uint32_t head;
+    uint32_t nextSeq;
+
+    // Samples waiting for a record
+    uint32_t pendingTimes[SI7210_LOG_MAX_RECORD_SAMPLES];
+    int32_t pendingFields[SI7210_LOG_MAX_RECORD_SAMPLES];
+    uint32_t numPending;
+
+    // The boot being logged, and the position of the newest sample
+    uint32_t boot;
+    uint64_t newest;
+    bool haveNewest;
+
+    uint32_t recordsWritten;
+    uint32_t erases;
+    uint32_t skipped;
+
+    // Record being written/read, and a read record's samples
+    uint8_t page[SI7210_LOG_MAX_RECORD_SIZE];
+    int32_t decodedTimes[SI7210_LOG_MAX_RECORD_SAMPLES];
+    int32_t decodedFields[SI7210_LOG_MAX_RECORD_SAMPLES];
+
+    // Writes up to the first n pending samples as one record.
+    //
+    // @return  The number of samples written. 0 on failure.
+    uint32_t writeRecord(uint32_t n);
+
+    // Moves head to the next slot, dropping the oldest block on wrapping
+    // around into it.
+    void advanceHead();
+
+    // Reads and checks the record in slot, into page.
+    //
+    // @return  True if it is a valid record.
+    bool readRecord(uint32_t slot);
+
+    // @return  True if slot has never been written since it was erased.
+    bool slotErased(uint32_t slot);
+
+    // @return  The first slot at or after slot (towards head) holding a
+    //          valid record, read into page. head if none.
+    uint32_t nextValid(uint32_t slot);
+
+    // @return  The record slot after slot, wrapping around.
+    uint32_t after(uint32_t slot) { return slot + 1 < numSlots ? slot + 1 : 0; }
+};
+
+#endif //SI7210_LOG_H
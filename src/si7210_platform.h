@@ -0,0 +1,132 @@
+// File: si7210_platform.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Small platform layer so the driver's timing and locking code
+// builds both against MBED (Cortex-M) and on a host machine.
+
+#ifndef SI7210_PLATFORM_H
+#define SI7210_PLATFORM_H
+
+#include <stdint.h>
+
+#ifdef __MBED__
+#include "mbed.h"
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// Enables the free running cycle counter.
+// On Cortex-M3/M4/M7 parts this turns on the DWT (data watchpoint and trace)
+// unit's CYCCNT register. Does nothing on the host or on cores without a DWT.
+static inline void si7210_cycles_init()
+{
+#if defined(__MBED__) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+// @return  The current value of the cycle counter. Wraps around, so only the
+//          (unsigned) difference between two readings is meaningful.
+static inline uint32_t si7210_cycles()
+{
+#if defined(__MBED__) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    return DWT->CYCCNT;
+#elif defined(__MBED__)
+    return us_ticker_read();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// @return  The number of si7210_cycles() ticks per second.
+static inline uint32_t si7210_cycles_hz()
+{
+#if defined(__MBED__) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    return SystemCoreClock;
+#elif defined(__MBED__)
+    return 1000000U;
+#else
+    return 1000000000U;
+#endif
+}
+
+// @return  A free running microsecond timestamp. Wraps around after ~71
+//          minutes.
+static inline uint32_t si7210_micros()
+{
+#ifdef __MBED__
+    return us_ticker_read();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// Waits for at least us microseconds. On MBED whole milliseconds sleep the
+// thread and the rest, shorter than the RTOS tick, is busy waited. Sleeps
+// the thread on the host.
+static inline void si7210_sleep_us(uint32_t us)
+{
+#ifdef __MBED__
+    if (us >= 1000)
+    {
+        thread_sleep_for(us / 1000);
+    }
+    wait_us((int)(us % 1000));
+#else
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+#endif
+}
+
+// A mutex with a condition variable attached (a monitor).
+// rtos::Mutex/rtos::ConditionVariable on MBED, std:: equivalents on the host.
+class si7210_monitor
+{
+public:
+    si7210_monitor()
+#ifdef __MBED__
+        : cond(mutex)
+#endif
+    {
+    }
+
+    void lock() { mutex.lock(); }
+
+    void unlock() { mutex.unlock(); }
+
+    // Atomically unlocks, waits for notifyAll() and relocks.
+    // Must be called with the monitor locked.
+    void wait()
+    {
+#ifdef __MBED__
+        cond.wait();
+#else
+        std::unique_lock<std::mutex> held(mutex, std::adopt_lock);
+        cond.wait(held);
+        held.release();
+#endif
+    }
+
+    void notifyAll() { cond.notify_all(); }
+
+private:
+#ifdef __MBED__
+    rtos::Mutex mutex;
+    rtos::ConditionVariable cond;
+#else
+    std::mutex mutex;
+    std::condition_variable cond;
+#endif
+};
+
+#endif //SI7210_PLATFORM_H
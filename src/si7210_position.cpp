@@ -0,0 +1,192 @@
+// File: si7210_position.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Magnet position estimation from si7210 field readings.
+
+#include "si7210_position.h"
+
+// atan(2^-i) for i = 0..19 as a fraction of a full turn * 2^32
+static const uint32_t atanTable[] = {
+    0x20000000U,
+    0x12E4051EU,
+    0x09FB385BU,
+    0x051111D4U,
+    0x028B0D43U,
+    0x0145D7E1U,
+    0x00A2F61EU,
+    0x00517C55U,
+    0x0028BE53U,
+    0x00145F2FU,
+    0x000A2F98U,
+    0x000517CCU,
+    0x00028BE6U,
+    0x000145F3U,
+    0x0000A2FAU,
+    0x0000517DU,
+    0x000028BEU,
+    0x0000145FU,
+    0x00000A30U,
+    0x00000518U};
+
+#define CORDIC_ITERATIONS (sizeof(atanTable) / sizeof(atanTable[0]))
+
+uint16_t si7210_atan2(int32_t y, int32_t x)
+{
+    if (x == 0 && y == 0)
+    {
+        return 0;
+    }
+
+    // Scale so the larger component is in [2^28, 2^29). That keeps the
+    // precision up for small fields and leaves room for the CORDIC gain
+    // (~1.65) and the vector length (up to sqrt(2) * the larger component).
+    int64_t x64 = x;
+    int64_t y64 = y;
+    int64_t ax = x64 < 0 ? -x64 : x64;
+    int64_t ay = y64 < 0 ? -y64 : y64;
+    int64_t m = ax > ay ? ax : ay;
+
+    while (m >= (1L << 29))
+    {
+        x64 >>= 1;
+        y64 >>= 1;
+        m >>= 1;
+    }
+    while (m < (1L << 28))
+    {
+        x64 <<= 1;
+        y64 <<= 1;
+        m <<= 1;
+    }
+
+    int32_t xs = (int32_t)x64;
+    int32_t ys = (int32_t)y64;
+    uint32_t angle = 0;
+
+    // Rotate by 180 degrees into the right half plane, where CORDIC
+    // converges
+    if (xs < 0)
+    {
+        xs = -xs;
+        ys = -ys;
+        angle = 0x80000000U;
+    }
+
+    // Vectoring mode: rotate (x, y) onto the x axis, adding up the rotations
+    for (unsigned int i = 0; i < CORDIC_ITERATIONS; i++)
+    {
+        int32_t dx = ys >> i;
+        int32_t dy = xs >> i;
+
+        if (ys > 0)
+        {
+            xs += dx;
+            ys -= dy;
+            angle += atanTable[i];
+        }
+        else
+        {
+            xs -= dx;
+            ys += dy;
+            angle -= atanTable[i];
+        }
+    }
+
+    // Round to 16 bits
+    return (uint16_t)((angle + 0x8000U) >> 16);
+}
+
+si7210_linear_lut::si7210_linear_lut(const si7210_lut_point_t *table, size_t n)
+{
+    points = table;
+    numPoints = n;
+    valid = n >= 2 && table[0].fieldUt != table[1].fieldUt;
+    decreasing = valid && table[1].fieldUt < table[0].fieldUt;
+
+    for (size_t i = 1; i < n && valid; i++)
+    {
+        valid = decreasing ? table[i].fieldUt < table[i - 1].fieldUt : table[i].fieldUt > table[i - 1].fieldUt;
+    }
+}
+
+int32_t si7210_linear_lut::lookup(int32_t fieldUt)
+{
+    if (!valid)
+    {
+        return 0;
+    }
+
+    // Work in increasing field order. Flipping the sign of every field in a
+    // decreasing table makes it increasing.
+    int32_t f = decreasing ? -fieldUt : fieldUt;
+    int32_t first = decreasing ? -points[0].fieldUt : points[0].fieldUt;
+    int32_t last = decreasing ? -points[numPoints - 1].fieldUt : points[numPoints - 1].fieldUt;
+
+    if (f <= first)
+    {
+        return points[0].position;
+    }
+    if (f >= last)
+    {
+        return points[numPoints - 1].position;
+    }
+
+    // Binary search for the segment [lo, lo + 1] containing f
+    size_t lo = 0;
+    size_t hi = numPoints - 1;
+    while (hi - lo > 1)
+    {
+        size_t mid = (lo + hi) / 2;
+        int32_t midField = decreasing ? -points[mid].fieldUt : points[mid].fieldUt;
+        if (f < midField)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid;
+        }
+    }
+
+    int32_t f0 = decreasing ? -points[lo].fieldUt : points[lo].fieldUt;
+    int32_t f1 = decreasing ? -points[hi].fieldUt : points[hi].fieldUt;
+    int32_t p0 = points[lo].position;
+    int32_t p1 = points[hi].position;
+
+    return p0 + (int32_t)(((int64_t)(f - f0) * (p1 - p0)) / (f1 - f0));
+}
+
+si7210_angle_sensor::si7210_angle_sensor(si7210 *cosSensor, si7210 *sinSensor)
+{
+    hallCos = cosSensor;
+    hallSin = sinSensor;
+    cosOffset = 0;
+    sinOffset = 0;
+    sinGain = 65536;
+    zero = 0;
+}
+
+void si7210_angle_sensor::setCalibration(int32_t cosOffsetUt, int32_t sinOffsetUt, int32_t sinGainQ16)
+{
+    cosOffset = cosOffsetUt;
+    sinOffset = sinOffsetUt;
+    sinGain = sinGainQ16;
+}
+
+uint16_t si7210_angle_sensor::readAngle()
+{
+    int32_t cosUt = hallCos->getFieldStrength();
+    int32_t sinUt = hallSin->getFieldStrength();
+
+    return toAngle(cosUt, sinUt);
+}
+
+uint16_t si7210_angle_sensor::toAngle(int32_t cosUt, int32_t sinUt)
+{
+    int32_t c = cosUt - cosOffset;
+    int32_t s = (int32_t)(((int64_t)(sinUt - sinOffset) * sinGain) >> 16);
+
+    return (uint16_t)(si7210_atan2(s, c) - zero);
+}
@@ -0,0 +1,119 @@
+// File: si7210_position.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Magnet position estimation from si7210 field readings, following
+// the Silicon Labs app note "Using the Si72xx Hall-effect Magnetic Position
+// Sensors" (in the repo root). Linear position comes from a calibrated lookup
+// table, angle from a fixed point CORDIC atan2 of two orthogonal sensors.
+// Integer only and no heap, so it is safe to run on the MCU sample path.
+
+#ifndef SI7210_POSITION_H
+#define SI7210_POSITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "si7210.h"
+
+// Angles are binary angles: a full turn is 65536, so 1 unit = 360/65536
+// degrees (~0.0055 degrees) and wrap around is free.
+#define SI7210_ANGLE_FULL_TURN 65536L
+
+// @return  The binary angle in millidegrees (0-359999).
+static inline int32_t si7210_angle_to_mdeg(uint16_t angle)
+{
+    return (int32_t)(((int64_t)angle * 360000 + SI7210_ANGLE_FULL_TURN / 2) / SI7210_ANGLE_FULL_TURN);
+}
+
+// Fixed point CORDIC atan2.
+//
+// @param y     Sine component, any scale.
+// @param x     Cosine component, same scale as y.
+// @return      The angle of (x, y) as a binary angle. 0 if x and y are 0.
+uint16_t si7210_atan2(int32_t y, int32_t x);
+
+// One lookup table point.
+typedef struct
+{
+    int32_t fieldUt;
+    int32_t position; // Any unit, e.g. um
+} si7210_lut_point_t;
+
+// Maps field strength to position by linear interpolation between the points
+// of a calibration table. The field must be strictly monotonic (increasing
+// or decreasing) over the table; outside it the position is clamped to the
+// end points.
+class si7210_linear_lut
+{
+public:
+    // @param *table    The calibration points, ordered by position. Not
+    //                  copied, so must outlive the lut.
+    // @param n         The number of points. At least 2.
+    si7210_linear_lut(const si7210_lut_point_t *table, size_t n);
+
+    // @return  True if the table has at least 2 points and its field is
+    //          strictly monotonic.
+    bool isValid() { return valid; }
+
+    // @return  The position for the field strength.
+    int32_t lookup(int32_t fieldUt);
+
+private:
+    const si7210_lut_point_t *points;
+    size_t numPoints;
+    bool valid;
+
+    // True if field decreases along the table
+    bool decreasing;
+};
+
+// Linear position from one sensor and a calibration table.
+class si7210_linear_sensor
+{
+public:
+    si7210_linear_sensor(si7210 *sensor, si7210_linear_lut *lut) : hall(sensor), table(lut) {}
+
+    // Reads the sensor and converts to position.
+    int32_t readPosition() { return table->lookup(hall->getFieldStrength()); }
+
+private:
+    si7210 *hall;
+    si7210_linear_lut *table;
+};
+
+// Angle of a magnet from two sensors at 90 degrees to each other (one
+// seeing the cosine and one the sine of the angle).
+class si7210_angle_sensor
+{
+public:
+    // @param *cosSensor    The sensor that sees the field at 0 degrees.
+    // @param *sinSensor    The sensor that sees the field at 90 degrees.
+    si7210_angle_sensor(si7210 *cosSensor, si7210 *sinSensor);
+
+    // Sets the calibration: each sensor's offset (its reading midway
+    // between its peaks) and the sine sensor's gain relative to the cosine
+    // sensor (cosine amplitude / sine amplitude) in Q16 (65536 = 1.0).
+    void setCalibration(int32_t cosOffsetUt, int32_t sinOffsetUt, int32_t sinGainQ16);
+
+    // Sets the angle reported when the magnet is at 0 degrees.
+    void setZero(uint16_t angle) { zero = angle; }
+
+    // Reads both sensors and converts to an angle.
+    //
+    // @return  The angle as a binary angle.
+    uint16_t readAngle();
+
+    // Converts a pair of readings to an angle.
+    uint16_t toAngle(int32_t cosUt, int32_t sinUt);
+
+private:
+    si7210 *hallCos;
+    si7210 *hallSin;
+    int32_t cosOffset;
+    int32_t sinOffset;
+    int32_t sinGain;
+    uint16_t zero;
+};
+
+#endif //SI7210_POSITION_H
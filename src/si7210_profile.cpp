@@ -0,0 +1,139 @@
+// File: si7210_profile.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Optional cycle accurate profiling of the si7210 driver.
+
+#include "si7210_profile.h"
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+
+typedef struct
+{
+    uint8_t site;
+    uint32_t cycles;
+} si7210_trace_entry_t;
+
+// The trace buffer. Used as a ring: next is the total number of entries
+// ever recorded, so the write position is next % SI7210_PROFILE_BUFFER_SIZE.
+static si7210_trace_entry_t trace[SI7210_PROFILE_BUFFER_SIZE];
+static std::atomic<uint32_t> next(0);
+
+// Scratch space for sorting when computing the p99. Static so that
+// summarise() doesn't need the heap or a large stack frame.
+static uint32_t sorted[SI7210_PROFILE_BUFFER_SIZE];
+
+void si7210_profile::reset()
+{
+    si7210_cycles_init();
+    next = 0;
+}
+
+void si7210_profile::record(si7210_profile_site_t site, uint32_t cycles)
+{
+    uint32_t i = next.fetch_add(1) % SI7210_PROFILE_BUFFER_SIZE;
+    trace[i].site = (uint8_t)site;
+    trace[i].cycles = cycles;
+}
+
+bool si7210_profile::summarise(si7210_profile_site_t site, si7210_profile_summary_t *summary)
+{
+    uint32_t entries = std::min<uint32_t>(next, SI7210_PROFILE_BUFFER_SIZE);
+    uint32_t n = 0;
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        if (trace[i].site == (uint8_t)site)
+        {
+            sorted[n++] = trace[i].cycles;
+            total += trace[i].cycles;
+        }
+    }
+
+    if (n == 0)
+    {
+        return false;
+    }
+
+    std::sort(sorted, sorted + n);
+
+    summary->count = n;
+    summary->min = sorted[0];
+    summary->mean = (uint32_t)(total / n);
+    summary->max = sorted[n - 1];
+    // Nearest rank percentile
+    summary->p99 = sorted[((n * 99) + 99) / 100 - 1];
+
+    return true;
+}
+
+void si7210_profile::dump()
+{
+    // Nanoseconds per 1024 cycles, so the conversion stays in integers.
+    uint64_t nsPer1024 = (1000000000ULL * 1024) / si7210_cycles_hz();
+    si7210_profile_summary_t s;
+
+    printf("%-20s %8s %10s %10s %10s %10s (cycles @ %lu Hz)\n",
+           "site", "count", "min", "mean", "max", "p99", (unsigned long)si7210_cycles_hz());
+
+    for (int i = 0; i < (int)si7210_profile_site_t::COUNT; i++)
+    {
+        if (!summarise((si7210_profile_site_t)i, &s))
+        {
+            continue;
+        }
+
+        printf("%-20s %8lu %10lu %10lu %10lu %10lu (p99 %lu ns)\n",
+               siteName((si7210_profile_site_t)i), (unsigned long)s.count,
+               (unsigned long)s.min, (unsigned long)s.mean, (unsigned long)s.max,
+               (unsigned long)s.p99, (unsigned long)((s.p99 * nsPer1024) >> 10));
+    }
+}
+
+const char *si7210_profile::siteName(si7210_profile_site_t site)
+{
+    switch (site)
+    {
+    case si7210_profile_site_t::READ_REGISTER:
+        return "readRegister";
+    case si7210_profile_site_t::WRITE_REGISTER:
+        return "writeRegister";
+    case si7210_profile_site_t::READ_REGISTERS:
+        return "readRegisters";
+    case si7210_profile_site_t::WRITE_REGISTERS:
+        return "writeRegisters";
+    case si7210_profile_site_t::INIT:
+        return "init";
+    case si7210_profile_site_t::GET_CHIP_ID:
+        return "getChipId";
+    case si7210_profile_site_t::GET_REV_ID:
+        return "getRevId";
+    case si7210_profile_site_t::CHECK_GOOD:
+        return "checkGood";
+    case si7210_profile_site_t::SLEEP:
+        return "sleep";
+    case si7210_profile_site_t::WAKEUP:
+        return "wakeup";
+    case si7210_profile_site_t::GET_FIELD_STRENGTH:
+        return "getFieldStrength";
+    case si7210_profile_site_t::READ_SAMPLE:
+        return "readSample";
+    case si7210_profile_site_t::SET_MODE:
+        return "setMode";
+    case si7210_profile_site_t::SET_RANGE:
+        return "setRange";
+    case si7210_profile_site_t::SET_FILTER:
+        return "setFilter";
+    case si7210_profile_site_t::I2C_MEM_DUMP:
+        return "i2cMemDump";
+    case si7210_profile_site_t::SET_SWITCH:
+        return "setSwitch";
+    case si7210_profile_site_t::GET_SWITCH:
+        return "getSwitch";
+    default:
+        return "?";
+    }
+}
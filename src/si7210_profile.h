@@ -0,0 +1,105 @@
+// File: si7210_profile.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Optional cycle accurate profiling of the si7210 driver.
+//
+// Build with -D SI7210_PROFILE to enable. When enabled every bus primitive
+// and public method of the driver records how many cycles it took into a
+// fixed size trace buffer (no heap). si7210_profile::dump() then prints
+// min/mean/max/p99 per call site. When disabled SI7210_PROFILE_SCOPE()
+// expands to nothing so there is no cost at all.
+
+#ifndef SI7210_PROFILE_H
+#define SI7210_PROFILE_H
+
+#include <stdint.h>
+#include "si7210_platform.h"
+
+// Number of trace entries kept. Oldest entries are overwritten once full.
+#ifndef SI7210_PROFILE_BUFFER_SIZE
+#define SI7210_PROFILE_BUFFER_SIZE 512
+#endif
+
+// The places in the driver that are timed.
+typedef enum class si7210_profile_site_t
+{
+    READ_REGISTER,
+    WRITE_REGISTER,
+    READ_REGISTERS,
+    WRITE_REGISTERS,
+    INIT,
+    GET_CHIP_ID,
+    GET_REV_ID,
+    CHECK_GOOD,
+    SLEEP,
+    WAKEUP,
+    GET_FIELD_STRENGTH,
+    READ_SAMPLE,
+    SET_MODE,
+    SET_RANGE,
+    SET_FILTER,
+    I2C_MEM_DUMP,
+    SET_SWITCH,
+    GET_SWITCH,
+    COUNT // Number of sites, not a site
+} si7210_profile_site_t;
+
+// Summary of all trace entries for one call site. Times are in cycles of
+// si7210_cycles(), see si7210_cycles_hz() to convert.
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t mean;
+    uint32_t max;
+    uint32_t p99;
+} si7210_profile_summary_t;
+
+class si7210_profile
+{
+public:
+    // Enables the cycle counter and clears the trace buffer.
+    static void reset();
+
+    // Adds one entry to the trace buffer.
+    //
+    // @param site      Where the time was spent.
+    // @param cycles    How many cycles were spent there.
+    static void record(si7210_profile_site_t site, uint32_t cycles);
+
+    // Computes the summary for one call site from the trace buffer.
+    //
+    // @param site      The call site to summarise.
+    // @param *summary  Where to store the summary.
+    // @return          True if the site has at least one entry, else false.
+    static bool summarise(si7210_profile_site_t site, si7210_profile_summary_t *summary);
+
+    // Prints a summary table of every call site with entries to stdout.
+    static void dump();
+
+    // @return  Human readable name of a call site.
+    static const char *siteName(si7210_profile_site_t site);
+};
+
+// Times the enclosing scope from construction (entry) to destruction
+// (exit). Use through SI7210_PROFILE_SCOPE().
+class si7210_profile_scope
+{
+public:
+    si7210_profile_scope(si7210_profile_site_t s) : site(s), start(si7210_cycles()) {}
+    ~si7210_profile_scope() { si7210_profile::record(site, si7210_cycles() - start); }
+
+private:
+    si7210_profile_site_t site;
+    uint32_t start;
+};
+
+#ifdef SI7210_PROFILE
+#define SI7210_PROFILE_SCOPE(site) si7210_profile_scope _si7210_profile_scope(site)
+#else
+#define SI7210_PROFILE_SCOPE(site)
+#endif
+
+#endif //SI7210_PROFILE_H
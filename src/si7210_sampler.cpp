@@ -0,0 +1,222 @@
+// File: si7210_sampler.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Periodic acquisition of si7210 samples from a dedicated thread,
+// with jitter and missed deadline statistics.
+
+#include "si7210_sampler.h"
+#include <math.h>
+
+#ifdef __MBED__
+#define TICK_FLAG 0x1U
+#define STOP_FLAG 0x2U
+#endif
+
+si7210_sampler::si7210_sampler(si7210 *sensor, callback_t cb, void *context)
+    : running(false)
+#ifdef __MBED__
+      ,
+      ticks(0)
+#endif
+{
+    hall = sensor;
+    onSample = cb;
+    callbackContext = context;
+    periodUs = 0;
+    startUs = 0;
+#ifdef __MBED__
+    thread = NULL;
+#endif
+    samples = 0;
+    missed = 0;
+    minLateness = 0;
+    maxLateness = 0;
+    sumLateness = 0;
+    sumLatenessSq = 0;
+}
+
+si7210_sampler::~si7210_sampler()
+{
+    stop();
+}
+
+bool si7210_sampler::start(uint32_t rateHz)
+{
+    if (running || rateHz == 0)
+    {
+        return false;
+    }
+
+    statsLock.lock();
+    periodUs = 1000000U / rateHz;
+    samples = 0;
+    missed = 0;
+    minLateness = INT32_MAX;
+    maxLateness = INT32_MIN;
+    sumLateness = 0;
+    sumLatenessSq = 0;
+    statsLock.unlock();
+
+    running = true;
+    startUs = si7210_micros();
+
+#ifdef __MBED__
+    ticks = 0;
+    flags.clear(TICK_FLAG | STOP_FLAG);
+    thread = new rtos::Thread(osPriorityRealtime);
+    thread->start(mbed::callback(this, &si7210_sampler::run));
+    ticker.attach_us(mbed::callback(this, &si7210_sampler::onTick), periodUs);
+#else
+    thread = std::thread(&si7210_sampler::run, this);
+#endif
+
+    return true;
+}
+
+void si7210_sampler::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+
+    running = false;
+
+#ifdef __MBED__
+    ticker.detach();
+    flags.set(STOP_FLAG);
+    thread->join();
+    delete thread;
+    thread = NULL;
+#else
+    thread.join();
+#endif
+}
+
+void si7210_sampler::getStats(si7210_sampler_stats_t *stats)
+{
+    statsLock.lock();
+
+    stats->periodUs = periodUs;
+    stats->samples = samples;
+    stats->missed = missed;
+
+    if (samples > 0)
+    {
+        int64_t mean = sumLateness / samples;
+        int64_t variance = sumLatenessSq / samples - mean * mean;
+
+        stats->minLatenessUs = minLateness;
+        stats->maxLatenessUs = maxLateness;
+        stats->meanLatenessUs = (int32_t)mean;
+        stats->jitterUs = (uint32_t)sqrt((double)(variance > 0 ? variance : 0));
+    }
+    else
+    {
+        stats->minLatenessUs = 0;
+        stats->maxLatenessUs = 0;
+        stats->meanLatenessUs = 0;
+        stats->jitterUs = 0;
+    }
+
+    statsLock.unlock();
+}
+
+#ifdef __MBED__
+// Ticker interrupt. Only counts the period and wakes the thread; the bus
+// can't be used from interrupt context.
+void si7210_sampler::onTick()
+{
+    ticks++;
+    flags.set(TICK_FLAG);
+}
+
+void si7210_sampler::run()
+{
+    uint32_t done = 0;
+
+    while (running)
+    {
+        uint32_t got = flags.wait_any(TICK_FLAG | STOP_FLAG);
+        if ((got & STOP_FLAG) || !running)
+        {
+            break;
+        }
+
+        // Sample for the latest period only. Any periods in between elapsed
+        // while the previous sample was still running.
+        uint32_t now = ticks;
+        if (now - done > 1)
+        {
+            statsLock.lock();
+            missed += now - done - 1;
+            statsLock.unlock();
+        }
+        done = now;
+
+        sample(now);
+    }
+}
+#else
+void si7210_sampler::run()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    startUs = si7210_micros();
+    uint32_t period = 1;
+
+    while (running)
+    {
+        std::this_thread::sleep_until(start + std::chrono::microseconds((uint64_t)period * periodUs));
+        if (!running)
+        {
+            break;
+        }
+
+        sample(period);
+
+        // Next period that hasn't started yet. Any periods in between
+        // elapsed while this sample was running.
+        uint64_t elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        uint32_t next = (uint32_t)(elapsedUs / periodUs) + 1;
+        if (next > period + 1)
+        {
+            statsLock.lock();
+            missed += next - period - 1;
+            statsLock.unlock();
+        }
+        period = next;
+    }
+}
+#endif
+
+void si7210_sampler::sample(uint32_t period)
+{
+    si7210_sample_t s;
+    s.fieldUt = hall->getFieldStrength();
+    s.timestampUs = si7210_micros();
+
+    int32_t lateness = (int32_t)(s.timestampUs - (startUs + period * periodUs));
+
+    statsLock.lock();
+    samples++;
+    sumLateness += lateness;
+    sumLatenessSq += (int64_t)lateness * lateness;
+    if (lateness < minLateness)
+    {
+        minLateness = lateness;
+    }
+    if (lateness > maxLateness)
+    {
+        maxLateness = lateness;
+    }
+    statsLock.unlock();
+
+    if (onSample != NULL)
+    {
+        onSample(callbackContext, &s);
+    }
+}
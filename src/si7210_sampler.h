@@ -0,0 +1,133 @@
+// File: si7210_sampler.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Periodic acquisition of si7210 samples from a dedicated thread,
+// with jitter and missed deadline statistics.
+
+#ifndef SI7210_SAMPLER_H
+#define SI7210_SAMPLER_H
+
+#include <atomic>
+#include <stdint.h>
+#include "si7210.h"
+#include "si7210_platform.h"
+
+#ifndef __MBED__
+#include <thread>
+#endif
+
+// One sample.
+typedef struct
+{
+    // si7210_micros() when the sample's bus transactions completed.
+    uint32_t timestampUs;
+
+    // The field strength in uT.
+    int fieldUt;
+} si7210_sample_t;
+
+// Acquisition statistics. Lateness is how long after its scheduled time a
+// sample completed; jitter is the variation in lateness.
+typedef struct
+{
+    uint32_t periodUs;
+
+    // Samples taken.
+    uint32_t samples;
+
+    // Periods skipped because the previous sample was still running.
+    uint32_t missed;
+
+    int32_t minLatenessUs;
+    int32_t maxLatenessUs;
+    int32_t meanLatenessUs;
+
+    // Standard deviation of the lateness.
+    uint32_t jitterUs;
+} si7210_sampler_stats_t;
+
+// Calls si7210::getFieldStrength() at a fixed rate.
+//
+// On MBED a Ticker interrupt releases a high priority thread every period.
+// On the host a std::thread sleeps until each period's absolute deadline.
+// Either way the schedule is fixed to the start time so it doesn't drift,
+// and if a sample overruns the periods it overlapped are counted as missed
+// and skipped instead of being queued up and run late.
+//
+// Example:
+//      void onSample(void *context, const si7210_sample_t *sample) { ... }
+//
+//      si7210_sampler sampler(&hall, onSample, NULL);
+//      sampler.start(1000); // 1kHz
+class si7210_sampler
+{
+public:
+    // Called from the sampler's thread with each sample.
+    typedef void (*callback_t)(void *context, const si7210_sample_t *sample);
+
+    // @param *sensor   The sensor to sample.
+    // @param cb        Called with each sample. May be NULL.
+    // @param *context  Passed to cb.
+    si7210_sampler(si7210 *sensor, callback_t cb, void *context);
+    ~si7210_sampler();
+
+    // Starts sampling. Resets the statistics.
+    //
+    // @param rateHz    Samples per second.
+    // @return          True on success. False if already running or rateHz
+    //                  is 0.
+    bool start(uint32_t rateHz);
+
+    // Stops sampling and waits for the thread to finish.
+    void stop();
+
+    bool isRunning() { return running; }
+
+    // Copies out the statistics.
+    void getStats(si7210_sampler_stats_t *stats);
+
+private:
+    si7210 *hall;
+    callback_t onSample;
+    void *callbackContext;
+
+    uint32_t periodUs;
+    uint32_t startUs;
+    std::atomic<bool> running;
+
+    // Accumulated statistics
+    si7210_monitor statsLock;
+    uint32_t samples;
+    uint32_t missed;
+    int32_t minLateness;
+    int32_t maxLateness;
+    int64_t sumLateness;
+    int64_t sumLatenessSq;
+
+#ifdef __MBED__
+    rtos::Thread *thread;
+    Ticker ticker;
+    rtos::EventFlags flags;
+
+    // Periods elapsed, counted by the Ticker interrupt
+    std::atomic<uint32_t> ticks;
+
+    void onTick();
+#else
+    std::thread thread;
+#endif
+
+    // The sampling thread
+    void run();
+
+    // Takes one sample for the given period.
+    void sample(uint32_t period);
+
+    // Copying would share the thread.
+    si7210_sampler(const si7210_sampler &);
+    si7210_sampler &operator=(const si7210_sampler &);
+};
+
+#endif //SI7210_SAMPLER_H
@@ -0,0 +1,305 @@
+// File: si7210_sim_bus.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: A simulated I2C bus with simulated Si7210 sensors on it, for
+// running and testing the driver without hardware.
+
+#include "si7210_sim_bus.h"
+#include "si7210.h"
+#include <string.h>
+
+#ifndef __MBED__
+#include <thread>
+#endif
+
+si7210_sim_bus::si7210_sim_bus(uint32_t hz)
+    : active(0), numTransactions(0), numBytes(0), busNs(0), numOverlaps(0)
+{
+    memset(devices, 0, sizeof(devices));
+    busHz = hz;
+    fieldSource = NULL;
+    fieldContext = NULL;
+    wakeConversions = 1;
+    realTime = false;
+}
+
+bool si7210_sim_bus::addDevice(uint8_t addr7, uint8_t revId)
+{
+    if (find(addr7) != NULL)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < SI7210_SIM_MAX_DEVICES; i++)
+    {
+        device_t *d = &devices[i];
+        if (!d->present)
+        {
+            d->present = true;
+            d->addr7 = addr7;
+
+            // Temperature compensation coefficients for each range/magnet
+            // combination live at OTP 0x21-0x44. Give them distinct values
+            // so tests can tell which set was loaded.
+            for (int a = 0x21; a <= 0x44; a++)
+            {
+                d->otp[a] = (uint8_t)(a * 7);
+            }
+
+            powerOnReset(d);
+            d->regs[REG_0XC0] = (uint8_t)(0x10 | (revId & 0x0F));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void si7210_sim_bus::setFieldCode(uint8_t addr7, int code)
+{
+    mutex.lock();
+    device_t *d = find(addr7);
+    if (d != NULL)
+    {
+        d->fieldCode = code;
+    }
+    mutex.unlock();
+}
+
+void si7210_sim_bus::setFieldSource(field_source_t fn, void *context)
+{
+    mutex.lock();
+    fieldSource = fn;
+    fieldContext = context;
+    mutex.unlock();
+}
+
+uint8_t si7210_sim_bus::peek(uint8_t addr7, uint8_t reg)
+{
+    mutex.lock();
+    device_t *d = find(addr7);
+    uint8_t data = d != NULL ? d->regs[reg] : 0;
+    mutex.unlock();
+    return data;
+}
+
+void si7210_sim_bus::poke(uint8_t addr7, uint8_t reg, uint8_t data)
+{
+    mutex.lock();
+    device_t *d = find(addr7);
+    if (d != NULL)
+    {
+        d->regs[reg] = data;
+    }
+    mutex.unlock();
+}
+
+void si7210_sim_bus::setOtp(uint8_t addr7, uint8_t otpAddr, uint8_t data)
+{
+    mutex.lock();
+    device_t *d = find(addr7);
+    if (d != NULL)
+    {
+        d->otp[otpAddr] = data;
+    }
+    mutex.unlock();
+}
+
+bool si7210_sim_bus::isAsleep(uint8_t addr7)
+{
+    mutex.lock();
+    device_t *d = find(addr7);
+    bool asleep = d != NULL && d->asleep;
+    mutex.unlock();
+    return asleep;
+}
+
+void si7210_sim_bus::resetStats()
+{
+    numTransactions = 0;
+    numBytes = 0;
+    busNs = 0;
+    numOverlaps = 0;
+}
+
+bool si7210_sim_bus::transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+{
+    if (active.fetch_add(1) > 0)
+    {
+        numOverlaps++;
+    }
+
+    mutex.lock();
+    bool present = find(addr8 >> 1) != NULL;
+    mutex.unlock();
+
+    // START + address + each byte with its ACK/NACK + STOP, plus the
+    // repeated start and address for a read after a write. Without a sensor
+    // to ACK the address the transaction ends right after it.
+    uint32_t bits = 1 + 9 + 1;
+    if (present)
+    {
+        bits += (uint32_t)(txLen + rxLen) * 9;
+        if (txLen > 0 && rxLen > 0)
+        {
+            bits += 1 + 9;
+        }
+    }
+    uint64_t ns = ((uint64_t)bits * 1000000000ULL) / busHz;
+
+    numTransactions++;
+    numBytes += present ? (uint32_t)(txLen + rxLen) : 0;
+    busNs += ns;
+
+    if (realTime)
+    {
+#ifdef __MBED__
+        wait_us((int)(ns / 1000));
+#else
+        std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+#endif
+    }
+
+    mutex.lock();
+
+    device_t *d = find(addr8 >> 1);
+    bool ok = d != NULL;
+
+    if (ok)
+    {
+        // Any transaction addressed to a sleeping sensor wakes it. It comes
+        // back up with its power on register values.
+        if (d->asleep)
+        {
+            uint8_t id = d->regs[REG_0XC0];
+            powerOnReset(d);
+            d->regs[REG_0XC0] = id;
+            d->staleReads = wakeConversions;
+        }
+
+        // The first byte written is the register address. The rest are
+        // data, written to consecutive registers. A read on its own carries
+        // on from where the last transaction left off.
+        uint8_t reg = txLen > 0 ? tx[0] : d->pointer;
+        for (size_t i = 1; i < txLen; i++)
+        {
+            writeReg(d, reg++, tx[i]);
+        }
+
+        for (size_t i = 0; i < rxLen; i++)
+        {
+            rx[i] = readReg(d, reg++);
+        }
+        d->pointer = reg;
+    }
+
+    mutex.unlock();
+    active--;
+
+    return ok;
+}
+
+si7210_sim_bus::device_t *si7210_sim_bus::find(uint8_t addr7)
+{
+    for (int i = 0; i < SI7210_SIM_MAX_DEVICES; i++)
+    {
+        if (devices[i].present && devices[i].addr7 == addr7)
+        {
+            return &devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+void si7210_sim_bus::powerOnReset(device_t *d)
+{
+    memset(d->regs, 0, sizeof(d->regs));
+
+    // Runs in continuous conversion out of reset, 20mT scale with no
+    // magnet temperature compensation.
+    d->regs[REG_0XC9] = 0x01;
+    d->regs[REG_A0] = d->otp[0x21];
+    d->regs[REG_A1] = d->otp[0x22];
+    d->regs[REG_A2] = d->otp[0x23];
+    d->regs[REG_A3] = d->otp[0x24];
+    d->regs[REG_A4] = d->otp[0x25];
+    d->regs[REG_A5] = d->otp[0x26];
+
+    d->asleep = false;
+    d->staleReads = 0;
+    d->latchedLow = 0;
+    d->pointer = 0;
+}
+
+uint8_t si7210_sim_bus::readReg(device_t *d, uint8_t reg)
+{
+    if (reg == REG_DSPSIGM)
+    {
+        int code = fieldSource != NULL ? fieldSource(fieldContext, d->addr7) : d->fieldCode;
+        if (code < -16384)
+        {
+            code = -16384;
+        }
+        if (code > 16383)
+        {
+            code = 16383;
+        }
+
+        uint16_t dspsig = (uint16_t)(code + 16384);
+        bool running = (d->regs[REG_0XC4] & 0x03) == 0;
+        bool fresh = running && d->staleReads == 0;
+        if (d->staleReads > 0)
+        {
+            d->staleReads--;
+        }
+
+        // dspsigl is latched with dspsigm so a following read of it
+        // belongs to the same measurement.
+        d->latchedLow = (uint8_t)(dspsig & 0xFF);
+        return (uint8_t)((fresh ? 0x80 : 0x00) | (dspsig >> 8));
+    }
+
+    if (reg == REG_DSPSIGL)
+    {
+        return d->latchedLow;
+    }
+
+    return d->regs[reg];
+}
+
+void si7210_sim_bus::writeReg(device_t *d, uint8_t reg, uint8_t data)
+{
+    switch (reg)
+    {
+    case REG_0XC0:
+    case REG_DSPSIGM:
+    case REG_DSPSIGL:
+    case REG_OTP_DATA:
+        // Read only
+        return;
+
+    case REG_0XC4:
+        d->regs[reg] = data & 0x7F; // meas is read only
+        if (data & 0x01)
+        {
+            d->asleep = true;
+        }
+        return;
+
+    case REG_OTP_CTRL:
+        // otp_read_en loads otp_data from otp_addr. Never busy.
+        if (data & OTP_READ_EN_MASK)
+        {
+            d->regs[REG_OTP_DATA] = d->otp[d->regs[REG_OTP_ADDR]];
+        }
+        d->regs[reg] = data & ~OTP_BUSY_MASK;
+        return;
+
+    default:
+        d->regs[reg] = data;
+        return;
+    }
+}
@@ -0,0 +1,121 @@
+// File: si7210_sim_bus.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: A simulated I2C bus with simulated Si7210 sensors on it, for
+// running and testing the driver without hardware.
+
+#ifndef SI7210_SIM_BUS_H
+#define SI7210_SIM_BUS_H
+
+#include <atomic>
+#include <stdint.h>
+#include "si7210_bus.h"
+
+// Maximum number of simulated sensors on one bus.
+#define SI7210_SIM_MAX_DEVICES 8
+
+// Models each sensor's I2C register file (with address auto increment on
+// multi byte reads/writes, carried over to a following read without a
+// register address), the OTP read interface, the measurement
+// registers including the "fresh" bit, and sleep/wake up. Also keeps
+// transaction counts and the time the transactions would have taken on a
+// real bus.
+class si7210_sim_bus : public si7210_bus
+{
+public:
+    // Returns the field code (-16384 to 16383, i.e. the signed value of
+    // dspsigm[6:0]:dspsigl[7:0]) a sensor should report. Called on every
+    // read of DSPSIGM.
+    typedef int (*field_source_t)(void *context, uint8_t addr7);
+
+    // @param hz    The modelled I2C bus frequency.
+    si7210_sim_bus(uint32_t hz = 400000);
+
+    // Adds a simulated sensor in its power on state.
+    //
+    // @param addr7     The sensor's 7 bit address.
+    // @param revId     The revision ID to report. 0x4 for revision B.
+    // @return          True on success. False if the bus is full or the
+    //                  address is taken.
+    bool addDevice(uint8_t addr7, uint8_t revId = 0x4);
+
+    // Sets a constant field code for a sensor.
+    void setFieldCode(uint8_t addr7, int code);
+
+    // Sets a function called for the field code of every measurement
+    // instead. NULL to go back to the constant field code.
+    void setFieldSource(field_source_t fn, void *context);
+
+    // Reads/writes a register directly, bypassing the bus.
+    uint8_t peek(uint8_t addr7, uint8_t reg);
+    void poke(uint8_t addr7, uint8_t reg, uint8_t data);
+
+    // Sets one byte of a sensor's OTP memory.
+    void setOtp(uint8_t addr7, uint8_t otpAddr, uint8_t data);
+
+    // @return  True if the sensor is in sleep mode.
+    bool isAsleep(uint8_t addr7);
+
+    // Number of DSPSIGM reads after wake up that return a stale (not
+    // fresh) measurement. Defaults to 1.
+    void setWakeConversions(int reads) { wakeConversions = reads; }
+
+    // When true transfer() takes as long as the transaction would on a real
+    // bus.
+    void setRealTime(bool on) { realTime = on; }
+
+    uint32_t transactions() { return numTransactions; }
+    uint32_t bytes() { return numBytes; }
+
+    // Time spent on the bus by all transactions in nsecs.
+    uint64_t busTimeNs() { return busNs; }
+
+    // Number of times a transaction started while another was still on
+    // the bus. Always 0 on a correctly arbitrated bus.
+    uint32_t overlaps() { return numOverlaps; }
+
+    void resetStats();
+
+    bool transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen);
+
+private:
+    typedef struct
+    {
+        bool present;
+        uint8_t addr7;
+        uint8_t regs[256];
+        uint8_t otp[256];
+        bool asleep;
+        int staleReads;
+        int fieldCode;
+        uint8_t latchedLow;
+
+        // Register address auto increment
+        uint8_t pointer;
+    } device_t;
+
+    device_t devices[SI7210_SIM_MAX_DEVICES];
+    uint32_t busHz;
+    field_source_t fieldSource;
+    void *fieldContext;
+    int wakeConversions;
+    bool realTime;
+
+    // Protects the devices' state
+    si7210_monitor mutex;
+
+    std::atomic<int> active;
+    std::atomic<uint32_t> numTransactions;
+    std::atomic<uint32_t> numBytes;
+    std::atomic<uint64_t> busNs;
+    std::atomic<uint32_t> numOverlaps;
+
+    device_t *find(uint8_t addr7);
+    void powerOnReset(device_t *d);
+    uint8_t readReg(device_t *d, uint8_t reg);
+    void writeReg(device_t *d, uint8_t reg, uint8_t data);
+};
+
+#endif //SI7210_SIM_BUS_H
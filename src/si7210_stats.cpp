@@ -0,0 +1,187 @@
+// File: si7210_stats.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Streaming statistics of si7210 readings for noise and precision
+// characterisation.
+
+#include "si7210_stats.h"
+#include <math.h>
+
+si7210_stats::si7210_stats()
+{
+    histLow = -(SI7210_STATS_BINS / 2);
+    histBin = 1;
+    numTaus = 0;
+    reset();
+}
+
+void si7210_stats::reset()
+{
+    count = 0;
+    first = 0;
+    min = 0;
+    max = 0;
+    sum = 0;
+    sumSq = 0;
+
+    for (size_t i = 0; i < SI7210_STATS_BINS; i++)
+    {
+        bins[i] = 0;
+    }
+    underflow = 0;
+    overflow = 0;
+
+    for (size_t i = 0; i < numTaus; i++)
+    {
+        allan[i].filled = 0;
+        allan[i].blockSum = 0;
+        allan[i].lastSum = 0;
+        allan[i].haveLast = false;
+        allan[i].sumDiffSq = 0;
+        allan[i].pairs = 0;
+    }
+}
+
+bool si7210_stats::setHistogram(int32_t lowUt, int32_t binUt)
+{
+    if (binUt <= 0)
+    {
+        return false;
+    }
+
+    histLow = lowUt;
+    histBin = binUt;
+    reset();
+
+    return true;
+}
+
+bool si7210_stats::setTaus(const uint32_t *taus, size_t n)
+{
+    if (n > SI7210_STATS_MAX_TAUS)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (taus[i] == 0)
+        {
+            return false;
+        }
+    }
+
+    numTaus = n;
+    for (size_t i = 0; i < n; i++)
+    {
+        allan[i].tau = taus[i];
+    }
+    reset();
+
+    return true;
+}
+
+void si7210_stats::add(int32_t ut)
+{
+    if (count == 0)
+    {
+        first = ut;
+        min = ut;
+        max = ut;
+    }
+    else if (ut < min)
+    {
+        min = ut;
+    }
+    else if (ut > max)
+    {
+        max = ut;
+    }
+    count++;
+
+    int64_t d = (int64_t)ut - first;
+    sum += d;
+    sumSq += (uint64_t)(d * d);
+
+    // Floor division so readings just below histLow underflow
+    int64_t offset = (int64_t)ut - histLow;
+    if (offset < 0)
+    {
+        underflow++;
+    }
+    else if (offset / histBin >= SI7210_STATS_BINS)
+    {
+        overflow++;
+    }
+    else
+    {
+        bins[offset / histBin]++;
+    }
+
+    for (size_t i = 0; i < numTaus; i++)
+    {
+        allan_t *a = &allan[i];
+
+        a->blockSum += d;
+        if (++a->filled < a->tau)
+        {
+            continue;
+        }
+
+        if (a->haveLast)
+        {
+            int64_t diff = a->blockSum - a->lastSum;
+            a->sumDiffSq += (uint64_t)(diff * diff);
+            a->pairs++;
+        }
+        a->lastSum = a->blockSum;
+        a->haveLast = true;
+        a->blockSum = 0;
+        a->filled = 0;
+    }
+}
+
+void si7210_stats::getSummary(si7210_stats_summary_t *summary) const
+{
+    summary->count = count;
+    summary->minUt = min;
+    summary->maxUt = max;
+    summary->peakToPeakUt = max - min;
+
+    if (count == 0)
+    {
+        summary->meanUt = 0;
+        summary->stddevUt = 0;
+        return;
+    }
+
+    double n = count;
+    double meanOffset = sum / n;
+    summary->meanUt = first + meanOffset;
+
+    if (count < 2)
+    {
+        summary->stddevUt = 0;
+        return;
+    }
+
+    // sum((d - mean)^2) = sum(d^2) - sum(d)^2 / n
+    double m2 = (double)sumSq - (double)sum * meanOffset;
+    summary->stddevUt = m2 > 0 ? sqrt(m2 / (n - 1)) : 0;
+}
+
+bool si7210_stats::getAllanDeviation(size_t i, double *adevUt) const
+{
+    if (i >= numTaus || allan[i].pairs == 0)
+    {
+        return false;
+    }
+
+    // The block sums are tau times the block averages
+    double tau = allan[i].tau;
+    double meanDiffSq = (double)allan[i].sumDiffSq / allan[i].pairs;
+    *adevUt = sqrt(meanDiffSq / 2.0) / tau;
+
+    return true;
+}
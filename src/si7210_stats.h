@@ -0,0 +1,140 @@
+// File: si7210_stats.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Streaming statistics of si7210 readings for noise and precision
+// characterisation: mean, standard deviation, min/max, peak to peak, a
+// histogram and Allan deviation. Fixed size, no heap, constant time per
+// sample, so it can be fed from the sample path at full rate.
+
+#ifndef SI7210_STATS_H
+#define SI7210_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of histogram bins (not counting the underflow/overflow counts).
+#define SI7210_STATS_BINS 32
+
+// Maximum number of Allan deviation averaging times.
+#define SI7210_STATS_MAX_TAUS 8
+
+typedef struct
+{
+    uint32_t count;
+    int32_t minUt;
+    int32_t maxUt;
+    int32_t peakToPeakUt;
+    double meanUt;
+
+    // Sample standard deviation (n - 1).
+    double stddevUt;
+} si7210_stats_summary_t;
+
+// Accumulates statistics one reading at a time.
+//
+// Everything is accumulated in integers so the results are exact and
+// identical on the MCU and when replaying the same readings on the host.
+// The mean and variance use sums of the offsets from the first reading, which
+// keeps them as stable as Welford's update without its divisions.
+//
+// Allan deviation is the non-overlapping estimate: for each tau (in samples)
+// the readings are averaged in consecutive blocks of tau and
+// adev^2 = mean((next block average - block average)^2) / 2.
+//
+// Not thread safe. If the readings come from another thread (e.g. a
+// si7210_sampler callback) guard add() and the getters with a lock; the
+// object can be copied to take a snapshot.
+//
+// Example:
+//      const uint32_t taus[] = {1, 10, 100, 1000};
+//      si7210_stats stats;
+//      stats.setHistogram(-80, 5);
+//      stats.setTaus(taus, 4);
+//      ...
+//      stats.add(hall.getFieldStrength());
+class si7210_stats
+{
+public:
+    si7210_stats();
+
+    // Clears everything accumulated. Keeps the histogram and taus.
+    void reset();
+
+    // Sets the histogram bins: bin i counts readings from lowUt + i * binUt
+    // up to (not including) lowUt + (i + 1) * binUt. Resets.
+    //
+    // @return  True on success. False if binUt <= 0.
+    bool setHistogram(int32_t lowUt, int32_t binUt);
+
+    // Sets the Allan deviation averaging times. Resets.
+    //
+    // @param *taus The averaging times in samples.
+    // @param n     Number of taus. At most SI7210_STATS_MAX_TAUS.
+    // @return      True on success. False if n is too big or a tau is 0.
+    bool setTaus(const uint32_t *taus, size_t n);
+
+    // Adds one reading.
+    void add(int32_t ut);
+
+    void getSummary(si7210_stats_summary_t *summary) const;
+
+    uint32_t getCount() const { return count; }
+
+    // @return  The number of readings in histogram bin i.
+    uint32_t getBin(size_t i) const { return i < SI7210_STATS_BINS ? bins[i] : 0; }
+
+    // @return  The number of readings below/above the histogram.
+    uint32_t getUnderflow() const { return underflow; }
+    uint32_t getOverflow() const { return overflow; }
+
+    int32_t getBinLowUt(size_t i) const { return histLow + (int32_t)i * histBin; }
+
+    size_t getNumTaus() const { return numTaus; }
+    uint32_t getTau(size_t i) const { return i < numTaus ? allan[i].tau : 0; }
+
+    // @param i         The tau index.
+    // @param *adevUt   Where to store the Allan deviation.
+    // @return          True on success. False if i is out of range or
+    //                  fewer than 2 blocks of tau readings have been added.
+    bool getAllanDeviation(size_t i, double *adevUt) const;
+
+private:
+    typedef struct
+    {
+        uint32_t tau;
+
+        // Readings in, and sum of, the block being averaged
+        uint32_t filled;
+        int64_t blockSum;
+
+        // Sum of the last completed block
+        int64_t lastSum;
+        bool haveLast;
+
+        // Sum of (difference of consecutive block sums)^2, and how many
+        uint64_t sumDiffSq;
+        uint32_t pairs;
+    } allan_t;
+
+    uint32_t count;
+    int32_t first;
+    int32_t min;
+    int32_t max;
+
+    // Sums of (reading - first) and (reading - first)^2
+    int64_t sum;
+    uint64_t sumSq;
+
+    int32_t histLow;
+    int32_t histBin;
+    uint32_t bins[SI7210_STATS_BINS];
+    uint32_t underflow;
+    uint32_t overflow;
+
+    size_t numTaus;
+    allan_t allan[SI7210_STATS_MAX_TAUS];
+};
+
+#endif //SI7210_STATS_H
@@ -0,0 +1,200 @@
+// File: si7210_stream.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Continuous readout of si7210 measurements into a pair of sample
+// blocks (double buffering), handing each completed block to the
+// application.
+
+#include "si7210_stream.h"
+#include <string.h>
+
+si7210_stream::si7210_stream(si7210 *sensor) : running(false)
+{
+    hall = sensor;
+    skipStale = true;
+    filling = 0;
+    pending = false;
+    sequence = 0;
+    memset(&stats, 0, sizeof(stats));
+#ifdef __MBED__
+    thread = NULL;
+#endif
+}
+
+si7210_stream::~si7210_stream()
+{
+    stop();
+}
+
+bool si7210_stream::start(bool freshOnly)
+{
+    if (running)
+    {
+        return false;
+    }
+
+    monitor.lock();
+    skipStale = freshOnly;
+    filling = 0;
+    pending = false;
+    sequence = 0;
+    memset(&stats, 0, sizeof(stats));
+    monitor.unlock();
+
+    running = true;
+
+#ifdef __MBED__
+    thread = new rtos::Thread(osPriorityAboveNormal);
+    thread->start(mbed::callback(this, &si7210_stream::run));
+#else
+    thread = std::thread(&si7210_stream::run, this);
+#endif
+
+    return true;
+}
+
+void si7210_stream::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+
+    monitor.lock();
+    running = false;
+    monitor.notifyAll();
+    monitor.unlock();
+
+#ifdef __MBED__
+    thread->join();
+    delete thread;
+    thread = NULL;
+#else
+    thread.join();
+#endif
+}
+
+const si7210_block_t *si7210_stream::waitBlock()
+{
+    monitor.lock();
+    while (!pending && running)
+    {
+        monitor.wait();
+    }
+    const si7210_block_t *block = pending ? &blocks[filling ^ 1] : NULL;
+    monitor.unlock();
+
+    return block;
+}
+
+void si7210_stream::releaseBlock()
+{
+    monitor.lock();
+    pending = false;
+    monitor.unlock();
+}
+
+void si7210_stream::getStats(si7210_stream_stats_t *s)
+{
+    monitor.lock();
+    *s = stats;
+    monitor.unlock();
+}
+
+void si7210_stream::run()
+{
+    // Only this thread touches the block being filled, so samples are
+    // stored without the lock. It's only taken to hand over a block and to
+    // publish the statistics, at most once per SI7210_STREAM_BLOCK_SIZE
+    // reads or after a failed read.
+    si7210_block_t *block = &blocks[filling];
+    int n = 0;
+    uint32_t samples = 0;
+    uint32_t stale = 0;
+    uint32_t errors = 0;
+    uint32_t backoffUs = SI7210_STREAM_BACKOFF_MIN_US;
+
+    while (running)
+    {
+        int fieldUt;
+        bool fresh;
+        bool failed = !hall->readSample(&fieldUt, &fresh);
+
+        samples++;
+        if (failed)
+        {
+            errors++;
+        }
+        else if (skipStale && !fresh)
+        {
+            backoffUs = SI7210_STREAM_BACKOFF_MIN_US;
+            stale++;
+        }
+        else
+        {
+            backoffUs = SI7210_STREAM_BACKOFF_MIN_US;
+            uint32_t now = si7210_micros();
+            if (n == 0)
+            {
+                block->firstUs = now;
+            }
+            block->lastUs = now;
+            block->fieldUt[n++] = fieldUt;
+        }
+
+        bool complete = n == SI7210_STREAM_BLOCK_SIZE;
+        if (!complete && !failed && samples < SI7210_STREAM_BLOCK_SIZE)
+        {
+            continue;
+        }
+
+        monitor.lock();
+        if (complete)
+        {
+            // Hand the block over and switch to the other one, unless the
+            // application still has the other one, in which case this one
+            // is dropped and refilled.
+            block->sequence = sequence++;
+            if (pending)
+            {
+                stats.overruns++;
+            }
+            else
+            {
+                pending = true;
+                filling ^= 1;
+                stats.blocks++;
+                monitor.notifyAll();
+            }
+        }
+        stats.samples += samples;
+        stats.stale += stale;
+        stats.errors += errors;
+        monitor.unlock();
+
+        if (complete)
+        {
+            block = &blocks[filling];
+            n = 0;
+        }
+        samples = 0;
+        stale = 0;
+        errors = 0;
+
+        // A missing or stuck sensor fails straight away, so retrying at
+        // once would spin the thread. Wait, longer each time it fails again.
+        if (failed)
+        {
+            si7210_sleep_us(backoffUs);
+            backoffUs = backoffUs * 2 < SI7210_STREAM_BACKOFF_MAX_US ? backoffUs * 2 : SI7210_STREAM_BACKOFF_MAX_US;
+        }
+    }
+
+    monitor.lock();
+    stats.samples += samples;
+    stats.stale += stale;
+    stats.errors += errors;
+    monitor.unlock();
+}
@@ -0,0 +1,148 @@
+// File: si7210_stream.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Continuous readout of si7210 measurements into a pair of sample
+// blocks (double buffering), handing each completed block to the
+// application.
+
+#ifndef SI7210_STREAM_H
+#define SI7210_STREAM_H
+
+#include <atomic>
+#include <stdint.h>
+#include "si7210.h"
+#include "si7210_platform.h"
+
+#ifndef __MBED__
+#include <thread>
+#endif
+
+// Samples per block.
+#define SI7210_STREAM_BLOCK_SIZE 32
+
+// Wait after a failed read in usecs. Doubles with each failure in a row, up
+// to the max, and goes back to the min after a successful read.
+#define SI7210_STREAM_BACKOFF_MIN_US 100
+#define SI7210_STREAM_BACKOFF_MAX_US 10000
+
+// A block of consecutive samples.
+typedef struct
+{
+    // Counts up from 0 for each block completed since start(). A gap means
+    // blocks were dropped (see si7210_stream_stats_t::overruns).
+    uint32_t sequence;
+
+    // si7210_micros() when the first and last samples were read.
+    uint32_t firstUs;
+    uint32_t lastUs;
+
+    // The field strengths in uT, calibrated if the sensor has a calibration.
+    int32_t fieldUt[SI7210_STREAM_BLOCK_SIZE];
+} si7210_block_t;
+
+typedef struct
+{
+    // Blocks handed to the application.
+    uint32_t blocks;
+
+    // Samples read, including stale and dropped ones.
+    uint32_t samples;
+
+    // Readings skipped because they weren't a new measurement.
+    uint32_t stale;
+
+    // Failed transfers. The stream backs off after each one, see
+    // SI7210_STREAM_BACKOFF_MIN_US.
+    uint32_t errors;
+
+    // Blocks dropped because the application still held the other one.
+    uint32_t overruns;
+} si7210_stream_stats_t;
+
+// Reads the sensor back to back from a dedicated thread, one transaction
+// per sample (si7210::readSample()), filling one block while the
+// application processes the other.
+//
+// On MBED, construct the sensor on a si7210_mbed_bus with async transfers so
+// the thread sleeps while each transfer runs in the background, leaving the
+// CPU to other threads. On the host the same code runs over the simulated
+// bus (with real time enabled for realistic timing).
+//
+// Example:
+//      si7210_stream stream(&hall);
+//      stream.start();
+//      while (const si7210_block_t *block = stream.waitBlock())
+//      {
+//          ... use block->fieldUt ...
+//          stream.releaseBlock();
+//      }
+class si7210_stream
+{
+public:
+    // @param *sensor   The sensor to read. Should not be used by anything
+    //                  else while streaming.
+    si7210_stream(si7210 *sensor);
+    ~si7210_stream();
+
+    // Starts reading. Resets the statistics.
+    //
+    // @param freshOnly If true, readings that aren't a new measurement since
+    //                  the last read are skipped instead of stored.
+    // @return          True on success. False if already running.
+    bool start(bool freshOnly = true);
+
+    // Stops reading and waits for the thread to finish. Wakes up
+    // waitBlock().
+    void stop();
+
+    bool isRunning() { return running; }
+
+    // Waits for the next completed block.
+    //
+    // @return  The block. It stays valid, and the stream fills the other
+    //          block, until releaseBlock(). NULL once stopped.
+    const si7210_block_t *waitBlock();
+
+    // Gives the block from waitBlock() back to the stream.
+    void releaseBlock();
+
+    // Copies out the statistics.
+    void getStats(si7210_stream_stats_t *stats);
+
+private:
+    si7210 *hall;
+    bool skipStale;
+    std::atomic<bool> running;
+
+    si7210_block_t blocks[2];
+
+    // Guards everything below. Notified when a block completes or the
+    // stream stops.
+    si7210_monitor monitor;
+
+    // The block being filled
+    int filling;
+
+    // Set when blocks[filling ^ 1] is complete and not yet released
+    bool pending;
+
+    uint32_t sequence;
+    si7210_stream_stats_t stats;
+
+#ifdef __MBED__
+    rtos::Thread *thread;
+#else
+    std::thread thread;
+#endif
+
+    // The reading thread
+    void run();
+
+    // Copying would share the thread.
+    si7210_stream(const si7210_stream &);
+    si7210_stream &operator=(const si7210_stream &);
+};
+
+#endif //SI7210_STREAM_H
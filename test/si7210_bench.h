@@ -0,0 +1,39 @@
+// File: si7210_bench.h
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Timing helpers shared by the host benchmarks.
+
+#ifndef SI7210_BENCH_H
+#define SI7210_BENCH_H
+
+#include <chrono>
+#include <stdint.h>
+
+typedef std::chrono::steady_clock::time_point si7210_bench_time_t;
+
+// @return  The time now, to pass to si7210_bench_seconds().
+static inline si7210_bench_time_t si7210_bench_now()
+{
+    return std::chrono::steady_clock::now();
+}
+
+// @return  Seconds since start.
+static inline double si7210_bench_seconds(si7210_bench_time_t start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Where si7210_bench_keep() stores results.
+static volatile int64_t si7210_bench_sink;
+
+// Stores a benchmark's results where the optimiser can't see them, so the
+// loop computing them isn't thrown away. Add the results up in a plain local
+// and pass the total once the timing is done.
+static inline void si7210_bench_keep(int64_t total)
+{
+    si7210_bench_sink = total;
+}
+
+#endif //SI7210_BENCH_H
@@ -0,0 +1,390 @@
+// File: test_async.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the coroutine API and event loop, and a benchmark
+// of samples/sec against the number of sensors for a thread per sensor
+// against coroutines on one thread.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include "si7210_async.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include "si7210_sim_bus.h"
+
+#define HALL 0x30U
+
+// Sensors sample at this rate each in the benchmark
+#define RATE_HZ 1000
+#define BENCH_MS 300
+
+static Filter firFilter()
+{
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 4;
+    return filter;
+}
+
+static si7210_task<int> twice(si7210_event_loop *loop, int x)
+{
+    co_await loop->yield();
+    co_return 2 * x;
+}
+
+static si7210_task<void> waiter(si7210_event_loop *loop, uint32_t delayUs, int id, std::vector<int> *order)
+{
+    co_await loop->sleepFor(delayUs);
+    order->push_back(id);
+    int y = co_await twice(loop, id);
+    order->push_back(y);
+}
+
+// Simulated time: sleeping jumps straight to the deadline
+static uint64_t fakeNow(void *context)
+{
+    return *(uint64_t *)context;
+}
+
+static void fakeSleepUntil(void *context, uint64_t us)
+{
+    uint64_t *now = (uint64_t *)context;
+    *now = us > *now ? us : *now;
+}
+
+void test_loop_runs_in_deadline_order(void)
+{
+    uint64_t fakeUs = 1000000;
+    si7210_loop_clock_t clock = {fakeNow, fakeSleepUntil, &fakeUs};
+    si7210_event_loop loop(&clock);
+    std::vector<int> order;
+
+    uint64_t start = loop.nowUs();
+    loop.spawn(waiter(&loop, 3000, 3, &order));
+    loop.spawn(waiter(&loop, 1000, 1, &order));
+    loop.spawn(waiter(&loop, 2000, 2, &order));
+    TEST_ASSERT_EQUAL(3, loop.tasks());
+    loop.run();
+    uint64_t elapsed = loop.nowUs() - start;
+
+    TEST_ASSERT_EQUAL(0, loop.tasks());
+    TEST_ASSERT_EQUAL(6, order.size());
+    int expected[6] = {1, 2, 2, 4, 3, 6};
+    for (int i = 0; i < 6; i++)
+    {
+        TEST_ASSERT_EQUAL(expected[i], order[i]);
+    }
+    TEST_ASSERT_EQUAL(3000, elapsed);
+}
+
+static si7210_task<void> counter(si7210_event_loop *loop, int id, std::vector<int> *order)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        order->push_back(id);
+        co_await loop->yield();
+    }
+}
+
+static si7210_task<void> forever(si7210_event_loop *loop, int *ticks)
+{
+    for (;;)
+    {
+        (*ticks)++;
+        if (*ticks % 5 == 0)
+        {
+            loop->stop();
+        }
+        co_await loop->sleepFor(100);
+    }
+}
+
+void test_yield_and_stop(void)
+{
+    // yield() lets the others run
+    {
+        si7210_event_loop loop;
+        std::vector<int> order;
+        loop.spawn(counter(&loop, 1, &order));
+        loop.spawn(counter(&loop, 2, &order));
+        loop.run();
+        int expected[6] = {1, 2, 1, 2, 1, 2};
+        TEST_ASSERT_EQUAL(6, order.size());
+        for (int i = 0; i < 6; i++)
+        {
+            TEST_ASSERT_EQUAL(expected[i], order[i]);
+        }
+    }
+
+    // An unfinished task is destroyed with the loop
+    int ticks = 0;
+    {
+        si7210_event_loop loop;
+        loop.spawn(forever(&loop, &ticks));
+        loop.run();
+        TEST_ASSERT_EQUAL(5, ticks);
+        TEST_ASSERT_EQUAL(1, loop.tasks());
+
+        // And run() carries on where it stopped
+        loop.spawn(forever(&loop, &ticks));
+        loop.run();
+        TEST_ASSERT_EQUAL(10, ticks);
+    }
+}
+
+static si7210_task<void> readAfterWake(si7210_async *sensor, si7210_async_reading_t *out, bool *slept, bool *woke)
+{
+    *slept = co_await sensor->sleep();
+    *woke = co_await sensor->wakeup();
+    *out = co_await sensor->readField();
+}
+
+static si7210_task<void> readStale(si7210_async *sensor, si7210_async_reading_t *out)
+{
+    *out = co_await sensor->readField();
+}
+
+static si7210_task<void> countTicks(si7210_event_loop *loop, int *ticks, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        (*ticks)++;
+        co_await loop->sleepFor(10);
+    }
+}
+
+// Sleeps the sensor then wakes it, with wakeup() or setPowerState()
+static si7210_task<void> sleepThenWake(si7210_async *sensor, bool viaPowerState, int *ticks, int *ticksAtWake,
+                                       bool *woke)
+{
+    co_await sensor->sleep();
+    if (viaPowerState)
+    {
+        *woke = co_await sensor->setPowerState(si7210_power_t::ACTIVE);
+    }
+    else
+    {
+        *woke = co_await sensor->wakeup();
+    }
+    *ticksAtWake = *ticks;
+}
+
+void test_sensor_operations(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldCode(HALL, 1000);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, firFilter());
+    int expectedUt = hall.getFieldStrength();
+
+    si7210_event_loop loop;
+    si7210_async sensor(&hall, &loop);
+
+    si7210_async_reading_t reading;
+    bool slept = false;
+    bool woke = false;
+    loop.spawn(readAfterWake(&sensor, &reading, &slept, &woke));
+    loop.run();
+    TEST_ASSERT_TRUE(slept);
+    TEST_ASSERT_TRUE(woke);
+    TEST_ASSERT_TRUE(reading.ok);
+    TEST_ASSERT_EQUAL(expectedUt, reading.fieldUt);
+
+    // Woken behind the driver's back, the sensor has stale measurements for
+    // a while. Other coroutines run while readField() waits them out.
+    sim.setWakeConversions(5);
+    TEST_ASSERT_TRUE(hall.sleep());
+    uint8_t reg = REG_0XC0;
+    sim.transfer(HALL << 1, &reg, 1, NULL, 0);
+    sim.resetStats();
+
+    int ticks = 0;
+    loop.spawn(readStale(&sensor, &reading));
+    loop.spawn(countTicks(&loop, &ticks, 1000));
+    loop.run();
+    TEST_ASSERT_TRUE(reading.ok);
+    TEST_ASSERT_EQUAL(6, sim.transactions());
+    TEST_ASSERT_EQUAL(1000, ticks);
+
+    // wakeup() (and leaving sleep through setPowerState()) restores the
+    // configuration, then waits for the first fresh sample the same way.
+    // First bring the driver back in step with the sensor woken above.
+    TEST_ASSERT_TRUE(hall.wakeup());
+    for (int viaPowerState = 0; viaPowerState <= 1; viaPowerState++)
+    {
+        sim.setWakeConversions(5);
+        ticks = 0;
+        int ticksAtWake = 0;
+        woke = false;
+        loop.spawn(sleepThenWake(&sensor, viaPowerState != 0, &ticks, &ticksAtWake, &woke));
+        loop.spawn(countTicks(&loop, &ticks, 1000));
+        loop.run();
+        TEST_ASSERT_TRUE(woke);
+        TEST_ASSERT_TRUE(ticksAtWake > 0);
+        TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::ACTIVE);
+        TEST_ASSERT_EQUAL(0, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+        TEST_ASSERT_EQUAL(expectedUt, hall.getFieldStrength());
+    }
+
+    // A missing sensor fails
+    si7210 missing(&sim, 0x33, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, firFilter());
+    si7210_async gone(&missing, &loop);
+    loop.spawn(readStale(&gone, &reading));
+    loop.run();
+    TEST_ASSERT_FALSE(reading.ok);
+}
+
+// Samples a sensor every period until the end of the run, skipping periods
+// it missed
+static si7210_task<void> sampleCoro(si7210_event_loop *loop, si7210_async *sensor, uint64_t startUs, uint64_t endUs,
+                                    uint32_t *samples)
+{
+    uint64_t next = startUs;
+    while (next < endUs)
+    {
+        co_await loop->sleepUntil(next);
+        si7210_async_reading_t r = co_await sensor->readField();
+        if (r.ok)
+        {
+            (*samples)++;
+        }
+
+        next += 1000000 / RATE_HZ;
+        uint64_t now = loop->nowUs();
+        while (next < now)
+        {
+            next += 1000000 / RATE_HZ;
+        }
+    }
+}
+
+static void sampleThread(si7210 *hall, std::chrono::steady_clock::time_point start,
+                         std::chrono::steady_clock::time_point end, std::atomic<uint32_t> *samples)
+{
+    std::chrono::steady_clock::time_point next = start;
+    std::chrono::microseconds period(1000000 / RATE_HZ);
+    while (next < end)
+    {
+        std::this_thread::sleep_until(next);
+        int fieldUt;
+        bool fresh;
+        if (hall->readSample(&fieldUt, &fresh) && fresh)
+        {
+            (*samples)++;
+        }
+
+        next += period;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        while (next < now)
+        {
+            next += period;
+        }
+    }
+}
+
+void test_scaling(void)
+{
+    const int counts[] = {1, 16, 64, 256, 512};
+    const int numCounts = sizeof(counts) / sizeof(counts[0]);
+    const int maxSensors = 512;
+
+    // 8 sensors per bus
+    std::vector<si7210_sim_bus *> buses;
+    std::vector<si7210 *> sensors;
+    for (int i = 0; i < maxSensors; i++)
+    {
+        if (i % SI7210_SIM_MAX_DEVICES == 0)
+        {
+            buses.push_back(new si7210_sim_bus());
+        }
+        si7210_sim_bus *sim = buses.back();
+        uint8_t addr7 = 0x30 + i % SI7210_SIM_MAX_DEVICES;
+        sim->addDevice(addr7);
+        sensors.push_back(new si7210(sim, addr7, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, firFilter()));
+    }
+
+    // Only reported: the rates depend on the host's scheduling
+    TEST_MESSAGE("sensors | demand/s | threads/s | coroutines/s");
+    for (int c = 0; c < numCounts; c++)
+    {
+        int n = counts[c];
+
+        std::atomic<uint32_t> threadSamples(0);
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+            std::chrono::steady_clock::time_point end = start + std::chrono::milliseconds(BENCH_MS);
+            std::vector<std::thread> threads;
+            for (int i = 0; i < n; i++)
+            {
+                threads.push_back(std::thread(sampleThread, sensors[i], start, end, &threadSamples));
+            }
+            for (int i = 0; i < n; i++)
+            {
+                threads[i].join();
+            }
+        }
+
+        uint32_t coroSamples = 0;
+        {
+            si7210_event_loop loop;
+            std::vector<si7210_async *> async;
+            uint64_t start = loop.nowUs() + 20000;
+            uint64_t end = start + BENCH_MS * 1000;
+            for (int i = 0; i < n; i++)
+            {
+                async.push_back(new si7210_async(sensors[i], &loop));
+                loop.spawn(sampleCoro(&loop, async[i], start, end, &coroSamples));
+            }
+            loop.run();
+            for (int i = 0; i < n; i++)
+            {
+                delete async[i];
+            }
+        }
+
+        double threadRate = threadSamples * 1000.0 / BENCH_MS;
+        double coroRate = coroSamples * 1000.0 / BENCH_MS;
+
+        char msg[120];
+        snprintf(msg, sizeof(msg), "%7d | %8d | %9.0f | %12.0f", n, n * RATE_HZ, threadRate, coroRate);
+        TEST_MESSAGE(msg);
+    }
+
+    for (int i = 0; i < maxSensors; i++)
+    {
+        delete sensors[i];
+    }
+    for (size_t i = 0; i < buses.size(); i++)
+    {
+        delete buses[i];
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_loop_runs_in_deadline_order);
+    RUN_TEST(test_yield_and_stop);
+    RUN_TEST(test_sensor_operations);
+    RUN_TEST(test_scaling);
+    return UNITY_END();
+}
+
+#else
+
+// Needs -std=gnu++20
+int main()
+{
+    UNITY_BEGIN();
+    return UNITY_END();
+}
+
+#endif
@@ -0,0 +1,149 @@
+// File: test_boot.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the fast boot path (saved config images).
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include "si7210.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x31U
+
+static Filter firFilter()
+{
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 12;
+    return filter;
+}
+
+// Saves the image of a fully configured sensor.
+static void makeImage(si7210_config_image_t *image)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+    TEST_ASSERT_TRUE(hall.saveConfig(image));
+}
+
+static void report(const char *what, si7210_sim_bus *sim)
+{
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%-36s %3lu transactions %6lu us bus time @400kHz", what,
+             (unsigned long)sim->transactions(), (unsigned long)(sim->busTimeNs() / 1000));
+    TEST_MESSAGE(msg);
+}
+
+void test_image_is_checked(void)
+{
+    si7210_config_image_t image;
+    makeImage(&image);
+    TEST_ASSERT_TRUE(si7210::checkConfig(&image));
+
+    image.regs[5] ^= 0x01;
+    TEST_ASSERT_FALSE(si7210::checkConfig(&image));
+}
+
+void test_cold_boot_writes_only_the_delta(void)
+{
+    si7210_config_image_t image;
+    makeImage(&image);
+
+    // Reference: full init() on a sensor straight out of power on reset
+    si7210_sim_bus reference;
+    reference.addDevice(HALL);
+    reference.setFieldCode(HALL, 80);
+    si7210 full(&reference, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+    TEST_ASSERT_EQUAL(100, full.getFieldStrength());
+    report("cold boot, init() to first sample:", &reference);
+
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldCode(HALL, 80);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter(), &image);
+    TEST_ASSERT_EQUAL(100, hall.getFieldStrength());
+    report("cold boot, image to first sample:", &sim);
+
+    // 1 burst read + 1 burst write (0xC8-0xD0) + 2 sample reads, and the
+    // sensor ends up configured the same as with init()
+    TEST_ASSERT_EQUAL(4, sim.transactions());
+    for (unsigned int reg = REG_0XC4; reg <= REG_A5; reg++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(reference.peek(HALL, reg), sim.peek(HALL, reg));
+    }
+}
+
+void test_warm_boot_writes_nothing(void)
+{
+    si7210_config_image_t image;
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldCode(HALL, 80);
+
+    {
+        si7210 first(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+        TEST_ASSERT_TRUE(first.saveConfig(&image));
+    }
+
+    // MCU reset, sensor still configured
+    sim.resetStats();
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter(), &image);
+    TEST_ASSERT_EQUAL(100, hall.getFieldStrength());
+    report("warm boot, image to first sample:", &sim);
+
+    TEST_ASSERT_EQUAL(3, sim.transactions());
+    TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::ACTIVE);
+}
+
+void test_mismatched_image_falls_back_to_init(void)
+{
+    si7210_config_image_t image;
+    makeImage(&image);
+
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_200mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter(), &image);
+
+    // 200mT neodymium coefficients come from OTP 0x33
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)(0x33 * 7), sim.peek(HALL, REG_A0));
+    TEST_ASSERT_FALSE(hall.init(NULL));
+}
+
+void test_woken_sensor_after_fast_boot_is_restored(void)
+{
+    si7210_config_image_t image;
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+
+    {
+        si7210 first(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+        TEST_ASSERT_TRUE(first.saveConfig(&image));
+    }
+
+    // Warm boot wrote nothing but must still know what to restore on wake
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter(), &image);
+    TEST_ASSERT_TRUE(hall.sleep());
+    TEST_ASSERT_TRUE(hall.wakeup());
+
+    for (unsigned int reg = REG_0XC6; reg <= REG_A5; reg++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(image.regs[reg - CONFIG_IMAGE_FIRST], sim.peek(HALL, reg));
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_image_is_checked);
+    RUN_TEST(test_cold_boot_writes_only_the_delta);
+    RUN_TEST(test_warm_boot_writes_nothing);
+    RUN_TEST(test_mismatched_image_falls_back_to_init);
+    RUN_TEST(test_woken_sensor_after_fast_boot_is_restored);
+
+    return UNITY_END();
+}
@@ -0,0 +1,307 @@
+// File: test_bus.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the shared bus manager using the simulated bus.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "si7210.h"
+#include "si7210_bus.h"
+#include "si7210_sim_bus.h"
+
+#define HALL_A 0x30U
+#define HALL_B 0x31U
+
+void test_driver_over_sim_bus(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL_A);
+    sim.setFieldCode(HALL_A, 1000);
+
+    Filter filter;
+    si7210 hall(&sim, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    TEST_ASSERT_EQUAL(0x1, hall.getChipId());
+    TEST_ASSERT_TRUE(hall.checkGood());
+    TEST_ASSERT_EQUAL(1250, hall.getFieldStrength()); // 1000 * 1.25uT
+}
+
+// Each thread reads OTP bytes through otp_addr/otp_ctrl/otp_data, which
+// only gives the right answer if nobody else touches the OTP interface
+// between the three transactions.
+static void otpHammer(si7210_bus *bus, si7210_priority_t p, uint8_t addr7, uint8_t otpAddr, int iterations, std::atomic<int> *errors)
+{
+    uint8_t addr8 = addr7 << 1;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        si7210_bus_lock lock(bus, p);
+
+        uint8_t setAddr[2] = {REG_OTP_ADDR, otpAddr};
+        uint8_t readEn[2] = {REG_OTP_CTRL, OTP_READ_EN_MASK};
+        uint8_t reg = REG_OTP_DATA;
+        uint8_t data = 0;
+
+        bus->transfer(addr8, setAddr, 2, NULL, 0);
+        bus->transfer(addr8, readEn, 2, NULL, 0);
+        bus->transfer(addr8, &reg, 1, &data, 1);
+
+        if (data != (uint8_t)(otpAddr * 7))
+        {
+            (*errors)++;
+        }
+    }
+}
+
+void test_threads_hammering_shared_bus(void)
+{
+    si7210_sim_bus sim(1000000);
+    sim.addDevice(HALL_A);
+    sim.setRealTime(true);
+
+    si7210_bus_manager manager(&sim);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> threads;
+    std::vector<si7210_bus_client *> clients;
+
+    for (int t = 0; t < 6; t++)
+    {
+        si7210_priority_t p = (si7210_priority_t)(t % SI7210_NUM_PRIORITIES);
+        clients.push_back(new si7210_bus_client(&manager, p));
+        threads.push_back(std::thread(otpHammer, clients.back(), p, HALL_A, 0x21 + t, 100, &errors));
+    }
+
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        threads[t].join();
+        delete clients[t];
+    }
+
+    TEST_ASSERT_EQUAL(0, errors.load());
+    TEST_ASSERT_EQUAL(0, sim.overlaps());
+    TEST_ASSERT_EQUAL(6 * 100 * 3, sim.transactions());
+
+    si7210_bus_stats_t stats;
+    manager.getStats(&stats);
+    TEST_ASSERT_EQUAL(200, stats.acquisitions[(int)si7210_priority_t::SAMPLE]);
+    TEST_ASSERT_GREATER_THAN(0, manager.utilisationPermille());
+    TEST_ASSERT_LESS_OR_EQUAL(1000, manager.utilisationPermille());
+}
+
+static void sampleLoop(si7210 *hall, int expected, int iterations, std::atomic<int> *errors)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        if (hall->getFieldStrength() != expected)
+        {
+            (*errors)++;
+        }
+    }
+}
+
+static void dumpLoop(si7210 *hall, int iterations)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        hall->i2cMemDump();
+    }
+}
+
+void test_two_drivers_one_bus(void)
+{
+    si7210_sim_bus sim(1000000);
+    sim.addDevice(HALL_A);
+    sim.addDevice(HALL_B);
+    sim.setFieldCode(HALL_A, 100);
+    sim.setFieldCode(HALL_B, -200);
+
+    si7210_bus_manager manager(&sim);
+    si7210_bus_client busA(&manager);
+    si7210_bus_client busB(&manager);
+    si7210_bus_client busDump(&manager);
+
+    Filter filter;
+    si7210 hallA(&busA, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 hallB(&busB, HALL_B, si7210_range_t::RANGE_200mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 hallDump(&busDump, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    sim.setRealTime(true);
+    std::atomic<int> errors(0);
+    std::thread a(sampleLoop, &hallA, 125, 200, &errors);
+    std::thread b(sampleLoop, &hallB, -2500, 200, &errors);
+    std::thread c(dumpLoop, &hallDump, 10);
+    a.join();
+    b.join();
+    c.join();
+
+    TEST_ASSERT_EQUAL(0, errors.load());
+    TEST_ASSERT_EQUAL(0, sim.overlaps());
+}
+
+static void acquireAndRecord(si7210_bus_manager *manager, si7210_priority_t p, std::atomic<int> *order, int *position)
+{
+    manager->acquire(p);
+    *position = (*order)++;
+    manager->release();
+}
+
+void test_sample_priority_preempts_diagnostic(void)
+{
+    si7210_sim_bus sim;
+    si7210_bus_manager manager(&sim);
+    std::atomic<int> order(0);
+    int diagnosticPos = -1;
+    int samplePos = -1;
+
+    // Hold the bus while a diagnostic then a sample user queue up
+    manager.acquire(si7210_priority_t::CONFIG);
+    std::thread diagnostic(acquireAndRecord, &manager, si7210_priority_t::DIAGNOSTIC, &order, &diagnosticPos);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::thread sample(acquireAndRecord, &manager, si7210_priority_t::SAMPLE, &order, &samplePos);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    manager.release();
+
+    diagnostic.join();
+    sample.join();
+
+    TEST_ASSERT_EQUAL(0, samplePos);
+    TEST_ASSERT_EQUAL(1, diagnosticPos);
+}
+
+typedef struct
+{
+    si7210 *sampler;
+    std::thread thread;
+    std::atomic<bool> started;
+    std::atomic<bool> sampled;
+} sample_race_t;
+
+static void sampleOnce(sample_race_t *race)
+{
+    race->sampler->getFieldStrength();
+}
+
+// Called as dspsigm is read. The first time (during the dump) a sample
+// queues up for the bus while the dump's transaction holds it. The second
+// time is the sample's own read.
+static int startSampleDuringDump(void *context, uint8_t)
+{
+    sample_race_t *race = (sample_race_t *)context;
+    if (!race->started.exchange(true))
+    {
+        race->thread = std::thread(sampleOnce, race);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    else
+    {
+        race->sampled = true;
+    }
+    return 100;
+}
+
+void test_sample_gets_in_during_dump(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL_A);
+    si7210_bus_manager manager(&sim);
+    si7210_bus_client sampleBus(&manager, si7210_priority_t::SAMPLE);
+    si7210_bus_client dumpBus(&manager, si7210_priority_t::DIAGNOSTIC);
+
+    Filter filter;
+    si7210 hallSample(&sampleBus, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 hallDump(&dumpBus, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    sample_race_t race;
+    race.sampler = &hallSample;
+    race.started = false;
+    race.sampled = false;
+    sim.setFieldSource(startSampleDuringDump, &race);
+
+    // The dump reads dspsigm second of 21 registers, so the sample is
+    // served before the dump's next read rather than after the whole dump
+    std::vector<si7210_register_t> registers = hallDump.i2cMemDump();
+    bool sampledDuringDump = race.sampled;
+    race.thread.join();
+
+    TEST_ASSERT_EQUAL(21, registers.size());
+    TEST_ASSERT_TRUE(race.started);
+    TEST_ASSERT_TRUE(sampledDuringDump);
+    TEST_ASSERT_EQUAL(0, sim.overlaps());
+}
+
+// Set on the thread sampleDuringWake() starts.
+static thread_local bool onSampleThread = false;
+
+static void sampleOnceFlagged(sample_race_t *race)
+{
+    onSampleThread = true;
+    race->sampler->getFieldStrength();
+}
+
+// Called as dspsigm is read. The first of wakeup()'s polls starts a sample
+// on another thread; sampled is set when that sample reads dspsigm.
+static int sampleDuringWake(void *context, uint8_t)
+{
+    sample_race_t *race = (sample_race_t *)context;
+    if (onSampleThread)
+    {
+        race->sampled = true;
+    }
+    else if (!race->started.exchange(true))
+    {
+        race->thread = std::thread(sampleOnceFlagged, race);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return 100;
+}
+
+void test_sample_gets_in_during_wakeup(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL_A);
+    si7210_bus_manager manager(&sim);
+    si7210_bus_client sampleBus(&manager, si7210_priority_t::SAMPLE);
+    si7210_bus_client configBus(&manager, si7210_priority_t::CONFIG);
+
+    Filter filter;
+    si7210 hallSample(&sampleBus, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 hallWake(&configBus, HALL_A, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    TEST_ASSERT_TRUE(hallWake.sleep());
+
+    sample_race_t race;
+    race.sampler = &hallSample;
+    race.started = false;
+    race.sampled = false;
+    sim.setFieldSource(sampleDuringWake, &race);
+
+    // The sensor's first measurement after waking is stale, so wakeup()
+    // polls dspsigm at least twice. The sample is served between the polls
+    // rather than after wakeup() returns.
+    bool woke = hallWake.wakeup();
+    bool sampledDuringWake = race.sampled;
+    race.thread.join();
+
+    TEST_ASSERT_TRUE(woke);
+    TEST_ASSERT_TRUE(race.started);
+    TEST_ASSERT_TRUE(sampledDuringWake);
+    TEST_ASSERT_EQUAL(0, sim.overlaps());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_driver_over_sim_bus);
+    RUN_TEST(test_threads_hammering_shared_bus);
+    RUN_TEST(test_two_drivers_one_bus);
+    RUN_TEST(test_sample_priority_preempts_diagnostic);
+    RUN_TEST(test_sample_gets_in_during_dump);
+    RUN_TEST(test_sample_gets_in_during_wakeup);
+
+    return UNITY_END();
+}
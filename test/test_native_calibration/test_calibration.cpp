@@ -0,0 +1,263 @@
+// File: test_calibration.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests and benchmarks of the per-sensor calibration against
+// a simulated fixture with offset, gain and linearity errors.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "../si7210_bench.h"
+#include "si7210.h"
+#include "si7210_calibration.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x30U
+
+// The field the fixture applies
+static double appliedUt = 0;
+static int dither = 0;
+
+static int fixture(void *, uint8_t)
+{
+    // 150uT offset, 7% low gain and a cubic non-linearity, plus +-2 codes
+    // of noise, on the 20mT range (1.25uT per code)
+    double t = appliedUt / 10000.0;
+    double reading = 150.0 + 0.93 * appliedUt + 40.0 * t * t * t;
+    dither = (dither + 1) % 5;
+    return (int)lround(reading / 1.25) + dither - 2;
+}
+
+static Filter filter;
+
+// Worst error of hall over -18mT to 18mT
+static double worstError(si7210 *hall)
+{
+    double worst = 0;
+    for (int ut = -18000; ut <= 18000; ut += 500)
+    {
+        appliedUt = ut;
+        int64_t sum = 0;
+        for (int i = 0; i < 5; i++)
+        {
+            sum += hall->getFieldStrength();
+        }
+        double error = fabs(sum / 5.0 - ut);
+        worst = error > worst ? error : worst;
+    }
+    return worst;
+}
+
+void test_offset_gain_calibration(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(fixture, NULL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    double raw = worstError(&hall);
+
+    si7210_calibrator calibrator(&hall);
+    TEST_ASSERT_FALSE(calibrator.captureZero(0));
+    si7210_cal_t cal;
+    TEST_ASSERT_FALSE(calibrator.compute(&cal));
+
+    appliedUt = 0;
+    TEST_ASSERT_TRUE(calibrator.captureZero(50));
+    appliedUt = 10000;
+    TEST_ASSERT_TRUE(calibrator.captureReference(10000, 50));
+    TEST_ASSERT_TRUE(calibrator.compute(&cal));
+    TEST_ASSERT_EQUAL(0, cal.numPoints);
+    TEST_ASSERT_INT_WITHIN(3, 150, cal.offsetUt);
+
+    hall.setCalibration(&cal);
+    double calibrated = worstError(&hall);
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "worst error raw %.0f uT, offset/gain %.0f uT", raw, calibrated);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(raw / 4, calibrated);
+
+    // Calibrating again measures raw readings, not calibrated ones
+    si7210_calibrator again(&hall);
+    appliedUt = 0;
+    again.captureZero(50);
+    appliedUt = 10000;
+    again.captureReference(10000, 50);
+    si7210_cal_t cal2;
+    again.compute(&cal2);
+    TEST_ASSERT_INT_WITHIN(3, cal.offsetUt, cal2.offsetUt);
+    TEST_ASSERT_TRUE(hall.getCalibration() == &cal);
+}
+
+void test_piecewise_linear_calibration(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(fixture, NULL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_calibrator calibrator(&hall);
+    appliedUt = 0;
+    calibrator.captureZero(50);
+    appliedUt = 10000;
+    calibrator.captureReference(10000, 50);
+    si7210_cal_t linear;
+    calibrator.compute(&linear);
+
+    // Out of order on purpose
+    const int points[] = {18000, -18000, 6000, -6000, 0, -12000, 12000};
+    for (int i = 0; i < 7; i++)
+    {
+        appliedUt = points[i];
+        TEST_ASSERT_TRUE(calibrator.capturePoint(points[i], 50));
+    }
+    si7210_cal_t cal;
+    TEST_ASSERT_TRUE(calibrator.compute(&cal));
+    TEST_ASSERT_EQUAL(7, cal.numPoints);
+    for (int i = 1; i < cal.numPoints; i++)
+    {
+        TEST_ASSERT_TRUE(cal.pointIn[i] > cal.pointIn[i - 1]);
+    }
+
+    hall.setCalibration(&linear);
+    double linearError = worstError(&hall);
+    hall.setCalibration(&cal);
+    double pwlError = worstError(&hall);
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "worst error offset/gain %.0f uT, 7 point PWL %.0f uT", linearError, pwlError);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(linearError, pwlError);
+    TEST_ASSERT_LESS_OR_EQUAL(25, pwlError);
+}
+
+void test_piecewise_linear_correction(void)
+{
+    si7210_cal_t cal;
+    si7210_cal_identity(&cal);
+    TEST_ASSERT_EQUAL(-1234, si7210_cal_apply(&cal, -1234));
+
+    cal.numPoints = 3;
+    cal.pointIn[0] = -1000;
+    cal.pointOut[0] = -900;
+    cal.pointIn[1] = 0;
+    cal.pointOut[1] = 0;
+    cal.pointIn[2] = 1000;
+    cal.pointOut[2] = 1200;
+
+    TEST_ASSERT_EQUAL(-450, si7210_cal_apply(&cal, -500));
+    TEST_ASSERT_EQUAL(600, si7210_cal_apply(&cal, 500));
+    TEST_ASSERT_EQUAL(1200, si7210_cal_apply(&cal, 1000));
+
+    // Shifted by the end point correction outside the points
+    TEST_ASSERT_EQUAL(-1900, si7210_cal_apply(&cal, -2000));
+    TEST_ASSERT_EQUAL(2200, si7210_cal_apply(&cal, 2000));
+}
+
+void test_serialise_round_trip(void)
+{
+    si7210_cal_t cal;
+    si7210_cal_identity(&cal);
+    cal.offsetUt = -151;
+    cal.gainQ16 = 70467;
+    cal.numPoints = 2;
+    cal.pointIn[0] = -15000;
+    cal.pointOut[0] = -15042;
+    cal.pointIn[1] = 15000;
+    cal.pointOut[1] = 15042;
+
+    uint8_t buf[SI7210_CAL_MAX_SERIALISED];
+    TEST_ASSERT_EQUAL(0, si7210_cal_serialise(&cal, buf, 10));
+    size_t len = si7210_cal_serialise(&cal, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(1 + 1 + 4 + 4 + 2 * 8 + 1, len);
+
+    si7210_cal_t back;
+    TEST_ASSERT_TRUE(si7210_cal_deserialise(&back, buf, len));
+    TEST_ASSERT_EQUAL(cal.offsetUt, back.offsetUt);
+    TEST_ASSERT_EQUAL(cal.gainQ16, back.gainQ16);
+    TEST_ASSERT_EQUAL(2, back.numPoints);
+    TEST_ASSERT_EQUAL(cal.pointIn[1], back.pointIn[1]);
+    TEST_ASSERT_EQUAL(cal.pointOut[0], back.pointOut[0]);
+
+    // Truncated and corrupt
+    TEST_ASSERT_FALSE(si7210_cal_deserialise(&back, buf, len - 1));
+    buf[3] ^= 0x10;
+    TEST_ASSERT_FALSE(si7210_cal_deserialise(&back, buf, len));
+
+    // Intact, but the points repeat or go backwards
+    cal.pointIn[1] = cal.pointIn[0];
+    len = si7210_cal_serialise(&cal, buf, sizeof(buf));
+    TEST_ASSERT_FALSE(si7210_cal_deserialise(&back, buf, len));
+    cal.pointIn[1] = cal.pointIn[0] - 1;
+    len = si7210_cal_serialise(&cal, buf, sizeof(buf));
+    TEST_ASSERT_FALSE(si7210_cal_deserialise(&back, buf, len));
+    TEST_ASSERT_EQUAL(15000, back.pointIn[1]);
+}
+
+#define BLOCK 4096
+
+static int32_t in[BLOCK];
+static int32_t out[BLOCK];
+
+void test_block_apply_matches_and_benchmark(void)
+{
+    for (int i = 0; i < BLOCK; i++)
+    {
+        in[i] = (i * 7919) % 40000 - 20000;
+    }
+
+    si7210_cal_t cal;
+    si7210_cal_identity(&cal);
+    cal.offsetUt = 151;
+    cal.gainQ16 = 70467;
+
+    si7210_cal_apply_block(&cal, in, out, BLOCK);
+    for (int i = 0; i < BLOCK; i++)
+    {
+        TEST_ASSERT_EQUAL(si7210_cal_apply(&cal, in[i]), out[i]);
+    }
+
+    const int blocks = 2000;
+    int64_t total = 0;
+
+    si7210_bench_time_t start = si7210_bench_now();
+    for (int b = 0; b < blocks; b++)
+    {
+        in[0] = b;
+        si7210_cal_apply_block(&cal, in, out, BLOCK);
+        total += out[b % BLOCK];
+    }
+    double blockSecs = si7210_bench_seconds(start);
+
+    start = si7210_bench_now();
+    for (int b = 0; b < blocks; b++)
+    {
+        in[0] = b;
+        for (int i = 0; i < BLOCK; i++)
+        {
+            total += si7210_cal_apply(&cal, in[i]);
+        }
+    }
+    double scalarSecs = si7210_bench_seconds(start);
+    si7210_bench_keep(total);
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "offset/gain: block %.2f ns/sample, one at a time %.2f ns/sample",
+             blockSecs * 1e9 / ((double)blocks * BLOCK), scalarSecs * 1e9 / ((double)blocks * BLOCK));
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_offset_gain_calibration);
+    RUN_TEST(test_piecewise_linear_calibration);
+    RUN_TEST(test_piecewise_linear_correction);
+    RUN_TEST(test_serialise_round_trip);
+    RUN_TEST(test_block_apply_matches_and_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,266 @@
+// File: test_codec.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host round trip tests of the sample codec, and its compression
+// ratio and throughput on representative captures.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "si7210_codec.h"
+
+#define CAPTURE_SAMPLES 100000
+
+static uint32_t seed = 1;
+
+static uint32_t next()
+{
+    seed = seed * 1664525U + 1013904223U;
+    return seed >> 8;
+}
+
+void test_round_trip_edge_cases(void)
+{
+    const int32_t values[] = {0, INT32_MAX, INT32_MIN, -1, 1, INT32_MIN, INT32_MAX, 63, 64, -64, -65, 8191, 8192};
+    const size_t n = sizeof(values) / sizeof(values[0]);
+    uint8_t buf[SI7210_CODEC_MAX_BYTES(n)];
+
+    size_t len = si7210_encode_block(values, n, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(len > 0);
+    TEST_ASSERT_TRUE(len <= sizeof(buf));
+
+    int32_t back[n];
+    size_t consumed = 0;
+    TEST_ASSERT_EQUAL(n, si7210_decode_block(buf, len, back, n, &consumed));
+    TEST_ASSERT_EQUAL(len, consumed);
+    TEST_ASSERT_EQUAL_MEMORY(values, back, sizeof(values));
+
+    // One value
+    int32_t one = -16384;
+    len = si7210_encode_block(&one, 1, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(1, si7210_decode_block(buf, len, back, 1, NULL));
+    TEST_ASSERT_EQUAL(-16384, back[0]);
+
+    // Two values, and a constant block, which stores no deltas at all
+    const int32_t two[] = {5, 5};
+    len = si7210_encode_block(two, 2, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(2, si7210_decode_block(buf, len, back, 2, NULL));
+    TEST_ASSERT_EQUAL_MEMORY(two, back, sizeof(two));
+    const int32_t moved[] = {5, -7};
+    len = si7210_encode_block(moved, 2, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(2, si7210_decode_block(buf, len, back, 2, NULL));
+    TEST_ASSERT_EQUAL_MEMORY(moved, back, sizeof(moved));
+
+    int32_t still[64];
+    int32_t stillBack[64];
+    uint8_t stillBuf[SI7210_CODEC_MAX_BYTES(64)];
+    for (int i = 0; i < 64; i++)
+    {
+        still[i] = -1200;
+    }
+    len = si7210_encode_block(still, 64, stillBuf, sizeof(stillBuf));
+    TEST_ASSERT_TRUE(len > 0 && len <= 6);
+    consumed = 0;
+    TEST_ASSERT_EQUAL(64, si7210_decode_block(stillBuf, len, stillBack, 64, &consumed));
+    TEST_ASSERT_EQUAL(len, consumed);
+    TEST_ASSERT_EQUAL_MEMORY(still, stillBack, sizeof(still));
+
+    // Nothing to encode
+    TEST_ASSERT_EQUAL(0, si7210_encode_block(values, 0, buf, sizeof(buf)));
+}
+
+void test_rejects_bad_input(void)
+{
+    int32_t values[100];
+    for (int i = 0; i < 100; i++)
+    {
+        values[i] = 1000 + (int32_t)(next() % 9) - 4;
+    }
+    uint8_t buf[SI7210_CODEC_MAX_BYTES(100)];
+    size_t len = si7210_encode_block(values, 100, buf, sizeof(buf));
+
+    // Output too small
+    TEST_ASSERT_EQUAL(0, si7210_encode_block(values, 100, buf, len - 1));
+    len = si7210_encode_block(values, 100, buf, sizeof(buf));
+
+    int32_t back[100];
+    for (size_t cut = 0; cut < len; cut++)
+    {
+        TEST_ASSERT_EQUAL(0, si7210_decode_block(buf, cut, back, 100, NULL));
+    }
+
+    // Too many values for the output
+    TEST_ASSERT_EQUAL(0, si7210_decode_block(buf, len, back, 99, NULL));
+
+    // A varint that never ends
+    uint8_t bad[] = {0x02, 0x07, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+    TEST_ASSERT_EQUAL(0, si7210_decode_block(bad, sizeof(bad), back, 100, NULL));
+}
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t used;
+    size_t blocks;
+} stream_t;
+
+static void append(void *context, const uint8_t *block, size_t len)
+{
+    stream_t *s = (stream_t *)context;
+    memcpy(s->buf + s->used, block, len);
+    s->used += len;
+    s->blocks++;
+}
+
+static int32_t capture[CAPTURE_SAMPLES];
+static int32_t decoded[CAPTURE_SAMPLES];
+static uint8_t encoded[SI7210_CODEC_MAX_BYTES(CAPTURE_SAMPLES) * 2];
+
+void test_encoder_keyframes_and_seeking(void)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        capture[i] = (int32_t)(2000 * sin(i / 50.0));
+    }
+
+    stream_t s = {encoded, 0, 0};
+    si7210_encoder encoder(append, &s, 64);
+    for (int i = 0; i < 1000; i++)
+    {
+        encoder.add(capture[i]);
+    }
+    encoder.flush();
+    encoder.flush();
+    TEST_ASSERT_EQUAL(16, s.blocks);
+
+    // Seek to sample 700 by skipping whole blocks
+    size_t offset = 0;
+    uint32_t first = 0;
+    uint32_t count;
+    size_t len;
+    while ((len = si7210_skip_block(encoded + offset, s.used - offset, &count)) > 0 && first + count <= 700)
+    {
+        offset += len;
+        first += count;
+    }
+    TEST_ASSERT_EQUAL(640, first);
+
+    int32_t block[64];
+    TEST_ASSERT_EQUAL(64, si7210_decode_block(encoded + offset, s.used - offset, block, 64, NULL));
+    TEST_ASSERT_EQUAL(capture[700], block[700 - first]);
+
+    // And the whole stream decodes back
+    offset = 0;
+    size_t total = 0;
+    size_t consumed;
+    size_t n;
+    while (offset < s.used && (n = si7210_decode_block(encoded + offset, s.used - offset, decoded + total, 1000 - total, &consumed)) > 0)
+    {
+        offset += consumed;
+        total += n;
+    }
+    TEST_ASSERT_EQUAL(1000, total);
+    TEST_ASSERT_EQUAL(s.used, offset);
+    TEST_ASSERT_EQUAL_MEMORY(capture, decoded, 1000 * sizeof(int32_t));
+}
+
+// Codes as read from dspsigm/dspsigl (0-32767) for three situations.
+static void makeCapture(int kind)
+{
+    seed = 7;
+    for (int i = 0; i < CAPTURE_SAMPLES; i++)
+    {
+        int32_t noise = (int32_t)(next() % 9) - 4;
+        switch (kind)
+        {
+        case 0: // Stationary magnet
+            capture[i] = 16384 + 1600 + noise;
+            break;
+        case 1: // Key presses: 20ms travel every 200ms at 1kHz
+        {
+            int phase = i % 200;
+            double travel = phase < 20 ? phase / 20.0 : phase < 100 ? 1.0 : phase < 120 ? (120 - phase) / 20.0 : 0.0;
+            capture[i] = 16384 + 400 + (int32_t)(travel * 12000) + noise;
+            break;
+        }
+        default: // Rotating magnet, 2 turns/s at 1kHz
+            capture[i] = 16384 + (int32_t)(6400 * sin(i * 4.0 * M_PI / 1000.0)) + noise;
+            break;
+        }
+    }
+}
+
+void test_ratio_and_throughput(void)
+{
+    const char *names[] = {"stationary", "key presses", "rotating"};
+
+    for (int kind = 0; kind < 3; kind++)
+    {
+        makeCapture(kind);
+
+        // What we log today: a decimal line per sample
+        size_t textBytes = 0;
+        char line[48];
+        for (int i = 0; i < CAPTURE_SAMPLES; i++)
+        {
+            textBytes += snprintf(line, sizeof(line), "%d\n", (int)capture[i]);
+        }
+
+        const int passes = 20;
+        stream_t s = {encoded, 0, 0};
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p++)
+        {
+            s.used = 0;
+            si7210_encoder encoder(append, &s, 64);
+            for (int i = 0; i < CAPTURE_SAMPLES; i++)
+            {
+                encoder.add(capture[i]);
+            }
+            encoder.flush();
+        }
+        double encodeSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t total = 0;
+        start = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p++)
+        {
+            size_t offset = 0;
+            size_t consumed;
+            total = 0;
+            while (offset < s.used)
+            {
+                total += si7210_decode_block(encoded + offset, s.used - offset, decoded + total, CAPTURE_SAMPLES - total, &consumed);
+                offset += consumed;
+            }
+        }
+        double decodeSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        TEST_ASSERT_EQUAL(CAPTURE_SAMPLES, total);
+        TEST_ASSERT_EQUAL_MEMORY(capture, decoded, sizeof(capture));
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%-11s: %.2f bytes/sample, %.1fx vs 16 bit, %.1fx vs text; encode %.0f, decode %.0f Msamples/s",
+                 names[kind], (double)s.used / CAPTURE_SAMPLES, 2.0 * CAPTURE_SAMPLES / s.used, (double)textBytes / s.used,
+                 passes * CAPTURE_SAMPLES / encodeSecs / 1e6, passes * CAPTURE_SAMPLES / decodeSecs / 1e6);
+        TEST_MESSAGE(msg);
+
+        // Slowly changing captures fit in about a byte a sample
+        TEST_ASSERT_TRUE(s.used < CAPTURE_SAMPLES * 1.5);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_edge_cases);
+    RUN_TEST(test_rejects_bad_input);
+    RUN_TEST(test_encoder_keyframes_and_seeking);
+    RUN_TEST(test_ratio_and_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,251 @@
+// File: test_deadband.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of deadband reporting, and the bandwidth and CPU
+// time it saves replaying a capture of a mostly stationary magnet.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "si7210_deadband.h"
+
+#define MAX_REPORTS 64
+
+typedef struct
+{
+    int count;
+    si7210_report_t reports[MAX_REPORTS];
+} recorder_t;
+
+static void record(void *context, const si7210_report_t *report)
+{
+    recorder_t *r = (recorder_t *)context;
+    if (r->count < MAX_REPORTS)
+    {
+        r->reports[r->count] = *report;
+    }
+    r->count++;
+}
+
+void test_reports_only_changes(void)
+{
+    recorder_t r = {};
+    si7210_deadband deadband(10, 0, false, record, &r);
+
+    const int32_t fields[] = {100, 105, 95, 110, 111, 89, 89, 120};
+    const bool expected[] = {true, false, false, false, true, true, false, true};
+    for (int i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_EQUAL(expected[i], deadband.add(i * 1000, fields[i]));
+    }
+
+    TEST_ASSERT_EQUAL(4, r.count);
+    TEST_ASSERT_EQUAL(100, r.reports[0].fieldUt);
+    TEST_ASSERT_EQUAL(111, r.reports[1].fieldUt);
+    TEST_ASSERT_EQUAL(4000, r.reports[1].timestampUs);
+    TEST_ASSERT_EQUAL(89, r.reports[2].fieldUt);
+    TEST_ASSERT_EQUAL(120, r.reports[3].fieldUt);
+    TEST_ASSERT_TRUE(r.reports[3].kind == si7210_report_kind_t::SAMPLE);
+
+    si7210_deadband_stats_t stats;
+    deadband.getStats(&stats);
+    TEST_ASSERT_EQUAL(8, stats.samples);
+    TEST_ASSERT_EQUAL(4, stats.reported);
+
+    // The first sample after reset() is always reported
+    deadband.reset();
+    TEST_ASSERT_TRUE(deadband.add(9000, 120));
+}
+
+void test_heartbeat(void)
+{
+    recorder_t r = {};
+    si7210_deadband deadband(10, 5000, false, record, &r);
+
+    for (uint32_t t = 0; t <= 12000; t += 1000)
+    {
+        deadband.add(t, 50);
+    }
+
+    // At 0, then every 5ms
+    TEST_ASSERT_EQUAL(3, r.count);
+    TEST_ASSERT_TRUE(r.reports[1].kind == si7210_report_kind_t::HEARTBEAT);
+    TEST_ASSERT_EQUAL(5000, r.reports[1].timestampUs);
+    TEST_ASSERT_EQUAL(10000, r.reports[2].timestampUs);
+
+    // A change restarts the interval
+    deadband.add(13000, 100);
+    deadband.add(17000, 100);
+    TEST_ASSERT_EQUAL(4, r.count);
+    deadband.add(18000, 100);
+    TEST_ASSERT_EQUAL(5, r.count);
+
+    si7210_deadband_stats_t stats;
+    deadband.getStats(&stats);
+    TEST_ASSERT_EQUAL(3, stats.heartbeats);
+}
+
+void test_summaries(void)
+{
+    recorder_t r = {};
+    si7210_deadband deadband(10, 0, true, record, &r);
+
+    deadband.add(0, 0);
+    deadband.add(1000, 4);
+    deadband.add(2000, -7);
+    deadband.add(3000, 9);
+    deadband.add(4000, 50);
+
+    // SAMPLE 0, SUMMARY of the 3 in between, SAMPLE 50
+    TEST_ASSERT_EQUAL(3, r.count);
+    const si7210_report_t *s = &r.reports[1];
+    TEST_ASSERT_TRUE(s->kind == si7210_report_kind_t::SUMMARY);
+    TEST_ASSERT_EQUAL(1000, s->startUs);
+    TEST_ASSERT_EQUAL(3000, s->timestampUs);
+    TEST_ASSERT_EQUAL(3, s->suppressed);
+    TEST_ASSERT_EQUAL(-7, s->minUt);
+    TEST_ASSERT_EQUAL(9, s->maxUt);
+    TEST_ASSERT_EQUAL(50, r.reports[2].fieldUt);
+
+    // No summary when nothing was suppressed
+    deadband.add(5000, 100);
+    TEST_ASSERT_EQUAL(4, r.count);
+
+    si7210_deadband_stats_t stats;
+    deadband.getStats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.summaries);
+}
+
+// A 60s capture at 1kHz of a magnet that sits still (with +-4uT of noise)
+// and is moved 6 times.
+#define CAPTURE_SAMPLES 60000
+
+static int32_t capture[CAPTURE_SAMPLES];
+static uint32_t seed = 1;
+
+static void makeCapture()
+{
+    int32_t position = 2000;
+    for (int i = 0; i < CAPTURE_SAMPLES; i++)
+    {
+        // 200ms ramps to a new position every 10s
+        int phase = i % 10000;
+        if (phase < 200)
+        {
+            position += (i / 10000) % 2 ? -20 : 20;
+        }
+
+        seed = seed * 1664525U + 1013904223U;
+        capture[i] = position + (int32_t)((seed >> 16) % 9) - 4;
+    }
+}
+
+// Downstream: each report is formatted as a line, like the serial output in
+// main.cpp.
+typedef struct
+{
+    char line[96];
+    uint64_t bytes;
+    uint32_t lines;
+} sink_t;
+
+static void format(void *context, const si7210_report_t *report)
+{
+    sink_t *s = (sink_t *)context;
+    int n;
+    if (report->kind == si7210_report_kind_t::SUMMARY)
+    {
+        n = snprintf(s->line, sizeof(s->line), "Summary (ms): %u-%u\tCount: %u\tMin (uT): %d\tMax (uT): %d\n",
+                     (unsigned)(report->startUs / 1000), (unsigned)(report->timestampUs / 1000),
+                     (unsigned)report->suppressed, (int)report->minUt, (int)report->maxUt);
+    }
+    else
+    {
+        n = snprintf(s->line, sizeof(s->line), "Time (ms): %u\tField Strength (uT): %d\n",
+                     (unsigned)(report->timestampUs / 1000), (int)report->fieldUt);
+    }
+    s->bytes += n;
+    s->lines++;
+}
+
+void test_replay_bandwidth_and_cpu(void)
+{
+    makeCapture();
+    const int passes = 10;
+
+    // Every sample
+    sink_t all = {{0}, 0, 0};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++)
+    {
+        for (int i = 0; i < CAPTURE_SAMPLES; i++)
+        {
+            si7210_report_t r = {si7210_report_kind_t::SAMPLE, (uint32_t)i * 1000U, capture[i], 0, 0, 0, 0};
+            format(&all, &r);
+        }
+    }
+    double allSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 20uT deadband, 1s heartbeat, with summaries
+    sink_t filtered = {{0}, 0, 0};
+    si7210_deadband deadband(20, 1000000, true, format, &filtered);
+    int32_t worstTracking = 0;
+    start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++)
+    {
+        deadband.reset();
+        for (int i = 0; i < CAPTURE_SAMPLES; i++)
+        {
+            deadband.add((uint32_t)i * 1000U, capture[i]);
+        }
+    }
+    double filteredSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The last reported value always tracks the field to within the deadband
+    sink_t check = {{0}, 0, 0};
+    si7210_deadband tracking(20, 1000000, false, format, &check);
+    int32_t reported = 0;
+    for (int i = 0; i < CAPTURE_SAMPLES; i++)
+    {
+        if (tracking.add((uint32_t)i * 1000U, capture[i]))
+        {
+            reported = capture[i];
+        }
+        int32_t error = capture[i] > reported ? capture[i] - reported : reported - capture[i];
+        worstTracking = error > worstTracking ? error : worstTracking;
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(20, worstTracking);
+
+    si7210_deadband_stats_t stats;
+    deadband.getStats(&stats);
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "every sample: %u lines, %.0f bytes/s, %.1f ns/sample",
+             (unsigned)(all.lines / passes), all.bytes / (double)passes / 60.0, allSecs * 1e9 / ((double)passes * CAPTURE_SAMPLES));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "deadband:     %u lines (%u samples, %u heartbeats, %u summaries), %.0f bytes/s, %.1f ns/sample",
+             (unsigned)(filtered.lines / passes), (unsigned)stats.reported, (unsigned)stats.heartbeats, (unsigned)stats.summaries,
+             filtered.bytes / (double)passes / 60.0, filteredSecs * 1e9 / ((double)passes * CAPTURE_SAMPLES));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "bandwidth reduced %.0fx, CPU time reduced %.0fx",
+             (double)all.bytes / filtered.bytes, allSecs / filteredSecs);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_GREATER_THAN(20 * filtered.bytes, all.bytes);
+    TEST_ASSERT_TRUE(filteredSecs < allSecs);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reports_only_changes);
+    RUN_TEST(test_heartbeat);
+    RUN_TEST(test_summaries);
+    RUN_TEST(test_replay_bandwidth_and_cpu);
+    return UNITY_END();
+}
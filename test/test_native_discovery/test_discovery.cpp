@@ -0,0 +1,216 @@
+// File: test_discovery.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of sensor discovery and identity, and its speed
+// against probing each address in turn with the driver's own register
+// access sequence.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include "si7210.h"
+#include "si7210_discovery.h"
+#include "si7210_sim_bus.h"
+
+#define NUM_BUSES 4
+
+static void setIdentity(si7210_sim_bus *sim, uint8_t addr7, uint32_t serial)
+{
+    sim->setOtp(addr7, OTP_PART_BASE, 10);
+    sim->setOtp(addr7, OTP_PART_VARIANT, addr7 - 0x30 + 1);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        sim->setOtp(addr7, OTP_SERIAL + i, (uint8_t)(serial >> (24 - 8 * i)));
+    }
+}
+
+// What boot code had to do without si7210_discover(): checkGood(),
+// getChipId() and getRevId() at each address, then the OTP identity a byte
+// at a time through otp_addr/otp_ctrl/otp_data, one bus after another.
+static size_t serialScan(si7210_bus **buses, size_t numBuses)
+{
+    size_t n = 0;
+    for (size_t b = 0; b < numBuses; b++)
+    {
+        for (uint8_t addr7 = 0x30; addr7 <= 0x33; addr7++)
+        {
+            uint8_t addr8 = addr7 << 1;
+            uint8_t reg = REG_0XC0;
+            uint8_t id;
+            if (!buses[b]->transfer(addr8, &reg, 1, &id, 1))
+            {
+                continue;
+            }
+            buses[b]->transfer(addr8, &reg, 1, &id, 1);
+            buses[b]->transfer(addr8, &reg, 1, &id, 1);
+
+            uint8_t otpAddrs[6] = {OTP_PART_BASE, OTP_PART_VARIANT, OTP_SERIAL, OTP_SERIAL + 1, OTP_SERIAL + 2,
+                                   OTP_SERIAL + 3};
+            for (int i = 0; i < 6; i++)
+            {
+                uint8_t tx[2] = {REG_OTP_ADDR, otpAddrs[i]};
+                buses[b]->transfer(addr8, tx, 2, NULL, 0);
+                tx[0] = REG_OTP_CTRL;
+                tx[1] = OTP_READ_EN_MASK;
+                buses[b]->transfer(addr8, tx, 2, NULL, 0);
+                reg = REG_OTP_DATA;
+                buses[b]->transfer(addr8, &reg, 1, &id, 1);
+                reg = REG_0XC0;
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+void test_finds_sensors_and_identity(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(0x30);
+    sim.addDevice(0x32, 0x5);
+    setIdentity(&sim, 0x30, 0x12345678);
+    setIdentity(&sim, 0x32, 0xCAFEF00D);
+
+    // Something that isn't a Si7210 at 0x31
+    sim.addDevice(0x31);
+    sim.poke(0x31, REG_0XC0, 0x24);
+
+    si7210_device_info_t found[SI7210_DISCOVERY_NUM_ADDRS];
+    sim.resetStats();
+    size_t n = si7210_discover_bus(&sim, 0, found, SI7210_DISCOVERY_NUM_ADDRS);
+    TEST_ASSERT_EQUAL(2, n);
+
+    // A probe per address, then 2 transactions per OTP byte
+    TEST_ASSERT_EQUAL(4 + 2 * 12, sim.transactions());
+
+    TEST_ASSERT_EQUAL_HEX8(0x30, found[0].addr7);
+    TEST_ASSERT_EQUAL(1, found[0].chipId);
+    TEST_ASSERT_EQUAL(4, found[0].revId);
+    TEST_ASSERT_TRUE(found[0].haveIdentity);
+    TEST_ASSERT_EQUAL(10, found[0].partBase);
+    TEST_ASSERT_EQUAL(1, found[0].variant);
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, found[0].serial);
+
+    TEST_ASSERT_EQUAL_HEX8(0x32, found[1].addr7);
+    TEST_ASSERT_EQUAL(5, found[1].revId);
+    TEST_ASSERT_EQUAL(3, found[1].variant);
+    TEST_ASSERT_EQUAL_HEX32(0xCAFEF00D, found[1].serial);
+
+    // Without the identity, one transaction per address
+    sim.resetStats();
+    n = si7210_discover_bus(&sim, 0, found, SI7210_DISCOVERY_NUM_ADDRS, false);
+    TEST_ASSERT_EQUAL(2, n);
+    TEST_ASSERT_FALSE(found[0].haveIdentity);
+    TEST_ASSERT_EQUAL(4, sim.transactions());
+
+    // The table is enough to construct a driver
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 4;
+    si7210 hall(&sim, found[1].addr7, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    TEST_ASSERT_TRUE(hall.checkGood());
+}
+
+void test_id_decoding(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(0x30, 0x5);
+    sim.addDevice(0x31);
+    sim.poke(0x31, REG_0XC0, 0x24);
+
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 4;
+    si7210 hall(&sim, 0x30, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 other(&sim, 0x31, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 missing(&sim, 0x33, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    // Any revision of a Si7210 is good
+    TEST_ASSERT_EQUAL(1, hall.getChipId());
+    TEST_ASSERT_EQUAL(5, hall.getRevId());
+    TEST_ASSERT_TRUE(hall.checkGood());
+
+    // Only bits 0:3 are the revid
+    TEST_ASSERT_EQUAL(2, other.getChipId());
+    TEST_ASSERT_EQUAL(4, other.getRevId());
+    TEST_ASSERT_FALSE(other.checkGood());
+
+    TEST_ASSERT_FALSE(missing.checkGood());
+}
+
+void test_discovery_time(void)
+{
+    // A board with 2 sensors on each of 4 buses
+    si7210_sim_bus sims[NUM_BUSES];
+    si7210_bus *buses[NUM_BUSES];
+    for (int b = 0; b < NUM_BUSES; b++)
+    {
+        sims[b].addDevice(0x30);
+        sims[b].addDevice(0x33);
+        setIdentity(&sims[b], 0x30, 0x1000 + b);
+        setIdentity(&sims[b], 0x33, 0x2000 + b);
+        sims[b].setRealTime(true);
+        buses[b] = &sims[b];
+    }
+
+    uint32_t start = si7210_micros();
+    size_t serialFound = serialScan(buses, NUM_BUSES);
+    uint32_t serialUs = si7210_micros() - start;
+    uint32_t serialTransactions = 0;
+    uint64_t serialBusNs = 0;
+    for (int b = 0; b < NUM_BUSES; b++)
+    {
+        serialTransactions += sims[b].transactions();
+        serialBusNs += sims[b].busTimeNs();
+        sims[b].resetStats();
+    }
+
+    si7210_device_info_t found[NUM_BUSES * SI7210_DISCOVERY_NUM_ADDRS];
+    start = si7210_micros();
+    size_t n = si7210_discover(buses, NUM_BUSES, found, NUM_BUSES * SI7210_DISCOVERY_NUM_ADDRS);
+    uint32_t parallelUs = si7210_micros() - start;
+    uint32_t transactions = 0;
+    uint64_t busiestNs = 0;
+    for (int b = 0; b < NUM_BUSES; b++)
+    {
+        transactions += sims[b].transactions();
+        busiestNs = sims[b].busTimeNs() > busiestNs ? sims[b].busTimeNs() : busiestNs;
+    }
+
+    TEST_ASSERT_EQUAL(NUM_BUSES * 2, serialFound);
+    TEST_ASSERT_EQUAL(NUM_BUSES * 2, n);
+    for (int b = 0; b < NUM_BUSES; b++)
+    {
+        TEST_ASSERT_EQUAL(b, found[2 * b].bus);
+        TEST_ASSERT_EQUAL_HEX8(0x30, found[2 * b].addr7);
+        TEST_ASSERT_EQUAL_HEX32(0x1000 + b, found[2 * b].serial);
+        TEST_ASSERT_EQUAL(b, found[2 * b + 1].bus);
+        TEST_ASSERT_EQUAL_HEX8(0x33, found[2 * b + 1].addr7);
+        TEST_ASSERT_EQUAL_HEX32(0x2000 + b, found[2 * b + 1].serial);
+    }
+
+    TEST_ASSERT_EQUAL(NUM_BUSES * (4 + 2 * 12), transactions);
+    TEST_ASSERT_TRUE(transactions < serialTransactions);
+
+    // The buses are scanned at once, so discovery takes as long as the
+    // busiest one; a serial scan takes the sum of them all. The wall clock
+    // times depend on the host and are only reported.
+    TEST_ASSERT_TRUE(busiestNs * 2 < serialBusNs);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%d buses, %d sensors: serial %lu transactions %lu us, si7210_discover %lu transactions %lu us",
+             NUM_BUSES, NUM_BUSES * 2, (unsigned long)serialTransactions, (unsigned long)serialUs,
+             (unsigned long)transactions, (unsigned long)parallelUs);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_finds_sensors_and_identity);
+    RUN_TEST(test_id_decoding);
+    RUN_TEST(test_discovery_time);
+    return UNITY_END();
+}
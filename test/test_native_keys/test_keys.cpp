@@ -0,0 +1,380 @@
+// File: test_keys.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the key event engine, including key strokes over
+// the simulated bus on its own clock, its per sample cost with many keys,
+// and its sample to event latency over the simulated bus in real time.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "si7210.h"
+#include "si7210_keys.h"
+#include "si7210_platform.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x30U
+#define MAX_EVENTS 64
+
+// Travel maps to field 2.5uT per unit, so 0-2500uT at rest-pressed
+static const si7210_key_config_t config = {0, 2500, 500, 400, 0, 0};
+
+typedef struct
+{
+    si7210_key_event_t events[MAX_EVENTS];
+    uint32_t count;
+    uint32_t lastUs;
+} recorder_t;
+
+static void record(void *context, const si7210_key_event_t *event)
+{
+    recorder_t *r = (recorder_t *)context;
+    if (r->count < MAX_EVENTS)
+    {
+        r->events[r->count] = *event;
+    }
+    r->count++;
+    r->lastUs = si7210_micros();
+}
+
+// Feeds travels (0-1000) to key 0 at 1kHz from *timeUs
+static void feed(si7210_keys *keys, uint32_t *timeUs, const uint16_t *travel, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        keys->add(0, *timeUs, travel[i] * 5 / 2);
+        *timeUs += 1000;
+    }
+}
+
+static bool isPress(const si7210_key_event_t *event)
+{
+    return event->kind == si7210_key_event_kind_t::PRESS;
+}
+
+void test_hysteresis(void)
+{
+    recorder_t r = {};
+    si7210_keys keys(record, &r);
+    TEST_ASSERT_EQUAL(0, keys.addKey(&config));
+
+    // Noise around the actuation point only presses once, and around the
+    // release point only releases once
+    const uint16_t stroke[] = {0, 200, 450, 499, 500, 470, 510, 430, 520, 700, 1000, 700,
+                               450, 401, 400, 420, 390, 450, 410, 200, 0};
+    uint32_t t = 0;
+    feed(&keys, &t, stroke, sizeof(stroke) / sizeof(stroke[0]));
+
+    TEST_ASSERT_EQUAL(2, r.count);
+    TEST_ASSERT_TRUE(isPress(&r.events[0]));
+    TEST_ASSERT_EQUAL(4000, r.events[0].timestampUs);
+    TEST_ASSERT_EQUAL(500, r.events[0].travel);
+    TEST_ASSERT_FALSE(isPress(&r.events[1]));
+    TEST_ASSERT_EQUAL(14000, r.events[1].timestampUs);
+    TEST_ASSERT_FALSE(keys.isPressed(0));
+
+    // Field going the other way (magnet pole reversed)
+    recorder_t rev = {};
+    si7210_keys reversed(record, &rev);
+    si7210_key_config_t c = {-300, -2800, 500, 400, 0, 0};
+    TEST_ASSERT_EQUAL(0, reversed.addKey(&c));
+    reversed.add(0, 0, -1000);
+    TEST_ASSERT_EQUAL(280, reversed.getTravel(0));
+    reversed.add(0, 1000, -1600);
+    TEST_ASSERT_TRUE(reversed.isPressed(0));
+    reversed.add(0, 2000, 0);
+    TEST_ASSERT_EQUAL(0, reversed.getTravel(0));
+    TEST_ASSERT_EQUAL(2, rev.count);
+
+    // Bad configs
+    si7210_key_config_t bad = config;
+    bad.release = bad.actuation;
+    TEST_ASSERT_EQUAL(-1, keys.addKey(&bad));
+    bad = config;
+    bad.pressedUt = bad.restUt;
+    TEST_ASSERT_EQUAL(-1, keys.addKey(&bad));
+    TEST_ASSERT_FALSE(keys.configure(0, &bad));
+    TEST_ASSERT_FALSE(keys.configure(1, &config));
+    TEST_ASSERT_FALSE(keys.add(1, 0, 0));
+}
+
+void test_rapid_trigger(void)
+{
+    recorder_t r = {};
+    si7210_keys keys(record, &r);
+    si7210_key_config_t c = config;
+    c.rapidTrigger = 50;
+    keys.addKey(&c);
+
+    // Press, then repeatedly lift a little and push again without coming
+    // up past the release point
+    const uint16_t stroke[] = {0, 600, 800, 760, 751, 740, 720, 760, 770, 790, 900, 849, 850, 500, 430,
+                               // All the way up: now it takes the actuation point again
+                               380, 440, 499, 520};
+    uint32_t t = 0;
+    feed(&keys, &t, stroke, sizeof(stroke) / sizeof(stroke[0]));
+
+    const bool presses[] = {true, false, true, false, true};
+    const uint32_t times[] = {1000, 5000, 8000, 11000, 18000};
+    TEST_ASSERT_EQUAL(5, r.count);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_EQUAL(presses[i], isPress(&r.events[i]));
+        TEST_ASSERT_EQUAL(times[i], r.events[i].timestampUs);
+    }
+
+    // Without rapid trigger the same stroke is one press and release
+    recorder_t plain = {};
+    si7210_keys normal(record, &plain);
+    normal.addKey(&config);
+    t = 0;
+    feed(&normal, &t, stroke, sizeof(stroke) / sizeof(stroke[0]));
+    TEST_ASSERT_EQUAL(3, plain.count);
+}
+
+void test_debounce(void)
+{
+    recorder_t r = {};
+    si7210_keys keys(record, &r);
+    si7210_key_config_t c = config;
+    c.debounceUs = 5000;
+    keys.addKey(&c);
+
+    // Bouncing across both thresholds every 1ms
+    const uint16_t stroke[] = {0, 600, 300, 600, 300, 600, 600, 300, 300, 300, 300, 300, 300, 600};
+    uint32_t t = 0;
+    feed(&keys, &t, stroke, sizeof(stroke) / sizeof(stroke[0]));
+
+    TEST_ASSERT_EQUAL(3, r.count);
+    TEST_ASSERT_EQUAL(1000, r.events[0].timestampUs);
+    TEST_ASSERT_EQUAL(7000, r.events[1].timestampUs);
+    TEST_ASSERT_EQUAL(13000, r.events[2].timestampUs);
+
+    si7210_keys_stats_t stats;
+    keys.getStats(&stats);
+    TEST_ASSERT_EQUAL(3, stats.presses + stats.releases);
+    TEST_ASSERT_TRUE(stats.debounced > 0);
+}
+
+void test_velocity(void)
+{
+    const uint32_t speeds[] = {20000, 50000, 100000}; // travel/s
+
+    for (uint32_t s = 0; s < 3; s++)
+    {
+        recorder_t r = {};
+        si7210_keys keys(record, &r);
+        keys.addKey(&config);
+
+        // 1kHz samples (with the timestamps wrapping), a linear stroke down
+        // then up
+        uint32_t t = 0xFFFFF000U;
+        for (int32_t i = 0; i < 2000; i++)
+        {
+            int32_t travel = (int32_t)(speeds[s] * i / 1000);
+            travel = travel > 1000 ? 2000 - travel : travel;
+            if (travel < 0)
+            {
+                break;
+            }
+            keys.add(0, t, travel * 5 / 2);
+            t += 1000;
+        }
+
+        TEST_ASSERT_EQUAL(2, r.count);
+        int32_t expected = (int32_t)speeds[s];
+        TEST_ASSERT_TRUE(r.events[0].velocity > expected * 95 / 100 && r.events[0].velocity < expected * 105 / 100);
+        TEST_ASSERT_TRUE(r.events[1].velocity < -expected * 95 / 100 && r.events[1].velocity > -expected * 105 / 100);
+    }
+}
+
+void test_many_keys_cost(void)
+{
+    uint32_t events = 0;
+    si7210_keys keys([](void *context, const si7210_key_event_t *) { (*(uint32_t *)context)++; }, &events);
+
+    si7210_key_config_t c = config;
+    c.rapidTrigger = 30;
+    for (int i = 0; i < SI7210_KEYS_MAX; i++)
+    {
+        TEST_ASSERT_EQUAL(i, keys.addKey(&c));
+    }
+    TEST_ASSERT_EQUAL(-1, keys.addKey(&c));
+
+    // Every key typed on, round robin, as a scanner over several sensors
+    // would feed it
+    const uint32_t rounds = 20000;
+    uint32_t seed = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < rounds; round++)
+    {
+        for (uint16_t k = 0; k < SI7210_KEYS_MAX; k++)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            int32_t phase = (int32_t)((round + k * 37) % 100);
+            int32_t travel = phase < 50 ? phase * 20 : (100 - phase) * 20;
+            keys.add(k, round * 1000, travel * 5 / 2 + (int32_t)((seed >> 8) % 21) - 10);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    si7210_keys_stats_t stats;
+    keys.getStats(&stats);
+    TEST_ASSERT_EQUAL(rounds * SI7210_KEYS_MAX, stats.samples);
+    TEST_ASSERT_EQUAL(events, stats.presses + stats.releases);
+    TEST_ASSERT_TRUE(stats.presses >= SI7210_KEYS_MAX * (rounds / 100) - SI7210_KEYS_MAX);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%d keys: %.1f ns/sample, %lu events", SI7210_KEYS_MAX,
+             ns / stats.samples, (unsigned long)events);
+    TEST_MESSAGE(msg);
+}
+
+// A key stroke every 20ms: down at 200 travel/ms for 5ms, held, then up
+#define STROKE_US 20000U
+static uint32_t strokeStartUs;
+
+static uint16_t strokeTravel(uint32_t nowUs)
+{
+    uint32_t phase = (nowUs - strokeStartUs) % STROKE_US;
+    if (phase < 5000)
+    {
+        return (uint16_t)(phase / 5);
+    }
+    if (phase < 10000)
+    {
+        return 1000;
+    }
+    if (phase < 15000)
+    {
+        return (uint16_t)(1000 - (phase - 10000) / 5);
+    }
+    return 0;
+}
+
+// The time the key's field is read at: the simulated bus's own clock (its
+// total bus time) when context is the bus, else the real one
+static uint32_t strokeNowUs(si7210_sim_bus *sim)
+{
+    return sim != NULL ? (uint32_t)(sim->busTimeNs() / 1000) : si7210_micros();
+}
+
+static int strokeField(void *context, uint8_t)
+{
+    // 20mT range: 1.25uT per code, so travel * 2 codes = travel * 2.5uT
+    return strokeTravel(strokeNowUs((si7210_sim_bus *)context)) * 2;
+}
+
+void test_strokes_on_simulated_clock(void)
+{
+    // No sleeping: time is the bus time used so far, so every run sees the
+    // same samples
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    sim.setFieldSource(strokeField, &sim);
+    sim.resetStats();
+
+    recorder_t r = {};
+    si7210_keys keys(record, &r);
+    keys.addKey(&config);
+
+    // Read back to back for whole strokes
+    strokeStartUs = 0;
+    const uint32_t strokes = 20;
+    uint32_t samples = 0;
+    while (strokeNowUs(&sim) < strokes * STROKE_US)
+    {
+        int field;
+        TEST_ASSERT_TRUE(hall.readSample(&field));
+        keys.add(0, strokeNowUs(&sim), field);
+        samples++;
+    }
+    uint32_t sampleUs = strokes * STROKE_US / samples;
+
+    // One press and one release per stroke, each from the first sample past
+    // its point: actuation (500) 2.5ms into the stroke, release (400) 13ms in
+    TEST_ASSERT_EQUAL(2 * strokes, r.count);
+    for (uint32_t i = 0; i < r.count; i++)
+    {
+        const si7210_key_event_t *e = &r.events[i];
+        uint32_t stroke = i / 2;
+        uint32_t crossedUs = stroke * STROKE_US + (i % 2 == 0 ? 2500 : 13000);
+        TEST_ASSERT_EQUAL(i % 2 == 0, isPress(e));
+        TEST_ASSERT_TRUE(e->timestampUs >= crossedUs);
+        TEST_ASSERT_TRUE(e->timestampUs <= crossedUs + sampleUs + 1);
+        TEST_ASSERT_TRUE(i % 2 == 0 ? e->travel >= config.actuation : e->travel <= config.release);
+        TEST_ASSERT_TRUE(i % 2 == 0 ? e->velocity > 0 : e->velocity < 0);
+    }
+}
+
+void test_latency(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(strokeField, NULL);
+    sim.setRealTime(true);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    recorder_t r = {};
+    si7210_keys keys(record, &r);
+    keys.addKey(&config);
+
+    // Read back to back, as si7210_stream does, and time each press from
+    // when the key really crossed the actuation point (2.5ms into the
+    // stroke) to the event callback. Depends on the host's scheduling, so
+    // it is only reported; test_strokes_on_simulated_clock checks the
+    // events.
+    strokeStartUs = si7210_micros();
+    const uint32_t strokes = 50;
+    uint32_t worstUs = 0;
+    uint64_t totalUs = 0;
+    uint32_t presses = 0;
+    uint32_t samples = 0;
+
+    while (presses < strokes && si7210_micros() - strokeStartUs < 2 * strokes * STROKE_US)
+    {
+        int field;
+        if (!hall.readSample(&field))
+        {
+            continue;
+        }
+        samples++;
+
+        uint32_t before = r.count;
+        keys.add(0, si7210_micros(), field);
+        if (r.count > before && isPress(&r.events[(r.count - 1) % MAX_EVENTS]))
+        {
+            uint32_t stroke = (r.lastUs - strokeStartUs) / STROKE_US;
+            uint32_t latency = r.lastUs - (strokeStartUs + stroke * STROKE_US + 2500);
+            worstUs = latency > worstUs ? latency : worstUs;
+            totalUs += latency;
+            presses++;
+        }
+    }
+    uint32_t elapsedUs = si7210_micros() - strokeStartUs;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "sample to event latency: mean %lu us, worst %lu us over %lu presses (%.0f us/sample)",
+             (unsigned long)(presses > 0 ? totalUs / presses : 0), (unsigned long)worstUs, (unsigned long)presses,
+             samples > 0 ? (double)elapsedUs / samples : 0.0);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_rapid_trigger);
+    RUN_TEST(test_debounce);
+    RUN_TEST(test_velocity);
+    RUN_TEST(test_many_keys_cost);
+    RUN_TEST(test_strokes_on_simulated_clock);
+    RUN_TEST(test_latency);
+    return UNITY_END();
+}
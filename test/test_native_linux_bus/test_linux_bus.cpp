@@ -0,0 +1,296 @@
+// File: test_linux_bus.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the Linux i2c-dev backend against an in-process
+// fake of i2c-dev in front of the simulated bus, and its throughput with
+// I2C_RDWR against separate read()/write() calls.
+// Run with: pio test -e native
+
+#include <unity.h>
+
+#ifdef __linux__
+
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "si7210.h"
+#include "si7210_linux_bus.h"
+#include "si7210_sim_bus.h"
+
+#define FAKE_FD 42
+#define HALL 0x30U
+
+// Emulates /dev/i2c-1 with the simulated bus behind it.
+typedef struct
+{
+    si7210_sim_bus *sim;
+    unsigned long funcs;
+    int slave;
+    uint32_t calls;
+    uint32_t opens;
+    uint32_t closes;
+
+    // Enter the kernel on every call, as the real ones do
+    bool kernelCost;
+} fake_i2c_dev_t;
+
+static void enter(fake_i2c_dev_t *dev)
+{
+    dev->calls++;
+    if (dev->kernelCost)
+    {
+        syscall(SYS_getppid);
+    }
+}
+
+static int fakeOpen(void *context, const char *path, int flags)
+{
+    fake_i2c_dev_t *dev = (fake_i2c_dev_t *)context;
+    enter(dev);
+    if (strcmp(path, "/dev/i2c-1") != 0 || flags != O_RDWR)
+    {
+        return -1;
+    }
+    dev->opens++;
+    return FAKE_FD;
+}
+
+static int fakeClose(void *context, int fd)
+{
+    fake_i2c_dev_t *dev = (fake_i2c_dev_t *)context;
+    enter(dev);
+    dev->closes++;
+    return fd == FAKE_FD ? 0 : -1;
+}
+
+static int fakeIoctl(void *context, int fd, unsigned long request, void *arg)
+{
+    fake_i2c_dev_t *dev = (fake_i2c_dev_t *)context;
+    enter(dev);
+    if (fd != FAKE_FD)
+    {
+        return -1;
+    }
+
+    switch (request)
+    {
+    case I2C_FUNCS:
+        *(unsigned long *)arg = dev->funcs;
+        return 0;
+
+    case I2C_SLAVE:
+        dev->slave = (int)(unsigned long)arg;
+        return 0;
+
+    case I2C_RDWR:
+    {
+        // What the kernel does with the messages the backend sends: a write
+        // then a read of the same device as one transaction, or either alone
+        struct i2c_rdwr_ioctl_data *data = (struct i2c_rdwr_ioctl_data *)arg;
+        struct i2c_msg *m = data->msgs;
+        bool ok;
+        if (data->nmsgs == 2 && !(m[0].flags & I2C_M_RD) && (m[1].flags & I2C_M_RD) && m[0].addr == m[1].addr)
+        {
+            ok = dev->sim->transfer(m[0].addr << 1, m[0].buf, m[0].len, m[1].buf, m[1].len);
+        }
+        else if (data->nmsgs == 1 && (m[0].flags & I2C_M_RD))
+        {
+            ok = dev->sim->transfer(m[0].addr << 1, NULL, 0, m[0].buf, m[0].len);
+        }
+        else if (data->nmsgs == 1)
+        {
+            ok = dev->sim->transfer(m[0].addr << 1, m[0].buf, m[0].len, NULL, 0);
+        }
+        else
+        {
+            return -1;
+        }
+        return ok ? (int)data->nmsgs : -1;
+    }
+
+    default:
+        return -1;
+    }
+}
+
+static ssize_t fakeRead(void *context, int fd, void *buf, size_t len)
+{
+    fake_i2c_dev_t *dev = (fake_i2c_dev_t *)context;
+    enter(dev);
+    if (fd != FAKE_FD || dev->slave < 0 || !dev->sim->transfer(dev->slave << 1, NULL, 0, (uint8_t *)buf, len))
+    {
+        return -1;
+    }
+    return (ssize_t)len;
+}
+
+static ssize_t fakeWrite(void *context, int fd, const void *buf, size_t len)
+{
+    fake_i2c_dev_t *dev = (fake_i2c_dev_t *)context;
+    enter(dev);
+    if (fd != FAKE_FD || dev->slave < 0 || !dev->sim->transfer(dev->slave << 1, (const uint8_t *)buf, len, NULL, 0))
+    {
+        return -1;
+    }
+    return (ssize_t)len;
+}
+
+static void fakeInit(fake_i2c_dev_t *dev, si7210_sim_bus *sim, si7210_linux_syscalls_t *sys)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->sim = sim;
+    dev->funcs = I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL;
+    dev->slave = -1;
+
+    sys->open = fakeOpen;
+    sys->close = fakeClose;
+    sys->ioctl = fakeIoctl;
+    sys->read = fakeRead;
+    sys->write = fakeWrite;
+    sys->context = dev;
+}
+
+static Filter firFilter()
+{
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 4;
+    return filter;
+}
+
+void test_driver_over_linux_bus(void)
+{
+    fake_i2c_dev_t dev;
+    si7210_linux_syscalls_t sys;
+    fakeInit(&dev, NULL, &sys);
+
+    for (int combined = 1; combined >= 0; combined--)
+    {
+        si7210_sim_bus fresh;
+        fresh.addDevice(HALL);
+        fresh.setFieldCode(HALL, 1000);
+        dev.sim = &fresh;
+
+        si7210_linux_bus bus(1, combined != 0, &sys);
+        TEST_ASSERT_TRUE(bus.isOpen());
+        si7210 hall(&bus, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+        TEST_ASSERT_TRUE(hall.checkGood());
+        TEST_ASSERT_EQUAL(4, hall.getRevId());
+
+        // Configured just as over any other bus
+        TEST_ASSERT_EQUAL_HEX8((uint8_t)(0x2D * 7), fresh.peek(HALL, REG_A0));
+        TEST_ASSERT_EQUAL(0, fresh.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+
+        // 2 byte reads of dspsigm/dspsigl
+        uint8_t data[2];
+        TEST_ASSERT_TRUE(hall.readRegisters(REG_DSPSIGM, data, 2));
+        TEST_ASSERT_EQUAL(1000 + 16384, ((data[0] & 0x7F) << 8) | data[1]);
+
+        // NACKs are failures
+        uint8_t reg = REG_0XC0;
+        TEST_ASSERT_FALSE(bus.transfer(0x33 << 1, &reg, 1, data, 1));
+        TEST_ASSERT_TRUE(bus.transfer(HALL << 1, &reg, 1, data, 1));
+    }
+    TEST_ASSERT_EQUAL(dev.opens, dev.closes);
+}
+
+void test_open_failures(void)
+{
+    si7210_sim_bus sim;
+    fake_i2c_dev_t dev;
+    si7210_linux_syscalls_t sys;
+    fakeInit(&dev, &sim, &sys);
+
+    // No such adapter
+    si7210_linux_bus missing(2, true, &sys);
+    TEST_ASSERT_FALSE(missing.isOpen());
+    uint8_t reg = REG_0XC0;
+    uint8_t data;
+    TEST_ASSERT_FALSE(missing.transfer(HALL << 1, &reg, 1, &data, 1));
+
+    // SMBus only, like i2c-stub
+    dev.funcs = I2C_FUNC_SMBUS_EMUL;
+    {
+        si7210_linux_bus smbus(1, true, &sys);
+        TEST_ASSERT_FALSE(smbus.isOpen());
+    }
+    TEST_ASSERT_EQUAL(1, dev.opens);
+    TEST_ASSERT_EQUAL(1, dev.closes);
+
+    // The real system calls on an adapter that can't exist
+    si7210_linux_bus real(9999);
+    TEST_ASSERT_FALSE(real.isOpen());
+}
+
+void test_rdwr_throughput(void)
+{
+    const int reads = 20000;
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    fake_i2c_dev_t dev;
+    si7210_linux_syscalls_t sys;
+    fakeInit(&dev, &sim, &sys);
+    dev.kernelCost = true;
+
+    uint32_t calls[2];
+    uint32_t transactions[2];
+    double busUs[2];
+    double ns[2];
+    for (int combined = 0; combined <= 1; combined++)
+    {
+        si7210_linux_bus bus(1, combined != 0, &sys);
+        sim.resetStats();
+        dev.calls = 0;
+
+        uint8_t reg = REG_DSPSIGM;
+        uint8_t data[2];
+        uint32_t start = si7210_cycles();
+        for (int i = 0; i < reads; i++)
+        {
+            bus.transfer(HALL << 1, &reg, 1, data, 2);
+        }
+        uint32_t cycles = si7210_cycles() - start;
+
+        calls[combined] = dev.calls;
+        transactions[combined] = sim.transactions();
+        busUs[combined] = sim.busTimeNs() / 1000.0 / reads;
+        ns[combined] = cycles * 1e9 / si7210_cycles_hz() / reads;
+    }
+
+    // One ioctl and one transaction per read, against a write() and a read()
+    TEST_ASSERT_EQUAL(reads, calls[1]);
+    TEST_ASSERT_EQUAL(reads, transactions[1]);
+    TEST_ASSERT_EQUAL(2 * reads + 1, calls[0]);
+    TEST_ASSERT_EQUAL(2 * reads, transactions[0]);
+    TEST_ASSERT_TRUE(busUs[1] < busUs[0]);
+
+    char msg[200];
+    snprintf(msg, sizeof(msg), "2 byte reads: read()/write() %.2f calls %.1f us bus %.0f ns/read, I2C_RDWR %.2f calls %.1f us bus %.0f ns/read",
+             (double)calls[0] / reads, busUs[0], ns[0], (double)calls[1] / reads, busUs[1], ns[1]);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_driver_over_linux_bus);
+    RUN_TEST(test_open_failures);
+    RUN_TEST(test_rdwr_throughput);
+    return UNITY_END();
+}
+
+#else
+
+int main()
+{
+    UNITY_BEGIN();
+    return UNITY_END();
+}
+
+#endif
@@ -0,0 +1,424 @@
+// File: test_log.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the flash sample log on the file backed block
+// device: range reads, wrap around and wear, recovery after a power cut, a
+// clock restarting on reset, a constant field, and its sustained write rate
+// and recovery time.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "si7210_file_block_device.h"
+#include "si7210_log.h"
+
+#define LOG_FILE "test_log.bin"
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t first;
+    uint32_t last;
+    uint32_t lastBoot;
+    bool ordered;
+    bool matches;
+} collected_t;
+
+// Field value logged at time t
+static int32_t fieldAt(uint32_t t)
+{
+    return (int32_t)(t % 97) * 3 - 140;
+}
+
+static void collect(void *context, uint32_t boot, uint32_t timestamp, int32_t fieldUt)
+{
+    collected_t *c = (collected_t *)context;
+    if (c->count == 0)
+    {
+        c->first = timestamp;
+    }
+    else if (si7210_log_position(boot, timestamp) < si7210_log_position(c->lastBoot, c->last))
+    {
+        c->ordered = false;
+    }
+    if (fieldUt != fieldAt(timestamp))
+    {
+        c->matches = false;
+    }
+    c->last = timestamp;
+    c->lastBoot = boot;
+    c->count++;
+}
+
+// Reads from..to into *c, checking the samples are in order and correct
+static void readRange(si7210_log *log, uint64_t from, uint64_t to, collected_t *c)
+{
+    *c = {0, 0, 0, 0, true, true};
+    uint32_t n = log->read(from, to, collect, c);
+    TEST_ASSERT_EQUAL(c->count, n);
+    TEST_ASSERT_TRUE(c->ordered);
+    TEST_ASSERT_TRUE(c->matches);
+}
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void test_range_reads(void)
+{
+    remove(LOG_FILE);
+    si7210_file_block_device flash(LOG_FILE, 64 * 1024);
+    TEST_ASSERT_TRUE(flash.isOpen());
+    si7210_log log(&flash);
+    TEST_ASSERT_TRUE(log.mount());
+
+    // 1 kHz, in ms, with a gap
+    for (uint32_t t = 0; t < 5000; t++)
+    {
+        TEST_ASSERT_TRUE(log.append(t < 2000 ? t : t + 1000, fieldAt(t < 2000 ? t : t + 1000)));
+    }
+    TEST_ASSERT_FALSE(log.append(10, 0));
+
+    collected_t c;
+    readRange(&log, 0, UINT32_MAX, &c);
+    TEST_ASSERT_EQUAL(5000, c.count);
+    TEST_ASSERT_EQUAL(0, c.first);
+    TEST_ASSERT_EQUAL(5999, c.last);
+
+    readRange(&log, 1500, 1600, &c);
+    TEST_ASSERT_EQUAL(101, c.count);
+    TEST_ASSERT_EQUAL(1500, c.first);
+
+    readRange(&log, 2100, 2900, &c);
+    TEST_ASSERT_EQUAL(0, c.count);
+
+    readRange(&log, 1990, 3009, &c);
+    TEST_ASSERT_EQUAL(20, c.count);
+
+    // Buffered samples are included
+    readRange(&log, 5990, 6000, &c);
+    TEST_ASSERT_EQUAL(10, c.count);
+
+    si7210_log_stats_t stats;
+    log.getStats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.oldest);
+    TEST_ASSERT_EQUAL(5999, stats.newest);
+    TEST_ASSERT_TRUE(stats.pending < SI7210_LOG_MAX_RECORD_SAMPLES);
+
+    // Everything survives a remount once synced
+    TEST_ASSERT_TRUE(log.sync());
+    si7210_log again(&flash);
+    TEST_ASSERT_TRUE(again.mount());
+    readRange(&again, 0, UINT32_MAX, &c);
+    TEST_ASSERT_EQUAL(5000, c.count);
+
+    // Bad geometry
+    si7210_log tooBig(&flash, 1024);
+    TEST_ASSERT_FALSE(tooBig.mount());
+    si7210_log notDividing(&flash, 96);
+    TEST_ASSERT_FALSE(notDividing.mount());
+}
+
+void test_wrap_around_spreads_wear(void)
+{
+    remove(LOG_FILE);
+    const uint32_t blocks = 8;
+    si7210_file_block_device flash(LOG_FILE, blocks * 4096);
+    si7210_log log(&flash);
+    TEST_ASSERT_TRUE(log.mount());
+
+    // Many laps of the device
+    const uint32_t total = 400000;
+    for (uint32_t t = 0; t < total; t++)
+    {
+        TEST_ASSERT_TRUE(log.append(t, fieldAt(t)));
+    }
+
+    si7210_log_stats_t stats;
+    log.getStats(&stats);
+    TEST_ASSERT_EQUAL(total - 1, stats.newest);
+    TEST_ASSERT_TRUE(stats.oldest > 0);
+
+    // At most one erase block's worth of records is lost on each wrap, so
+    // the log keeps all but the oldest block
+    collected_t c;
+    readRange(&log, 0, UINT32_MAX, &c);
+    TEST_ASSERT_EQUAL(stats.oldest, c.first);
+    TEST_ASSERT_EQUAL(total - stats.oldest, c.count);
+    TEST_ASSERT_TRUE(stats.records >= (blocks - 1) * (4096 / 256));
+
+    uint32_t least = UINT32_MAX;
+    uint32_t most = 0;
+    for (uint32_t i = 0; i < blocks; i++)
+    {
+        least = flash.eraseCount(i) < least ? flash.eraseCount(i) : least;
+        most = flash.eraseCount(i) > most ? flash.eraseCount(i) : most;
+    }
+    TEST_ASSERT_TRUE(most - least <= 1);
+    TEST_ASSERT_EQUAL(flash.totalErases(), stats.erases);
+
+    // Range read from the middle after wrapping
+    readRange(&log, total - 3000, total - 2001, &c);
+    TEST_ASSERT_EQUAL(1000, c.count);
+
+    // Remount finds the same ends
+    TEST_ASSERT_TRUE(log.sync());
+    si7210_log again(&flash);
+    TEST_ASSERT_TRUE(again.mount());
+    si7210_log_stats_t after;
+    again.getStats(&after);
+    TEST_ASSERT_EQUAL(stats.oldest, after.oldest);
+    TEST_ASSERT_EQUAL(total - 1, after.newest);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%lu samples, %lu erases per block, %lu records held",
+             (unsigned long)total, (unsigned long)most, (unsigned long)stats.records);
+    TEST_MESSAGE(msg);
+}
+
+void test_recovers_after_power_cut(void)
+{
+    // Samples logged before the cut, and bytes written after it: tearing a
+    // record part way through a lap, or the erase (then the first record)
+    // at the start of the next lap
+    const uint32_t cuts[][2] = {{7000, 0}, {7000, 8}, {7000, 100}, {7000, 255}, {7000, 300},
+                                {8192, 20}, {8192, 4095}, {8192, 4096 + 20}};
+
+    for (size_t k = 0; k < sizeof(cuts) / sizeof(cuts[0]); k++)
+    {
+        remove(LOG_FILE);
+        si7210_file_block_device flash(LOG_FILE, 4 * 4096);
+        si7210_log log(&flash);
+        TEST_ASSERT_TRUE(log.mount());
+
+        uint32_t t = 0;
+        for (; t < cuts[k][0]; t++)
+        {
+            TEST_ASSERT_TRUE(log.append(t, fieldAt(t)));
+        }
+        TEST_ASSERT_TRUE(log.sync());
+        collected_t before;
+        readRange(&log, 0, UINT32_MAX, &before);
+
+        flash.cutPowerAfter(cuts[k][1]);
+        for (uint32_t i = 0; i < 3 * SI7210_LOG_MAX_RECORD_SAMPLES; i++, t++)
+        {
+            log.append(t, fieldAt(t));
+        }
+        flash.restorePower();
+
+        // A new boot keeps every complete record (less the erase block
+        // being reused) and carries on
+        si7210_log again(&flash);
+        TEST_ASSERT_TRUE(again.mount());
+        collected_t after;
+        readRange(&again, 0, UINT32_MAX, &after);
+        uint32_t reused = cuts[k][0] == 8192 ? 4096 / 256 * SI7210_LOG_MAX_RECORD_SAMPLES : 0;
+        TEST_ASSERT_TRUE(after.count >= before.count - reused);
+        TEST_ASSERT_TRUE(after.last >= before.last);
+
+        for (uint32_t i = 0; i < 1000; i++, t++)
+        {
+            TEST_ASSERT_TRUE(again.append(t, fieldAt(t)));
+        }
+        TEST_ASSERT_TRUE(again.sync());
+        collected_t tail;
+        readRange(&again, si7210_log_position(1, t - 1000), UINT64_MAX, &tail);
+        TEST_ASSERT_EQUAL(1000, tail.count);
+
+        si7210_log third(&flash);
+        TEST_ASSERT_TRUE(third.mount());
+        readRange(&third, si7210_log_position(1, t - 1000), UINT64_MAX, &tail);
+        TEST_ASSERT_EQUAL(1000, tail.count);
+    }
+}
+
+void test_clock_restarts_after_reset(void)
+{
+    remove(LOG_FILE);
+    si7210_file_block_device flash(LOG_FILE, 64 * 1024);
+    si7210_log log(&flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (uint32_t t = 0; t < 1000; t++)
+    {
+        TEST_ASSERT_TRUE(log.append(t, fieldAt(t)));
+    }
+    TEST_ASSERT_TRUE(log.sync());
+
+    // After a reset the ms since boot clock starts from 0 again, in a new
+    // boot. Time still can't go backwards within a boot.
+    si7210_log again(&flash);
+    TEST_ASSERT_TRUE(again.mount());
+    si7210_log_stats_t stats;
+    again.getStats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.boot);
+    TEST_ASSERT_TRUE(stats.newest == si7210_log_position(0, 999));
+    for (uint32_t t = 0; t < 500; t++)
+    {
+        TEST_ASSERT_TRUE(again.append(t, fieldAt(t)));
+    }
+    TEST_ASSERT_FALSE(again.append(10, fieldAt(10)));
+
+    // Both boots' samples are kept, in order, buffered ones included
+    collected_t c;
+    readRange(&again, 0, UINT64_MAX, &c);
+    TEST_ASSERT_EQUAL(1500, c.count);
+    TEST_ASSERT_EQUAL(499, c.last);
+    TEST_ASSERT_EQUAL(1, c.lastBoot);
+
+    readRange(&again, si7210_log_position(0, 100), si7210_log_position(0, 199), &c);
+    TEST_ASSERT_EQUAL(100, c.count);
+    readRange(&again, si7210_log_position(0, 900), si7210_log_position(1, 99), &c);
+    TEST_ASSERT_EQUAL(200, c.count);
+    readRange(&again, si7210_log_position(1, 0), si7210_log_position(1, UINT32_MAX), &c);
+    TEST_ASSERT_EQUAL(500, c.count);
+
+    // And survive the next reset
+    TEST_ASSERT_TRUE(again.sync());
+    si7210_log third(&flash);
+    TEST_ASSERT_TRUE(third.mount());
+    third.getStats(&stats);
+    TEST_ASSERT_EQUAL(2, stats.boot);
+    TEST_ASSERT_TRUE(stats.oldest == si7210_log_position(0, 0));
+    TEST_ASSERT_TRUE(stats.newest == si7210_log_position(1, 499));
+    readRange(&third, 0, UINT64_MAX, &c);
+    TEST_ASSERT_EQUAL(1500, c.count);
+}
+
+static void countConstant(void *context, uint32_t, uint32_t timestamp, int32_t fieldUt)
+{
+    collected_t *c = (collected_t *)context;
+    if (fieldUt != 500)
+    {
+        c->matches = false;
+    }
+    c->last = timestamp;
+    c->count++;
+}
+
+// CRC-32 (IEEE 802.3) as the log computes it, to forge records
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+void test_constant_field(void)
+{
+    // A magnet that isn't moving
+    remove(LOG_FILE);
+    si7210_file_block_device flash(LOG_FILE, 64 * 1024);
+    si7210_log log(&flash);
+    TEST_ASSERT_TRUE(log.mount());
+    for (uint32_t t = 0; t < 1000; t++)
+    {
+        TEST_ASSERT_TRUE(log.append(t, 500));
+    }
+    TEST_ASSERT_TRUE(log.sync());
+
+    collected_t c = {0, 0, 0, 0, true, true};
+    TEST_ASSERT_EQUAL(1000, log.read(0, UINT64_MAX, countConstant, &c));
+    TEST_ASSERT_TRUE(c.matches);
+    TEST_ASSERT_EQUAL(999, c.last);
+
+    si7210_log_stats_t stats;
+    log.getStats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.skipped);
+
+    // A record with a good CRC that doesn't decode is skipped and counted,
+    // not silently dropped: claim one sample fewer than it holds
+    uint8_t block[4096];
+    TEST_ASSERT_TRUE(flash.read(block, 0, sizeof(block)));
+    uint16_t count = (uint16_t)(block[2] | (block[3] << 8));
+    block[2] = (uint8_t)(count - 1);
+    block[3] = (uint8_t)((count - 1) >> 8);
+    uint32_t crc = crc32(block, 256 - 4);
+    for (int i = 0; i < 4; i++)
+    {
+        block[256 - 4 + i] = (uint8_t)(crc >> (8 * i));
+    }
+    TEST_ASSERT_TRUE(flash.erase(0, sizeof(block)));
+    TEST_ASSERT_TRUE(flash.program(block, 0, sizeof(block)));
+
+    si7210_log again(&flash);
+    TEST_ASSERT_TRUE(again.mount());
+    c = {0, 0, 0, 0, true, true};
+    TEST_ASSERT_EQUAL(1000 - count, again.read(0, UINT64_MAX, countConstant, &c));
+    again.getStats(&stats);
+    TEST_ASSERT_EQUAL(1, stats.skipped);
+}
+
+void test_benchmark(void)
+{
+    remove(LOG_FILE);
+    const uint32_t size = 1024 * 1024;
+    si7210_file_block_device flash(LOG_FILE, size);
+    si7210_log log(&flash);
+    TEST_ASSERT_TRUE(log.mount());
+
+    // A slowly drifting, noisy field at 1 kHz
+    const uint32_t total = 2000000;
+    uint32_t seed = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < total; t++)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        log.append(t, 1200 + (int32_t)(t / 5000) + (int32_t)((seed >> 8) % 9) - 4);
+    }
+    double writeS = seconds(start);
+
+    si7210_log_stats_t stats;
+    log.getStats(&stats);
+    double bytesPerSample = (double)flash.bytesProgrammed() / (total - stats.pending);
+
+    // Recovery: the time for a fresh mount
+    si7210_log again(&flash);
+    uint64_t readBefore = flash.bytesRead();
+    start = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(again.mount());
+    double mountS = seconds(start);
+    uint64_t mountRead = flash.bytesRead() - readBefore;
+
+    // A 1 s range query in a full log
+    collected_t c = {0, 0, 0, 0, true, true};
+    readBefore = flash.bytesRead();
+    start = std::chrono::steady_clock::now();
+    uint32_t n = again.read(total - 100000, total - 99001, collect, &c);
+    double queryS = seconds(start);
+    uint64_t queryRead = flash.bytesRead() - readBefore;
+    TEST_ASSERT_EQUAL(1000, n);
+
+    char msg[256];
+    snprintf(msg, sizeof(msg), "write: %.0f samples/s, %.2f bytes/sample, %lu records, %lu erases (%lu samples/erase)",
+             total / writeS, bytesPerSample, (unsigned long)stats.recordsWritten, (unsigned long)stats.erases,
+             (unsigned long)(total / stats.erases));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "mount: %.3f ms, %lu bytes read; 1 s range query: %.3f ms, %lu bytes read",
+             mountS * 1e3, (unsigned long)mountRead, queryS * 1e3, (unsigned long)queryRead);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_range_reads);
+    RUN_TEST(test_wrap_around_spreads_wear);
+    RUN_TEST(test_recovers_after_power_cut);
+    RUN_TEST(test_clock_restarts_after_reset);
+    RUN_TEST(test_constant_field);
+    RUN_TEST(test_benchmark);
+    remove(LOG_FILE);
+    return UNITY_END();
+}
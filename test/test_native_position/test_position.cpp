@@ -0,0 +1,222 @@
+// File: test_position.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host accuracy tests and benchmarks of the position engine
+// against synthetic field models.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include "../si7210_bench.h"
+#include "si7210.h"
+#include "si7210_position.h"
+#include "si7210_sim_bus.h"
+
+#define HALL_COS 0x30U
+#define HALL_SIN 0x31U
+
+// 1 binary angle unit is ~0.0055 degrees
+#define ANGLE_TOLERANCE_MDEG 12
+
+static double angleErrorMdeg(uint16_t angle, double degrees)
+{
+    double error = si7210_angle_to_mdeg(angle) - degrees * 1000.0;
+    while (error > 180000.0)
+    {
+        error -= 360000.0;
+    }
+    while (error < -180000.0)
+    {
+        error += 360000.0;
+    }
+    return fabs(error);
+}
+
+void test_atan2_accuracy_over_full_turn(void)
+{
+    // Amplitudes from a weak 20mT range magnet to a strong 200mT one
+    const int amplitudes[] = {500, 5000, 20000, 200000};
+    double worst = 0;
+
+    for (int a = 0; a < 4; a++)
+    {
+        for (int tenth = 0; tenth < 3600; tenth++)
+        {
+            double degrees = tenth / 10.0;
+            int32_t x = (int32_t)lround(amplitudes[a] * cos(degrees * M_PI / 180.0));
+            int32_t y = (int32_t)lround(amplitudes[a] * sin(degrees * M_PI / 180.0));
+            double exact = atan2((double)y, (double)x) * 180.0 / M_PI;
+            double error = angleErrorMdeg(si7210_atan2(y, x), exact < 0 ? exact + 360.0 : exact);
+            worst = error > worst ? error : worst;
+        }
+    }
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "atan2 worst error %.1f mdeg", worst);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL(ANGLE_TOLERANCE_MDEG, worst);
+}
+
+void test_atan2_edge_cases(void)
+{
+    TEST_ASSERT_EQUAL(0, si7210_atan2(0, 0));
+    TEST_ASSERT_EQUAL(0, si7210_atan2(0, 1));
+    TEST_ASSERT_EQUAL(16384, si7210_atan2(1, 0));
+    TEST_ASSERT_EQUAL(32768, si7210_atan2(0, -1));
+    TEST_ASSERT_EQUAL(49152, si7210_atan2(-1, 0));
+    TEST_ASSERT_EQUAL(8192, si7210_atan2(INT32_MAX, INT32_MAX));
+    TEST_ASSERT_EQUAL(40960, si7210_atan2(INT32_MIN, INT32_MIN));
+}
+
+// Axial field of a magnet a distance d from the sensor: a dipole falling
+// off with the cube of distance.
+static double dipoleFieldUt(double positionUm)
+{
+    const double d0 = 2000.0; // closest approach, um
+    const double b0 = 150000.0;  // field at closest approach, uT
+    double r = (d0 + positionUm) / d0;
+    return b0 / (r * r * r);
+}
+
+void test_lut_accuracy_on_dipole_model(void)
+{
+    // 0-10mm in 33 calibration points
+    si7210_lut_point_t table[33];
+    for (int i = 0; i < 33; i++)
+    {
+        table[i].position = i * 10000 / 32;
+        table[i].fieldUt = (int32_t)lround(dipoleFieldUt(table[i].position));
+    }
+    si7210_linear_lut lut(table, 33);
+    TEST_ASSERT_TRUE(lut.isValid());
+
+    int worst = 0;
+    for (int um = 0; um <= 10000; um++)
+    {
+        int32_t got = lut.lookup((int32_t)lround(dipoleFieldUt(um)));
+        int error = got > um ? got - um : um - got;
+        worst = error > worst ? error : worst;
+    }
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "dipole 0-10mm, 33 point LUT: worst error %d um", worst);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL(25, worst);
+
+    // Clamped outside the table
+    TEST_ASSERT_EQUAL(0, lut.lookup(1000000));
+    TEST_ASSERT_EQUAL(10000, lut.lookup(0));
+}
+
+void test_lut_rejects_non_monotonic_table(void)
+{
+    si7210_lut_point_t table[4] = {{0, 0}, {100, 1}, {100, 2}, {300, 3}};
+    si7210_linear_lut lut(table, 4);
+    TEST_ASSERT_FALSE(lut.isValid());
+
+    si7210_lut_point_t increasing[3] = {{-100, 0}, {0, 50}, {100, 200}};
+    si7210_linear_lut lut2(increasing, 3);
+    TEST_ASSERT_TRUE(lut2.isValid());
+    TEST_ASSERT_EQUAL(25, lut2.lookup(-50));
+    TEST_ASSERT_EQUAL(125, lut2.lookup(50));
+}
+
+static double simAngle = 0;
+
+static int rotatingMagnet(void *, uint8_t addr7)
+{
+    // 8mT peak on the 20mT range, 1.25uT per code, with offsets and a 10%
+    // weaker sine sensor
+    double radians = simAngle * M_PI / 180.0;
+    if (addr7 == HALL_COS)
+    {
+        return (int)lround((8000.0 * cos(radians) + 300.0) / 1.25);
+    }
+    return (int)lround((7200.0 * sin(radians) - 200.0) / 1.25);
+}
+
+void test_angle_sensor_on_sim_bus(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL_COS);
+    sim.addDevice(HALL_SIN);
+    sim.setFieldSource(rotatingMagnet, NULL);
+    Filter filter;
+    si7210 hallCos(&sim, HALL_COS, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    si7210 hallSin(&sim, HALL_SIN, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_angle_sensor angle(&hallCos, &hallSin);
+    angle.setCalibration(300, -200, (int32_t)(65536.0 * 8000.0 / 7200.0));
+
+    double worst = 0;
+    for (int deg = 0; deg < 360; deg++)
+    {
+        simAngle = deg;
+        double error = angleErrorMdeg(angle.readAngle(), deg);
+        worst = error > worst ? error : worst;
+    }
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "rotary, 8mT magnet via sim bus: worst error %.0f mdeg", worst);
+    TEST_MESSAGE(msg);
+
+    // Limited by the 1.25uT resolution of the readings
+    TEST_ASSERT_LESS_OR_EQUAL(50, worst);
+
+    // Zeroing
+    simAngle = 30;
+    angle.setZero(angle.readAngle());
+    simAngle = 120;
+    TEST_ASSERT_LESS_OR_EQUAL(50, angleErrorMdeg(angle.readAngle(), 90));
+}
+
+void test_benchmark_conversions_per_second(void)
+{
+    const int n = 2000000;
+    int64_t total = 0;
+
+    si7210_bench_time_t start = si7210_bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        total += si7210_atan2((i * 37) % 40000 - 20000, (i * 91) % 40000 - 20000);
+    }
+    double atanSecs = si7210_bench_seconds(start);
+
+    si7210_lut_point_t table[33];
+    for (int i = 0; i < 33; i++)
+    {
+        table[i].position = i * 10000 / 32;
+        table[i].fieldUt = (int32_t)lround(dipoleFieldUt(table[i].position));
+    }
+    si7210_linear_lut lut(table, 33);
+
+    start = si7210_bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        total += lut.lookup((i * 97) % 160000);
+    }
+    double lutSecs = si7210_bench_seconds(start);
+    si7210_bench_keep(total);
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "CORDIC atan2: %.1f M conversions/s, 33 point LUT: %.1f M lookups/s",
+             n / atanSecs / 1e6, n / lutSecs / 1e6);
+    TEST_MESSAGE(msg);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_atan2_accuracy_over_full_turn);
+    RUN_TEST(test_atan2_edge_cases);
+    RUN_TEST(test_lut_accuracy_on_dipole_model);
+    RUN_TEST(test_lut_rejects_non_monotonic_table);
+    RUN_TEST(test_angle_sensor_on_sim_bus);
+    RUN_TEST(test_benchmark_conversions_per_second);
+
+    return UNITY_END();
+}
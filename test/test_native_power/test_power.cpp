@@ -0,0 +1,162 @@
+// File: test_power.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the power state machine and wake up path.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include "si7210.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x31U
+
+static Filter firFilter()
+{
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 4;
+    return filter;
+}
+
+void test_sleep_is_one_write_from_active(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    sim.resetStats();
+    TEST_ASSERT_TRUE(hall.sleep());
+
+    TEST_ASSERT_EQUAL(1, sim.transactions());
+    TEST_ASSERT_TRUE(sim.isAsleep(HALL));
+    TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::SLEEP);
+}
+
+void test_wakeup_restores_configuration(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldCode(HALL, 400);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    uint8_t configured[REG_A5 - REG_0XC6 + 1];
+    for (unsigned int reg = REG_0XC6; reg <= REG_A5; reg++)
+    {
+        configured[reg - REG_0XC6] = sim.peek(HALL, reg);
+    }
+
+    TEST_ASSERT_TRUE(hall.sleep());
+
+    // Asleep the sensor has lost its neodymium coefficients and filter
+    sim.resetStats();
+    TEST_ASSERT_TRUE(hall.wakeup());
+    uint32_t wakeTransactions = sim.transactions();
+    uint64_t wakeBusNs = sim.busTimeNs();
+
+    TEST_ASSERT_FALSE(sim.isAsleep(HALL));
+    TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::ACTIVE);
+    for (unsigned int reg = REG_0XC6; reg <= REG_A5; reg++)
+    {
+        TEST_ASSERT_EQUAL_HEX8(configured[reg - REG_0XC6], sim.peek(HALL, reg));
+    }
+    TEST_ASSERT_EQUAL(0, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+    TEST_ASSERT_EQUAL(500, hall.getFieldStrength());
+
+    // Wake + 1 burst of the configuration registers + start + 2 polls of
+    // dspsigm. A full init() of this sensor is 19 transactions.
+    TEST_ASSERT_EQUAL(5, wakeTransactions);
+
+    sim.resetStats();
+    hall.init();
+    char msg[192];
+    snprintf(msg, sizeof(msg), "wake to first fresh sample: %lu transactions, %lu us bus time @400kHz (init(): %lu transactions, %lu us)",
+             (unsigned long)wakeTransactions, (unsigned long)(wakeBusNs / 1000),
+             (unsigned long)sim.transactions(), (unsigned long)(sim.busTimeNs() / 1000));
+    TEST_MESSAGE(msg);
+}
+
+void test_wakeup_restores_switch_configuration(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    si7210_switch_t sw;
+    sw.thresholdUt = 2000;
+    sw.hysteresisUt = 400;
+    TEST_ASSERT_TRUE(hall.setSwitch(sw));
+    uint8_t reg0xC6 = sim.peek(HALL, REG_0XC6);
+
+    TEST_ASSERT_TRUE(hall.sleep());
+    TEST_ASSERT_TRUE(hall.wakeup());
+
+    TEST_ASSERT_EQUAL_HEX8(reg0xC6, sim.peek(HALL, REG_0XC6));
+}
+
+void test_idle_and_back_is_one_write_each(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    sim.resetStats();
+    TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::IDLE));
+    TEST_ASSERT_EQUAL(1, sim.transactions());
+    TEST_ASSERT_EQUAL(STOP_MASK, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+
+    sim.resetStats();
+    TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::ACTIVE));
+    TEST_ASSERT_EQUAL(1, sim.transactions());
+    TEST_ASSERT_EQUAL(0, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+}
+
+void test_sleep_timer(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::SLEEP_TIMER, 0x40));
+
+    TEST_ASSERT_EQUAL_HEX8(0x40, sim.peek(HALL, REG_0XC8));
+    TEST_ASSERT_EQUAL(SLTIMENA_MASK, sim.peek(HALL, REG_0XC9) & (SLTIMENA_MASK | SLFAST_MASK));
+    TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::SLEEP_TIMER);
+
+    // Sleeping and waking comes back to the sleep timer
+    TEST_ASSERT_TRUE(hall.sleep());
+    TEST_ASSERT_TRUE(hall.wakeup());
+    TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::SLEEP_TIMER);
+    TEST_ASSERT_EQUAL_HEX8(0x40, sim.peek(HALL, REG_0XC8));
+}
+
+void test_set_power_state_from_sleep_wakes(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_200mT, si7210_magnet_t::CERAMIC, si7210_mode_t::CONST_CONVERSION, firFilter());
+    uint8_t a0 = sim.peek(HALL, REG_A0);
+
+    TEST_ASSERT_TRUE(hall.sleep());
+    TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::IDLE));
+
+    TEST_ASSERT_FALSE(sim.isAsleep(HALL));
+    TEST_ASSERT_TRUE(hall.getPowerState() == si7210_power_t::IDLE);
+    TEST_ASSERT_EQUAL_HEX8(a0, sim.peek(HALL, REG_A0));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sleep_is_one_write_from_active);
+    RUN_TEST(test_wakeup_restores_configuration);
+    RUN_TEST(test_wakeup_restores_switch_configuration);
+    RUN_TEST(test_idle_and_back_is_one_write_each);
+    RUN_TEST(test_sleep_timer);
+    RUN_TEST(test_set_power_state_from_sleep_wakes);
+
+    return UNITY_END();
+}
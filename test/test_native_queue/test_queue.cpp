@@ -0,0 +1,235 @@
+// File: test_queue.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the transaction coalescing command queue, and the
+// transaction counts of init() with and without it.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include "si7210.h"
+#include "si7210_command_queue.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x30U
+
+// Passes transfers on to whichever bus it points at, so one si7210 can be
+// moved to a fresh (power on) sensor.
+class proxy_bus : public si7210_bus
+{
+public:
+    si7210_bus *target;
+
+    proxy_bus(si7210_bus *b) : target(b) {}
+
+    bool transfer(uint8_t addr8, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen)
+    {
+        return target->transfer(addr8, tx, txLen, rx, rxLen);
+    }
+};
+
+static Filter firFilter()
+{
+    Filter filter;
+    filter.filterType = si7210_filters_t::FIR;
+    filter.burstsize = 4;
+    return filter;
+}
+
+// Checks the sensor is configured for 20mT, neodymium, continuous
+// conversion and firFilter()
+static void checkConfigured(si7210_sim_bus *sim)
+{
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        // 20mT neodymium coefficients, OTP 0x2D-0x32
+        TEST_ASSERT_EQUAL_HEX8((uint8_t)((0x2D + i) * 7), sim->peek(HALL, REG_A0 + i));
+        TEST_ASSERT_EQUAL_HEX8((uint8_t)((0x30 + i) * 7), sim->peek(HALL, REG_A3 + i));
+    }
+    TEST_ASSERT_EQUAL_HEX8(DF_FIR_MASK | (4 << 1), sim->peek(HALL, REG_0XCD));
+    TEST_ASSERT_EQUAL_HEX8(0, sim->peek(HALL, REG_0XC8));
+    TEST_ASSERT_EQUAL_HEX8(0x02, sim->peek(HALL, REG_0XC9) & 0x03);
+    TEST_ASSERT_EQUAL(0, sim->peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+}
+
+void test_init_transactions(void)
+{
+    si7210_sim_bus first;
+    first.addDevice(HALL);
+    proxy_bus proxy(&first);
+    si7210 hall(&proxy, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+    checkConfigured(&first);
+    uint32_t queued = first.transactions();
+    uint64_t queuedNs = first.busTimeNs();
+
+    // init() again on a sensor straight out of power on reset, inside an
+    // outer queue so every register access it makes is counted. Without the
+    // queue each one was a transaction.
+    si7210_sim_bus second;
+    second.addDevice(HALL);
+    proxy.target = &second;
+    si7210_command_queue_stats_t stats;
+    {
+        si7210_command_queue queue(&hall);
+        hall.init();
+        TEST_ASSERT_TRUE(queue.flush());
+        queue.getStats(&stats);
+    }
+    checkConfigured(&second);
+    TEST_ASSERT_EQUAL(queued, second.transactions());
+    TEST_ASSERT_EQUAL(stats.transactions, second.transactions());
+
+    // 3 reads and 3 writes in setMode(), 6 x (2 writes and a read) and 6
+    // coefficient writes in setRange(), 1 write in setFilter()
+    TEST_ASSERT_EQUAL(9, stats.reads);
+    TEST_ASSERT_EQUAL(22, stats.writes);
+
+    // Prefetch + 6 x (otp_addr, otp_ctrl, otp_data) + 1 burst; 0xC4 and 0xC8
+    // already hold their values
+    TEST_ASSERT_EQUAL(20, queued);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "init(): %lu register accesses -> %lu transactions (%lu us bus time @400kHz), %lu writes dropped",
+             (unsigned long)(stats.reads + stats.writes), (unsigned long)queued,
+             (unsigned long)(queuedNs / 1000), (unsigned long)stats.dropped);
+    TEST_MESSAGE(msg);
+}
+
+void test_writes_are_merged_and_dropped(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    sim.resetStats();
+    si7210_command_queue_stats_t stats;
+    {
+        si7210_command_queue queue(&hall);
+
+        // Written twice, only the last value goes out
+        TEST_ASSERT_TRUE(hall.writeRegister(REG_A0, 0x11));
+        TEST_ASSERT_TRUE(hall.writeRegister(REG_A0, 0x12));
+
+        // Already holds the value
+        TEST_ASSERT_TRUE(hall.writeRegister(REG_0XCD, sim.peek(HALL, REG_0XCD)));
+
+        // Across the cached 0xCD, so one burst
+        TEST_ASSERT_TRUE(hall.writeRegister(REG_A3, 0x13));
+
+        // Reads come from the queue
+        uint8_t data;
+        TEST_ASSERT_TRUE(hall.readRegister(REG_A0, &data));
+        TEST_ASSERT_EQUAL_HEX8(0x12, data);
+
+        // And 0xC4 goes last
+        TEST_ASSERT_TRUE(hall.writeRegister(REG_0XC4, STOP_MASK));
+        TEST_ASSERT_TRUE(hall.writeRegister(REG_0XC6, 0x20));
+
+        TEST_ASSERT_EQUAL(0, sim.transactions());
+        TEST_ASSERT_TRUE(queue.flush());
+        queue.getStats(&stats);
+    }
+
+    // 0xC6-0xCE over the registers init() read, then 0xC4
+    TEST_ASSERT_EQUAL(2, sim.transactions());
+    TEST_ASSERT_EQUAL(2, stats.transactions);
+    TEST_ASSERT_EQUAL(2, stats.dropped);
+    TEST_ASSERT_EQUAL(1, stats.cachedReads);
+    TEST_ASSERT_EQUAL_HEX8(0x12, sim.peek(HALL, REG_A0));
+    TEST_ASSERT_EQUAL_HEX8(0x13, sim.peek(HALL, REG_A3));
+    TEST_ASSERT_EQUAL_HEX8(0x20, sim.peek(HALL, REG_0XC6));
+    TEST_ASSERT_EQUAL(STOP_MASK, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+}
+
+void test_reads_wait_for_what_they_depend_on(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    sim.resetStats();
+    si7210_command_queue queue(&hall);
+
+    // An OTP read needs the OTP writes, but not the queued configuration
+    TEST_ASSERT_TRUE(hall.writeRegister(REG_A1, 0x55));
+    TEST_ASSERT_TRUE(hall.writeRegister(REG_OTP_ADDR, 0x25));
+    TEST_ASSERT_TRUE(hall.writeRegister(REG_OTP_CTRL, OTP_READ_EN_MASK));
+    uint8_t data;
+    TEST_ASSERT_TRUE(hall.readRegister(REG_OTP_DATA, &data));
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)(0x25 * 7), data);
+    TEST_ASSERT_EQUAL(3, sim.transactions());
+    TEST_ASSERT_TRUE(sim.peek(HALL, REG_A1) != 0x55);
+
+    // Any other read needs everything
+    TEST_ASSERT_TRUE(hall.writeRegister(REG_0XC4, STOP_MASK));
+    TEST_ASSERT_TRUE(hall.readRegister(REG_DSPSIGM, &data));
+    TEST_ASSERT_EQUAL(6, sim.transactions());
+    TEST_ASSERT_EQUAL_HEX8(0x55, sim.peek(HALL, REG_A1));
+
+    // Nested queues pass everything to the outer one
+    {
+        si7210_command_queue inner(&hall);
+        TEST_ASSERT_TRUE(inner.write(REG_A2, 0x66));
+        TEST_ASSERT_TRUE(inner.flush());
+    }
+    TEST_ASSERT_EQUAL(6, sim.transactions());
+    TEST_ASSERT_TRUE(queue.flush());
+    TEST_ASSERT_EQUAL(7, sim.transactions());
+    TEST_ASSERT_EQUAL_HEX8(0x66, sim.peek(HALL, REG_A2));
+}
+
+void test_flush_reports_errors(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 missing(&sim, 0x33, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    {
+        si7210_command_queue queue(&missing);
+        TEST_ASSERT_TRUE(missing.writeRegister(REG_A0, 0x01));
+        TEST_ASSERT_FALSE(queue.flush());
+
+        // Nothing left queued
+        TEST_ASSERT_TRUE(queue.flush());
+    }
+
+    // And the standalone setters still report failure
+    TEST_ASSERT_FALSE(missing.setMode(si7210_mode_t::CONST_CONVERSION));
+}
+
+void test_driver_calls_see_queued_writes(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NEODYMIUM, si7210_mode_t::CONST_CONVERSION, firFilter());
+
+    // The second call's read-modify-writes must start from the first's
+    // queued values, not the cache
+    {
+        si7210_command_queue queue(&hall);
+        TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::IDLE));
+        TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::ACTIVE));
+    }
+    TEST_ASSERT_EQUAL(0, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+    TEST_ASSERT_TRUE(si7210_power_t::ACTIVE == hall.getPowerState());
+
+    {
+        si7210_command_queue queue(&hall);
+        TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::ACTIVE));
+        TEST_ASSERT_TRUE(hall.setPowerState(si7210_power_t::IDLE));
+    }
+    TEST_ASSERT_EQUAL(STOP_MASK, sim.peek(HALL, REG_0XC4) & (SLEEP_MASK | STOP_MASK));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_transactions);
+    RUN_TEST(test_writes_are_merged_and_dropped);
+    RUN_TEST(test_reads_wait_for_what_they_depend_on);
+    RUN_TEST(test_flush_reports_errors);
+    RUN_TEST(test_driver_calls_see_queued_writes);
+    return UNITY_END();
+}
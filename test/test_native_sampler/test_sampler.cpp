@@ -0,0 +1,142 @@
+// File: test_sampler.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the periodic acquisition scheduler.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <stdio.h>
+#include <thread>
+#include "si7210.h"
+#include "si7210_sampler.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x31U
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t lastTimestampUs;
+    bool ordered;
+    int fieldUt;
+} collector_t;
+
+static void collect(void *context, const si7210_sample_t *sample)
+{
+    collector_t *c = (collector_t *)context;
+    if (c->count > 0 && (int32_t)(sample->timestampUs - c->lastTimestampUs) <= 0)
+    {
+        c->ordered = false;
+    }
+    c->count++;
+    c->lastTimestampUs = sample->timestampUs;
+    c->fieldUt = sample->fieldUt;
+}
+
+static void report(const char *what, si7210_sampler_stats_t *stats)
+{
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%s: period %luus, %lu samples, %lu missed, lateness min/mean/max %ld/%ld/%ldus, jitter %luus",
+             what, (unsigned long)stats->periodUs, (unsigned long)stats->samples, (unsigned long)stats->missed,
+             (long)stats->minLatenessUs, (long)stats->meanLatenessUs, (long)stats->maxLatenessUs,
+             (unsigned long)stats->jitterUs);
+    TEST_MESSAGE(msg);
+}
+
+void test_samples_at_requested_rate(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldCode(HALL, 800);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    collector_t c = {0, 0, true, 0};
+    si7210_sampler sampler(&hall, collect, &c);
+    TEST_ASSERT_TRUE(sampler.start(1000));
+    TEST_ASSERT_FALSE(sampler.start(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    sampler.stop();
+
+    si7210_sampler_stats_t stats;
+    sampler.getStats(&stats);
+    report("1kHz, fast bus", &stats);
+
+    TEST_ASSERT_EQUAL(1000, stats.periodUs);
+    TEST_ASSERT_EQUAL(stats.samples, c.count);
+    TEST_ASSERT_TRUE(c.ordered);
+    TEST_ASSERT_EQUAL(1000, c.fieldUt);
+
+    // Every period is either sampled or counted as missed
+    TEST_ASSERT_INT_WITHIN(25, 500, stats.samples + stats.missed);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, stats.minLatenessUs);
+}
+
+void test_slow_bus_skips_instead_of_queueing(void)
+{
+    // At 10kHz a sample (2 register reads) takes ~8ms of bus time, so only
+    // about 1 in 8 periods at 1kHz can be sampled.
+    si7210_sim_bus sim(10000);
+    sim.addDevice(HALL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    sim.setRealTime(true);
+    sim.resetStats();
+
+    collector_t c = {0, 0, true, 0};
+    si7210_sampler sampler(&hall, collect, &c);
+    TEST_ASSERT_TRUE(sampler.start(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    sampler.stop();
+
+    si7210_sampler_stats_t stats;
+    sampler.getStats(&stats);
+    report("1kHz, overloaded bus", &stats);
+
+    TEST_ASSERT_GREATER_THAN(0, stats.samples);
+    TEST_ASSERT_GREATER_THAN(stats.samples * 2, stats.missed);
+    TEST_ASSERT_INT_WITHIN(25, 500, stats.samples + stats.missed);
+
+    // Each sample starts no earlier than its period and takes at least its
+    // bus time, so skipping drops at least that many whole periods after
+    // every sample instead of queueing them to run late. (Lateness depends
+    // on the host's scheduling and is only reported.)
+    uint32_t sampleUs = (uint32_t)(sim.busTimeNs() / 1000 / stats.samples);
+    TEST_ASSERT_GREATER_OR_EQUAL(stats.samples * (sampleUs / stats.periodUs), stats.missed);
+}
+
+void test_restart(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_sampler sampler(&hall, NULL, NULL);
+    TEST_ASSERT_TRUE(sampler.start(200));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sampler.stop();
+    TEST_ASSERT_FALSE(sampler.isRunning());
+
+    TEST_ASSERT_TRUE(sampler.start(2000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sampler.stop();
+
+    si7210_sampler_stats_t stats;
+    sampler.getStats(&stats);
+    TEST_ASSERT_EQUAL(500, stats.periodUs);
+    TEST_ASSERT_INT_WITHIN(10, 100, stats.samples + stats.missed);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_samples_at_requested_rate);
+    RUN_TEST(test_slow_bus_skips_instead_of_queueing);
+    RUN_TEST(test_restart);
+
+    return UNITY_END();
+}
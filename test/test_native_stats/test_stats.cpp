@@ -0,0 +1,271 @@
+// File: test_stats.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests and benchmark of the streaming statistics, replaying
+// synthetic noise and samples captured from the simulated bus.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "si7210.h"
+#include "si7210_sampler.h"
+#include "si7210_sim_bus.h"
+#include "si7210_stats.h"
+
+#define HALL 0x30U
+#define NOISE_SAMPLES 200000
+
+// Deterministic gaussian noise (Box-Muller on a fixed LCG)
+static uint32_t seed = 1;
+
+static double uniform()
+{
+    seed = seed * 1664525U + 1013904223U;
+    return ((seed >> 8) + 0.5) / 16777216.0;
+}
+
+static int32_t noise(double sigma)
+{
+    return (int32_t)lround(sigma * sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform()));
+}
+
+static int32_t readings[NOISE_SAMPLES];
+
+void test_summary_matches_two_pass(void)
+{
+    seed = 1;
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        readings[i] = 12345 + noise(20.0);
+    }
+
+    si7210_stats stats;
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        stats.add(readings[i]);
+    }
+
+    double mean = 0;
+    int32_t min = readings[0];
+    int32_t max = readings[0];
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        mean += readings[i];
+        min = readings[i] < min ? readings[i] : min;
+        max = readings[i] > max ? readings[i] : max;
+    }
+    mean /= NOISE_SAMPLES;
+    double var = 0;
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        var += (readings[i] - mean) * (readings[i] - mean);
+    }
+    double stddev = sqrt(var / (NOISE_SAMPLES - 1));
+
+    si7210_stats_summary_t summary;
+    stats.getSummary(&summary);
+    TEST_ASSERT_EQUAL(NOISE_SAMPLES, summary.count);
+    TEST_ASSERT_EQUAL(min, summary.minUt);
+    TEST_ASSERT_EQUAL(max, summary.maxUt);
+    TEST_ASSERT_EQUAL(max - min, summary.peakToPeakUt);
+    TEST_ASSERT_TRUE(fabs(summary.meanUt - mean) < 1e-6);
+    TEST_ASSERT_TRUE(fabs(summary.stddevUt - stddev) < 1e-6);
+    TEST_ASSERT_TRUE(fabs(summary.stddevUt - 20.0) < 0.5);
+
+    stats.reset();
+    stats.getSummary(&summary);
+    TEST_ASSERT_EQUAL(0, summary.count);
+    stats.add(-7);
+    stats.getSummary(&summary);
+    TEST_ASSERT_TRUE(summary.meanUt == -7.0);
+    TEST_ASSERT_TRUE(summary.stddevUt == 0.0);
+}
+
+void test_histogram(void)
+{
+    si7210_stats stats;
+    TEST_ASSERT_FALSE(stats.setHistogram(0, 0));
+    TEST_ASSERT_TRUE(stats.setHistogram(-10, 5));
+
+    const int32_t values[] = {-11, -10, -6, -5, 0, 4, 149, 150, 1000};
+    for (int i = 0; i < 9; i++)
+    {
+        stats.add(values[i]);
+    }
+
+    TEST_ASSERT_EQUAL(1, stats.getUnderflow());
+    TEST_ASSERT_EQUAL(2, stats.getOverflow());
+    TEST_ASSERT_EQUAL(2, stats.getBin(0));
+    TEST_ASSERT_EQUAL(1, stats.getBin(1));
+    TEST_ASSERT_EQUAL(2, stats.getBin(2));
+    TEST_ASSERT_EQUAL(1, stats.getBin(SI7210_STATS_BINS - 1));
+    TEST_ASSERT_EQUAL(145, stats.getBinLowUt(SI7210_STATS_BINS - 1));
+    TEST_ASSERT_EQUAL(0, stats.getBin(SI7210_STATS_BINS));
+}
+
+void test_allan_deviation_of_white_noise(void)
+{
+    // White noise averages down as 1/sqrt(tau)
+    const uint32_t taus[] = {1, 4, 16, 64, 256};
+    si7210_stats stats;
+    uint32_t tooMany[SI7210_STATS_MAX_TAUS + 1] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+    TEST_ASSERT_FALSE(stats.setTaus(tooMany, SI7210_STATS_MAX_TAUS + 1));
+    const uint32_t zero[] = {0};
+    TEST_ASSERT_FALSE(stats.setTaus(zero, 1));
+    TEST_ASSERT_TRUE(stats.setTaus(taus, 5));
+
+    double adev;
+    TEST_ASSERT_FALSE(stats.getAllanDeviation(0, &adev));
+
+    seed = 2;
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        stats.add(-500 + noise(40.0));
+    }
+
+    for (size_t i = 0; i < stats.getNumTaus(); i++)
+    {
+        TEST_ASSERT_TRUE(stats.getAllanDeviation(i, &adev));
+        double expected = 40.0 / sqrt((double)stats.getTau(i));
+
+        char msg[80];
+        snprintf(msg, sizeof(msg), "tau %4u: adev %.3f uT (white noise %.3f uT)", (unsigned)stats.getTau(i), adev, expected);
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(fabs(adev - expected) < expected * 0.1);
+    }
+    TEST_ASSERT_FALSE(stats.getAllanDeviation(5, &adev));
+
+    // A drift shows up at long taus instead
+    si7210_stats drift;
+    drift.setTaus(taus, 5);
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        drift.add(i / 100);
+    }
+    double shortTau;
+    double longTau;
+    drift.getAllanDeviation(0, &shortTau);
+    drift.getAllanDeviation(4, &longTau);
+    TEST_ASSERT_TRUE(longTau > shortTau);
+}
+
+static si7210_stats sampled;
+static si7210_monitor sampledLock;
+static int32_t captured[4000];
+static uint32_t numCaptured = 0;
+
+static void onSample(void *, const si7210_sample_t *sample)
+{
+    sampledLock.lock();
+    sampled.add(sample->fieldUt);
+    if (numCaptured < sizeof(captured) / sizeof(captured[0]))
+    {
+        captured[numCaptured++] = sample->fieldUt;
+    }
+    sampledLock.unlock();
+}
+
+static int noisyField(void *, uint8_t)
+{
+    return 800 + noise(6.0);
+}
+
+void test_sample_path_matches_replay(void)
+{
+    const uint32_t taus[] = {1, 10, 100};
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(noisyField, NULL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    seed = 3;
+    sampled.setHistogram(950, 2);
+    sampled.setTaus(taus, 3);
+    si7210_sampler sampler(&hall, onSample, NULL);
+    sampler.start(2000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    sampler.stop();
+
+    sampledLock.lock();
+    si7210_stats live = sampled;
+    sampledLock.unlock();
+    TEST_ASSERT_TRUE(live.getCount() > 100);
+    TEST_ASSERT_TRUE(live.getCount() <= numCaptured);
+
+    si7210_stats replay;
+    replay.setHistogram(950, 2);
+    replay.setTaus(taus, 3);
+    for (uint32_t i = 0; i < live.getCount(); i++)
+    {
+        replay.add(captured[i]);
+    }
+
+    si7210_stats_summary_t a;
+    si7210_stats_summary_t b;
+    live.getSummary(&a);
+    replay.getSummary(&b);
+    TEST_ASSERT_EQUAL_MEMORY(&a, &b, sizeof(a));
+    for (size_t i = 0; i < SI7210_STATS_BINS; i++)
+    {
+        TEST_ASSERT_EQUAL(live.getBin(i), replay.getBin(i));
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        double adevLive = 0;
+        double adevReplay = 0;
+        live.getAllanDeviation(i, &adevLive);
+        replay.getAllanDeviation(i, &adevReplay);
+        TEST_ASSERT_TRUE(adevLive == adevReplay);
+    }
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "%u samples via sim bus: mean %.2f uT, stddev %.2f uT, p-p %d uT",
+             (unsigned)a.count, a.meanUt, a.stddevUt, (int)a.peakToPeakUt);
+    TEST_MESSAGE(msg);
+}
+
+void test_benchmark_add(void)
+{
+    const uint32_t taus[] = {1, 2, 5, 10, 20, 50, 100, 1000};
+    si7210_stats stats;
+    stats.setTaus(taus, 8);
+
+    seed = 4;
+    for (int i = 0; i < NOISE_SAMPLES; i++)
+    {
+        readings[i] = noise(10.0);
+    }
+
+    const int passes = 20;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++)
+    {
+        for (int i = 0; i < NOISE_SAMPLES; i++)
+        {
+            stats.add(readings[i]);
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "add() with 8 taus: %.1f ns/sample", secs * 1e9 / ((double)passes * NOISE_SAMPLES));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL((uint32_t)passes * NOISE_SAMPLES, stats.getCount());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_summary_matches_two_pass);
+    RUN_TEST(test_histogram);
+    RUN_TEST(test_allan_deviation_of_white_noise);
+    RUN_TEST(test_sample_path_matches_replay);
+    RUN_TEST(test_benchmark_add);
+    return UNITY_END();
+}
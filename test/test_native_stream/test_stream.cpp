@@ -0,0 +1,223 @@
+// File: test_stream.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests and benchmark of the double buffered continuous
+// readout over the simulated bus.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include "../si7210_bench.h"
+#include "si7210.h"
+#include "si7210_sim_bus.h"
+#include "si7210_stream.h"
+
+#define HALL 0x30U
+#define MISSING 0x33U
+
+// Each measurement is one code higher than the last, so gaps and reordering
+// show up in the samples.
+static std::atomic<int> counter(0);
+
+static int countingField(void *, uint8_t)
+{
+    return (counter++ % 16000) - 8000;
+}
+
+static Filter filter;
+
+void test_blocks_arrive_in_order(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(countingField, NULL);
+    sim.setRealTime(true);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+    counter = 0;
+
+    si7210_stream stream(&hall);
+    TEST_ASSERT_TRUE(stream.start());
+    TEST_ASSERT_FALSE(stream.start());
+
+    int32_t last = -100000;
+    for (uint32_t b = 0; b < 50; b++)
+    {
+        const si7210_block_t *block = stream.waitBlock();
+        TEST_ASSERT_NOT_NULL(block);
+        TEST_ASSERT_EQUAL(b, block->sequence);
+        TEST_ASSERT_TRUE((int32_t)(block->lastUs - block->firstUs) >= 0);
+        for (int i = 0; i < SI7210_STREAM_BLOCK_SIZE; i++)
+        {
+            TEST_ASSERT_TRUE(block->fieldUt[i] > last);
+            last = block->fieldUt[i];
+        }
+        stream.releaseBlock();
+    }
+
+    stream.stop();
+    TEST_ASSERT_NULL(stream.waitBlock());
+
+    si7210_stream_stats_t stats;
+    stream.getStats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.overruns);
+    TEST_ASSERT_EQUAL(0, stats.errors);
+    TEST_ASSERT_EQUAL(0, stats.stale);
+    TEST_ASSERT_TRUE(stats.blocks >= 50);
+    TEST_ASSERT_TRUE(stats.samples >= 50 * SI7210_STREAM_BLOCK_SIZE);
+}
+
+void test_slow_consumer_overruns(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(countingField, NULL);
+    sim.setRealTime(true);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_stream stream(&hall);
+    stream.start();
+
+    // Hold the first block for long enough to fill several more
+    const si7210_block_t *block = stream.waitBlock();
+    uint32_t first = block->sequence;
+    int32_t firstSample = block->fieldUt[0];
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // The held block isn't overwritten
+    TEST_ASSERT_EQUAL(first, block->sequence);
+    TEST_ASSERT_EQUAL(firstSample, block->fieldUt[0]);
+    stream.releaseBlock();
+
+    block = stream.waitBlock();
+    uint32_t next = block->sequence;
+    stream.releaseBlock();
+    stream.stop();
+
+    si7210_stream_stats_t stats;
+    stream.getStats(&stats);
+    TEST_ASSERT_TRUE(stats.overruns > 0);
+
+    // Every sequence number in the gap is an overrun (one more block may
+    // have been dropped after it)
+    TEST_ASSERT_TRUE(next - first - 1 <= stats.overruns);
+    TEST_ASSERT_TRUE(next - first - 1 >= stats.overruns - 1);
+}
+
+void test_stale_readings_skipped(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldCode(HALL, 100);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    // Stopped: no new measurements
+    hall.setPowerState(si7210_power_t::IDLE);
+
+    si7210_stream stream(&hall);
+    stream.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    si7210_stream_stats_t stats;
+    stream.getStats(&stats);
+    stream.stop();
+    TEST_ASSERT_EQUAL(0, stats.blocks);
+    TEST_ASSERT_TRUE(stats.stale > 0);
+
+    // Without skipping, the stale readings are stored
+    stream.start(false);
+    const si7210_block_t *block = stream.waitBlock();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(125, block->fieldUt[0]);
+    stream.releaseBlock();
+    stream.stop();
+}
+
+void test_errors_counted_while_running(void)
+{
+    si7210_sim_bus sim;
+    si7210 missing(&sim, MISSING, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_stream stream(&missing);
+    stream.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    si7210_stream_stats_t stats;
+    stream.getStats(&stats);
+    TEST_ASSERT_TRUE(stats.errors > 0);
+    TEST_ASSERT_EQUAL(stats.samples, stats.errors);
+    stream.stop();
+
+    // Backing off, not retrying flat out: about 7 reads to reach the 10 ms
+    // max wait, then one every 10 ms
+    char msg[64];
+    snprintf(msg, sizeof(msg), "failed reads in 100 ms: %lu", (unsigned long)stats.errors);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(stats.errors < 50);
+}
+
+void test_benchmark_stream_vs_get_field_strength(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    sim.setFieldSource(countingField, NULL);
+    sim.setRealTime(true);
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    // One sample at a time with getFieldStrength()
+    const int n = 100 * SI7210_STREAM_BLOCK_SIZE;
+    int64_t total = 0;
+    sim.resetStats();
+    si7210_bench_time_t start = si7210_bench_now();
+    for (int i = 0; i < n; i++)
+    {
+        total += hall.getFieldStrength();
+    }
+    double pollSecs = si7210_bench_seconds(start);
+    uint32_t pollTransactions = sim.transactions();
+    uint64_t pollBusNs = sim.busTimeNs();
+
+    // Streamed
+    si7210_stream stream(&hall);
+    sim.resetStats();
+    start = si7210_bench_now();
+    stream.start();
+    for (int b = 0; b < n / SI7210_STREAM_BLOCK_SIZE; b++)
+    {
+        const si7210_block_t *block = stream.waitBlock();
+        total += block->fieldUt[0];
+        stream.releaseBlock();
+    }
+    double streamSecs = si7210_bench_seconds(start);
+    stream.stop();
+    si7210_bench_keep(total);
+
+    si7210_stream_stats_t stats;
+    stream.getStats(&stats);
+    double perSample = (double)sim.transactions() / stats.samples;
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "getFieldStrength(): %.0f samples/s, %.1f transactions, %.0f us bus time per sample",
+             n / pollSecs, (double)pollTransactions / n, pollBusNs / 1000.0 / n);
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "stream:             %.0f samples/s, %.1f transactions, %.0f us bus time per sample",
+             n / streamSecs, perSample, sim.busTimeNs() / 1000.0 / stats.samples);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(perSample < 1.01);
+    TEST_ASSERT_EQUAL(0, stats.overruns);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_blocks_arrive_in_order);
+    RUN_TEST(test_slow_consumer_overruns);
+    RUN_TEST(test_stale_readings_skipped);
+    RUN_TEST(test_errors_counted_while_running);
+    RUN_TEST(test_benchmark_stream_vs_get_field_strength);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+// File: test_switch.cpp
+// Author: David Antaki
+// Date: 10/18/26
+// License: This software is not open source and is copyrighted by David
+// Antaki.
+// Contents: Host tests of the digital switch threshold/hysteresis API.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include "si7210.h"
+#include "si7210_sim_bus.h"
+
+#define HALL 0x31U
+
+static const si7210_range_t ranges[2] = {si7210_range_t::RANGE_20mT, si7210_range_t::RANGE_200mT};
+
+void test_sw_op_decode_is_strictly_increasing(void)
+{
+    for (int r = 0; r < 2; r++)
+    {
+        // 127 is the special "0" code, everything else increases
+        TEST_ASSERT_EQUAL(0, si7210::decodeSwOp(SW_OP_ZERO, ranges[r]));
+        for (int code = 1; code < SW_OP_ZERO; code++)
+        {
+            TEST_ASSERT_GREATER_THAN(si7210::decodeSwOp(code - 1, ranges[r]), si7210::decodeSwOp(code, ranges[r]));
+        }
+    }
+
+    TEST_ASSERT_EQUAL(80, si7210::decodeSwOp(0, si7210_range_t::RANGE_20mT));
+    TEST_ASSERT_EQUAL(19200, si7210::decodeSwOp(126, si7210_range_t::RANGE_20mT));
+    TEST_ASSERT_EQUAL(192000, si7210::decodeSwOp(126, si7210_range_t::RANGE_200mT));
+}
+
+void test_sw_hyst_decode_is_strictly_increasing(void)
+{
+    for (int r = 0; r < 2; r++)
+    {
+        TEST_ASSERT_EQUAL(0, si7210::decodeSwHyst(SW_HYST_ZERO, ranges[r]));
+        for (int code = 1; code < SW_HYST_ZERO; code++)
+        {
+            TEST_ASSERT_GREATER_THAN(si7210::decodeSwHyst(code - 1, ranges[r]), si7210::decodeSwHyst(code, ranges[r]));
+        }
+    }
+
+    TEST_ASSERT_EQUAL(40, si7210::decodeSwHyst(0, si7210_range_t::RANGE_20mT));
+    TEST_ASSERT_EQUAL(8960, si7210::decodeSwHyst(62, si7210_range_t::RANGE_20mT));
+}
+
+void test_every_code_round_trips(void)
+{
+    for (int r = 0; r < 2; r++)
+    {
+        for (int code = 0; code <= SW_OP_ZERO; code++)
+        {
+            TEST_ASSERT_EQUAL(code, si7210::encodeSwOp(si7210::decodeSwOp(code, ranges[r]), ranges[r]));
+        }
+        for (int code = 0; code <= SW_HYST_ZERO; code++)
+        {
+            TEST_ASSERT_EQUAL(code, si7210::encodeSwHyst(si7210::decodeSwHyst(code, ranges[r]), ranges[r]));
+        }
+    }
+}
+
+// For every requested value the encoding must be the nearest representable
+// one, i.e. no neighbouring code is closer.
+void test_encoding_is_nearest(void)
+{
+    for (int r = 0; r < 2; r++)
+    {
+        int top = si7210::decodeSwOp(126, ranges[r]) + 1000;
+        for (int ut = -100; ut < top; ut += 3)
+        {
+            int got = si7210::decodeSwOp(si7210::encodeSwOp(ut, ranges[r]), ranges[r]);
+            int error = got > ut ? got - ut : ut - got;
+            for (int code = 0; code <= SW_OP_ZERO; code++)
+            {
+                int other = si7210::decodeSwOp(code, ranges[r]);
+                TEST_ASSERT_LESS_OR_EQUAL(other > ut ? other - ut : ut - other, error);
+            }
+        }
+
+        top = si7210::decodeSwHyst(62, ranges[r]) + 1000;
+        for (int ut = -100; ut < top; ut += 3)
+        {
+            int got = si7210::decodeSwHyst(si7210::encodeSwHyst(ut, ranges[r]), ranges[r]);
+            int error = got > ut ? got - ut : ut - got;
+            for (int code = 0; code <= SW_HYST_ZERO; code++)
+            {
+                int other = si7210::decodeSwHyst(code, ranges[r]);
+                TEST_ASSERT_LESS_OR_EQUAL(other > ut ? other - ut : ut - other, error);
+            }
+        }
+    }
+}
+
+void test_set_switch_programs_registers(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_switch_t sw;
+    sw.thresholdUt = 2000;  // (16 + 9) * 2^4 * 5uT = 2000uT -> sw_op = 0x49
+    sw.hysteresisUt = 400;  // (8 + 2) * 2^3 * 5uT = 400uT -> sw_hyst = 0x1A
+    sw.polarity = si7210_switch_polarity_t::NEGATIVE;
+    sw.lowForField = true;
+
+    si7210_switch_t effective;
+    TEST_ASSERT_TRUE(hall.setSwitch(sw, &effective));
+
+    TEST_ASSERT_EQUAL_HEX8(0x80 | 0x49, sim.peek(HALL, REG_0XC6));
+    TEST_ASSERT_EQUAL_HEX8((2 << 6) | 0x1A, sim.peek(HALL, REG_0XC7));
+    TEST_ASSERT_EQUAL(2000, effective.thresholdUt);
+    TEST_ASSERT_EQUAL(400, effective.hysteresisUt);
+    TEST_ASSERT_TRUE(effective.polarity == si7210_switch_polarity_t::NEGATIVE);
+    TEST_ASSERT_TRUE(effective.lowForField);
+}
+
+void test_set_switch_reports_rounded_thresholds(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_200mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_switch_t sw;
+    sw.thresholdUt = 12345;
+    sw.hysteresisUt = 0;
+    sw.lowForField = false;
+
+    si7210_switch_t effective;
+    TEST_ASSERT_TRUE(hall.setSwitch(sw, &effective));
+
+    // Nearest on the 200mT range: (16 + 15) * 2^3 * 50uT = 12400uT
+    TEST_ASSERT_EQUAL(12400, effective.thresholdUt);
+    TEST_ASSERT_EQUAL(0, effective.hysteresisUt);
+    TEST_ASSERT_FALSE(effective.lowForField);
+    TEST_ASSERT_TRUE(effective.polarity == si7210_switch_polarity_t::ABSOLUTE);
+}
+
+void test_get_switch_rejects_reserved_polarity(void)
+{
+    si7210_sim_bus sim;
+    sim.addDevice(HALL);
+    Filter filter;
+    si7210 hall(&sim, HALL, si7210_range_t::RANGE_20mT, si7210_magnet_t::NONE, si7210_mode_t::CONST_CONVERSION, filter);
+
+    si7210_switch_t sw;
+    sim.poke(HALL, REG_0XC7, (2 << 6) | 0x1A);
+    TEST_ASSERT_TRUE(hall.getSwitch(&sw));
+    TEST_ASSERT_TRUE(sw.polarity == si7210_switch_polarity_t::NEGATIVE);
+
+    sim.poke(HALL, REG_0XC7, (3 << 6) | 0x1A);
+    TEST_ASSERT_FALSE(hall.getSwitch(&sw));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sw_op_decode_is_strictly_increasing);
+    RUN_TEST(test_sw_hyst_decode_is_strictly_increasing);
+    RUN_TEST(test_every_code_round_trips);
+    RUN_TEST(test_encoding_is_nearest);
+    RUN_TEST(test_set_switch_programs_registers);
+    RUN_TEST(test_set_switch_reports_rounded_thresholds);
+    RUN_TEST(test_get_switch_rejects_reserved_polarity);
+
+    return UNITY_END();
+}